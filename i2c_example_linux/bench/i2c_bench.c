@@ -0,0 +1,185 @@
+/*
+ * i2c_bench.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "i2c.h"
+#include "sim.h"
+#include "tmp3.h"
+#include "tmp3_sim.h"
+
+#define I2C_BENCH_NUM_OPS 4
+
+static int bench_readn_reg(void *priv) {
+	uint8_t data[2];
+
+	return i2c_readn_reg(priv, TMP3_REG_TEMP, data, sizeof(data));
+}
+
+static int bench_writen_reg(void *priv) {
+	uint8_t data[2] = { 80, 0 };
+
+	return i2c_writen_reg(priv, TMP3_REG_LIMIT, data, sizeof(data));
+}
+
+static int bench_read_reg_cached(void *priv) {
+	uint8_t value;
+
+	return i2c_get_reg(priv, TMP3_REG_CONFIG, &value);
+}
+
+static int bench_read_regs(void *priv) {
+	struct I2cDevice *dev = priv;
+	struct I2cRegRead reads[4];
+	uint8_t data[4][2];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		reads[i].addr = dev->addr;
+		reads[i].reg = i;
+		reads[i].buf = data[i];
+		reads[i].buf_len = i == TMP3_REG_CONFIG ? 1 : 2;
+	}
+
+	return i2c_read_regs(dev, reads, 4);
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [-d /dev/i2c-N] [-a addr] [-n iterations] [-c clock_hz]\n", name);
+	fprintf(stderr, "  -d  benchmark a real I2C bus instead of the simulator\n");
+	fprintf(stderr, "  -a  address of the PmodTMP3, default 0x48\n");
+	fprintf(stderr, "  -n  number of iterations per operation, default 10000\n");
+	fprintf(stderr, "  -c  clock of the simulated bus, default 0 to measure the software only\n");
+}
+
+int main(int argc, char **argv) {
+	struct BenchResult results[I2C_BENCH_NUM_OPS];
+	struct BenchCounter counter;
+	struct Transport real;
+	struct I2cRegCache cache;
+	struct I2cDevice cached;
+	struct I2cDevice dev;
+	struct I2cBus real_bus;
+	struct I2cBus bus;
+	struct SimBus sim_bus;
+	struct Tmp3Sim tmp3;
+	char *filename = NULL;
+	uint16_t addr = 0x48;
+	size_t iterations = 10000;
+	uint32_t clock_hz = 0;
+	int opt;
+	int rc;
+
+	while ((opt = getopt(argc, argv, "d:a:n:c:")) != -1) {
+		switch (opt) {
+		case 'd':
+			filename = optarg;
+			break;
+		case 'a':
+			addr = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			clock_hz = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	/*
+	 * Count the transactions of either the real bus or the simulator.
+	 */
+	if (filename) {
+		real_bus.filename = filename;
+		real_bus.transport = NULL;
+		real_bus.timeout_ms = 0;
+		real.ops = &i2c_transport_ops;
+		real.priv = &real_bus;
+
+		rc = transport_open(&real);
+		if (rc) {
+			printf("failed to open i2c bus\r\n");
+			return rc;
+		}
+
+		counter.inner = &real;
+	} else {
+		sim_bus.timing.clock_hz = clock_hz;
+		sim_bus.timing.bits_per_byte = 9;
+		sim_bus.timing.transaction_ns = 0;
+		sim_bus.timing.rx_buffered = 0;
+		sim_bus_init(&sim_bus);
+
+		tmp3.celsius = 21.5;
+		tmp3.script = NULL;
+		tmp3_sim_init(&tmp3, addr);
+		sim_bus_add_device(&sim_bus, &tmp3.sim);
+
+		counter.inner = &sim_bus.transport;
+	}
+
+	bench_counter_init(&counter);
+
+	bus.filename = filename;
+	bus.transport = &counter.transport;
+	bus.timeout_ms = 0;
+
+	rc = i2c_bus_start(&bus);
+	if (rc) {
+		printf("failed to start i2c bus\r\n");
+		return rc;
+	}
+
+	/*
+	 * One volatile device and one caching the configuration register.
+	 */
+	dev.addr = addr;
+	dev.scratch_len = 0;
+	dev.cache = NULL;
+	dev.retries = 0;
+	dev.retry_delay_us = 0;
+	dev.recover = NULL;
+
+	cached.addr = addr;
+	cached.scratch_len = 0;
+	cached.retries = 0;
+	cached.retry_delay_us = 0;
+	cached.recover = NULL;
+	i2c_cache_init(&cache);
+	i2c_cache_set_policy(&cache, TMP3_REG_CONFIG, I2C_REG_CACHE);
+	i2c_cache_set_self_clear(&cache, TMP3_REG_CONFIG, TMP3_CONFIG_ONESHOT);
+	cached.cache = &cache;
+
+	if (i2c_bus_add_device(&bus, &dev) || i2c_bus_add_device(&bus, &cached)) {
+		printf("failed to start i2c device\r\n");
+		return 1;
+	}
+
+	bench_run("i2c_readn_reg", bench_readn_reg, NULL, &dev, iterations, &results[0]);
+	bench_run("i2c_writen_reg", bench_writen_reg, NULL, &dev, iterations, &results[1]);
+	bench_run("i2c_read_reg_cached", bench_read_reg_cached, NULL, &cached, iterations, &results[2]);
+	bench_run("i2c_read_regs_4", bench_read_regs, NULL, &dev, iterations, &results[3]);
+
+	bench_print_json(stdout, "i2c", filename ? "i2c" : "sim", results, I2C_BENCH_NUM_OPS);
+
+	i2c_stop(&cached);
+	i2c_stop(&dev);
+	i2c_bus_stop(&bus);
+
+	if (filename) {
+		transport_close(&real);
+	}
+
+	return 0;
+}
@@ -0,0 +1,713 @@
+/*
+ * acq.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+#include <poll.h>
+#include <time.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "acq.h"
+
+/*
+ * Get the current CLOCK_MONOTONIC time.
+ *
+ * @return the current time, in nanoseconds
+ */
+static uint64_t acq_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*
+ * Initialize the sample queue of a worker.
+ *
+ * @param queue points to the sample queue to be initialized
+ * @param size number of samples the queue can hold, must be a power of two
+ *
+ * @return - 0 if the initialization procedure succeeded
+ *         - negative if the initialization procedure failed
+ */
+static int acq_queue_init(struct AcqQueue *queue, size_t size) {
+	if (!size || (size & (size - 1))) {
+		printf("%s: sample queue size must be a power of two\r\n", __func__);
+		return -EINVAL;
+	}
+
+	queue->slots = malloc(size * sizeof(*queue->slots));
+	if (!queue->slots) {
+		printf("%s: failed to allocate sample queue\r\n", __func__);
+		return -ENOMEM;
+	}
+
+	/*
+	 * Fault the queue in before the workers run.
+	 */
+	memset(queue->slots, 0, size * sizeof(*queue->slots));
+
+	queue->size = size;
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->tail, 0);
+
+	return 0;
+}
+
+/*
+ * Get the next free slot of the sample queue.
+ *
+ * @param queue points to the sample queue
+ *
+ * @return the free slot, NULL if the queue is full
+ */
+static struct AcqSample *acq_queue_slot(struct AcqQueue *queue) {
+	size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+	if (head - tail == queue->size) {
+		return NULL;
+	}
+
+	return &queue->slots[head & (queue->size - 1)];
+}
+
+/*
+ * Publish the sample written into the free slot of the sample queue.
+ *
+ * @param queue points to the sample queue
+ */
+static void acq_queue_commit(struct AcqQueue *queue) {
+	size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+	atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+}
+
+/*
+ * Move samples out of the sample queue.
+ *
+ * @param queue points to the sample queue
+ * @param samples points to the start of the samples to be read into
+ * @param num_samples maximum number of samples to be read
+ *
+ * @return the number of samples read
+ */
+static size_t acq_queue_read(struct AcqQueue *queue, struct AcqSample *samples,
+		size_t num_samples) {
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+	size_t i;
+
+	if (num_samples > head - tail) {
+		num_samples = head - tail;
+	}
+
+	for (i = 0; i < num_samples; i++) {
+		samples[i] = queue->slots[(tail + i) & (queue->size - 1)];
+	}
+
+	atomic_store_explicit(&queue->tail, tail + num_samples, memory_order_release);
+
+	return num_samples;
+}
+
+/*
+ * Wake up the consumer if it is waiting for samples.
+ *
+ * @param rt points to the started runtime
+ */
+static void acq_notify(struct AcqRuntime *rt) {
+	uint64_t value = 1;
+
+	/*
+	 * Order the published samples before reading the waiting flag, pairing
+	 * with the fence of the consumer, so that either the consumer sees the
+	 * samples or the worker sees the consumer waiting.
+	 */
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (!atomic_load_explicit(&rt->waiting, memory_order_relaxed)) {
+		return;
+	}
+
+	if (write(rt->event_fd, &value, sizeof(value)) < 0) {
+		printf("%s: failed to wake up acquisition consumer\r\n", __func__);
+	}
+}
+
+/*
+ * Schedule the next run of a task, one period after the previous deadline.
+ * Periods that already ended are skipped and counted as overruns, instead of
+ * being run back-to-back to catch up.
+ *
+ * @param task points to the task that just ran
+ * @param now current CLOCK_MONOTONIC time, in nanoseconds
+ */
+static void acq_task_advance(struct AcqTask *task, uint64_t now) {
+	uint64_t period = (uint64_t)task->period_us * 1000;
+	uint64_t missed;
+
+	task->deadline_ns += period;
+
+	if (task->deadline_ns <= now) {
+		missed = (now - task->deadline_ns) / period + 1;
+		task->deadline_ns += missed * period;
+		atomic_fetch_add_explicit(&task->overruns, missed, memory_order_relaxed);
+	}
+}
+
+/*
+ * Record the delay between the deadline of a task and the start of its run.
+ *
+ * @param task points to the task about to run
+ * @param now current CLOCK_MONOTONIC time, in nanoseconds
+ */
+static void acq_task_record_lateness(struct AcqTask *task, uint64_t now) {
+	uint64_t lateness = now - task->deadline_ns;
+#if BUS_STATS
+	struct timespec deadline;
+
+	deadline.tv_sec = task->deadline_ns / 1000000000;
+	deadline.tv_nsec = task->deadline_ns % 1000000000;
+	bus_stats_record(&task->lateness, &deadline, 0, 0);
+#endif
+
+	/*
+	 * Only the worker writes the maximum, other threads only read it.
+	 */
+	if (lateness > atomic_load_explicit(&task->max_lateness_ns, memory_order_relaxed)) {
+		atomic_store_explicit(&task->max_lateness_ns, lateness, memory_order_relaxed);
+	}
+}
+
+/*
+ * Touch the stack of a real-time worker, so that its pages are faulted in
+ * before the first deadline.
+ */
+static void __attribute__((noinline)) acq_prefault_stack(void) {
+	volatile uint8_t stack[ACQ_RT_PREFAULT_STACK];
+	size_t i;
+
+	for (i = 0; i < sizeof(stack); i += 256) {
+		stack[i] = 0;
+	}
+}
+
+/*
+ * Worker thread, running the tasks of its bus at their deadlines.
+ *
+ * The worker sleeps until the earliest deadline with an absolute
+ * clock_nanosleep, so that the periods do not drift with the duration of
+ * the reads.
+ *
+ * @param arg points to the worker
+ *
+ * @return NULL
+ */
+static void *acq_worker_run(void *arg) {
+	struct AcqWorker *worker = arg;
+	struct AcqRuntime *rt = worker->rt;
+	struct AcqTask *task;
+	struct AcqTask *earliest;
+	struct timespec wake;
+	uint64_t now;
+	uint64_t until;
+	int rc;
+
+	if (worker->priority) {
+		acq_prefault_stack();
+	}
+
+	now = acq_now_ns();
+	for (task = worker->tasks; task; task = task->next) {
+		task->deadline_ns = now;
+	}
+
+	while (atomic_load_explicit(&rt->running, memory_order_relaxed)) {
+		earliest = worker->tasks;
+		for (task = worker->tasks; task; task = task->next) {
+			if (task->deadline_ns < earliest->deadline_ns) {
+				earliest = task;
+			}
+		}
+
+		now = acq_now_ns();
+		if (now < earliest->deadline_ns) {
+			/*
+			 * Sleep in slices, to notice the runtime being stopped.
+			 */
+			until = earliest->deadline_ns;
+			if (until - now > ACQ_STOP_SLICE_NS) {
+				until = now + ACQ_STOP_SLICE_NS;
+			}
+
+			wake.tv_sec = until / 1000000000;
+			wake.tv_nsec = until % 1000000000;
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+			continue;
+		}
+
+		acq_task_record_lateness(earliest, now);
+		worker->published = false;
+
+		rc = earliest->read(earliest);
+		atomic_fetch_add_explicit(&earliest->runs, 1, memory_order_relaxed);
+		if (rc < 0) {
+			atomic_fetch_add_explicit(&earliest->errors, 1, memory_order_relaxed);
+			acq_publish(earliest, 0, rc, NULL, 0);
+		}
+
+		acq_task_advance(earliest, acq_now_ns());
+
+		if (worker->published) {
+			acq_notify(rt);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Initialize the runtime, with no workers.
+ *
+ * @param rt points to the runtime to be initialized
+ */
+void acq_init(struct AcqRuntime *rt) {
+	rt->workers = NULL;
+	rt->num_tasks = 0;
+	rt->event_fd = -1;
+	rt->poll_next = NULL;
+	rt->locked = false;
+	atomic_init(&rt->running, false);
+	atomic_init(&rt->waiting, false);
+}
+
+/*
+ * Add a worker to the runtime, before starting it.
+ * All the devices of a bus must be read by tasks of the same worker.
+ *
+ * @param rt points to the initialized runtime
+ * @param worker points to the worker to be added,
+ *        having name, cpu and queue_len populated
+ *
+ * @return - 0 if the worker was added
+ *         - negative if the worker could not be added
+ */
+int acq_add_worker(struct AcqRuntime *rt, struct AcqWorker *worker) {
+	if (worker->cpu >= CPU_SETSIZE) {
+		printf("%s: CPU %d is out of range\r\n", __func__, worker->cpu);
+		return -EINVAL;
+	}
+
+	if (worker->priority < 0 || worker->priority > sched_get_priority_max(SCHED_FIFO)) {
+		printf("%s: priority %d is out of range\r\n", __func__, worker->priority);
+		return -EINVAL;
+	}
+
+	worker->rt = rt;
+	worker->tasks = NULL;
+	worker->queue.slots = NULL;
+	atomic_init(&worker->dropped, 0);
+
+	worker->next = rt->workers;
+	rt->workers = worker;
+
+	return 0;
+}
+
+/*
+ * Add a task to a worker, before starting the runtime.
+ *
+ * @param worker points to the worker added to a runtime
+ * @param task points to the task to be added,
+ *        having name, period_us, read and priv populated
+ *
+ * @return - 0 if the task was added
+ *         - negative if the task could not be added
+ */
+int acq_add_task(struct AcqWorker *worker, struct AcqTask *task) {
+	struct AcqTask **tail;
+
+	if (task->period_us <= 0) {
+		printf("%s: period of task %s must be positive\r\n", __func__, task->name);
+		return -EINVAL;
+	}
+
+	if (worker->rt->num_tasks > UINT16_MAX) {
+		printf("%s: too many tasks\r\n", __func__);
+		return -ENOSPC;
+	}
+
+	task->id = worker->rt->num_tasks++;
+	task->worker = worker;
+	task->deadline_ns = 0;
+	atomic_init(&task->runs, 0);
+	atomic_init(&task->errors, 0);
+	atomic_init(&task->overruns, 0);
+	atomic_init(&task->max_lateness_ns, 0);
+	bus_stats_init(&task->lateness);
+	task->next = NULL;
+
+	/*
+	 * Keep the tasks in the order they were added, which is the order they
+	 * run in when their deadlines are equal.
+	 */
+	for (tail = &worker->tasks; *tail; tail = &(*tail)->next);
+	*tail = task;
+
+	return 0;
+}
+
+/*
+ * Stop the started workers of the runtime and release their sample queues.
+ *
+ * @param rt points to the runtime
+ * @param end first worker that was not started
+ */
+static void acq_stop_workers(struct AcqRuntime *rt, struct AcqWorker *end) {
+	struct AcqWorker *worker;
+
+	atomic_store(&rt->running, false);
+
+	for (worker = rt->workers; worker != end; worker = worker->next) {
+		if (worker->tasks) {
+			pthread_join(worker->thread, NULL);
+		}
+
+		free(worker->queue.slots);
+		worker->queue.slots = NULL;
+	}
+}
+
+/*
+ * Lock the memory of the process if any worker runs in real-time mode,
+ * so that the workers do not page fault, including on memory mapped later.
+ *
+ * @param rt points to the runtime with its workers added
+ *
+ * @return - 0 if the memory was locked or no worker runs in real-time mode
+ *         - negative if the memory could not be locked
+ */
+static int acq_lock_memory(struct AcqRuntime *rt) {
+	struct AcqWorker *worker;
+
+	for (worker = rt->workers; worker; worker = worker->next) {
+		if (worker->priority && worker->tasks) {
+			break;
+		}
+	}
+
+	if (!worker) {
+		return 0;
+	}
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		printf("%s: failed to lock memory\r\n", __func__);
+		return -errno;
+	}
+
+	rt->locked = true;
+
+	return 0;
+}
+
+/*
+ * Set the attributes of a real-time worker: SCHED_FIFO scheduling at the
+ * priority of the worker and a stack small enough to be locked in memory.
+ *
+ * @param worker points to the worker
+ * @param attr points to the initialized attributes of the worker thread
+ *
+ * @return - 0 if the attributes were set
+ *         - negative if the attributes could not be set
+ */
+static int acq_set_realtime(struct AcqWorker *worker, pthread_attr_t *attr) {
+	struct sched_param param;
+	int rc;
+
+	param.sched_priority = worker->priority;
+
+	rc = pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+	if (rc) {
+		goto fail;
+	}
+
+	rc = pthread_attr_setschedpolicy(attr, SCHED_FIFO);
+	if (rc) {
+		goto fail;
+	}
+
+	rc = pthread_attr_setschedparam(attr, &param);
+	if (rc) {
+		goto fail;
+	}
+
+	rc = pthread_attr_setstacksize(attr, ACQ_RT_STACK_SIZE);
+	if (rc) {
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	printf("%s: failed to set real-time attributes of worker %s\r\n", __func__,
+			worker->name);
+	return -rc;
+}
+
+/*
+ * Start the runtime, creating a thread for each worker with tasks,
+ * pinned to the CPU of the worker if any.
+ *
+ * Workers with a priority run in real-time mode: SCHED_FIFO scheduling,
+ * with the memory of the process locked and their stacks and queues faulted
+ * in before their first deadline. Creating them needs the CAP_SYS_NICE and
+ * CAP_IPC_LOCK capabilities, or matching resource limits.
+ *
+ * @param rt points to the runtime with its workers and tasks added
+ *
+ * @return - 0 if the start procedure succeeded
+ *         - negative if the start procedure failed
+ */
+int acq_start(struct AcqRuntime *rt) {
+	struct AcqWorker *worker;
+	pthread_attr_t attr;
+	cpu_set_t cpus;
+	int rc;
+
+	if (!rt->workers) {
+		printf("%s: runtime has no workers\r\n", __func__);
+		return -EINVAL;
+	}
+
+	rc = acq_lock_memory(rt);
+	if (rc < 0) {
+		return rc;
+	}
+
+	rt->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (rt->event_fd < 0) {
+		printf("%s: failed to create acquisition event\r\n", __func__);
+		rc = -errno;
+		goto fail_event;
+	}
+
+	rt->poll_next = rt->workers;
+	atomic_store(&rt->running, true);
+
+	for (worker = rt->workers; worker; worker = worker->next) {
+		rc = acq_queue_init(&worker->queue, worker->queue_len);
+		if (rc < 0) {
+			goto fail_worker;
+		}
+
+		/*
+		 * Workers without tasks only need their empty queue.
+		 */
+		if (!worker->tasks) {
+			continue;
+		}
+
+		rc = pthread_attr_init(&attr);
+		if (rc) {
+			printf("%s: failed to initialize worker attributes\r\n", __func__);
+			rc = -rc;
+			goto fail_attr;
+		}
+
+		if (worker->cpu >= 0) {
+			CPU_ZERO(&cpus);
+			CPU_SET(worker->cpu, &cpus);
+
+			rc = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+			if (rc) {
+				printf("%s: failed to pin worker %s to CPU %d\r\n", __func__,
+						worker->name, worker->cpu);
+				rc = -rc;
+				goto fail_thread;
+			}
+		}
+
+		if (worker->priority) {
+			rc = acq_set_realtime(worker, &attr);
+			if (rc < 0) {
+				goto fail_thread;
+			}
+		}
+
+		rc = pthread_create(&worker->thread, &attr, acq_worker_run, worker);
+		if (rc) {
+			printf("%s: failed to create worker %s\r\n", __func__, worker->name);
+			rc = -rc;
+			goto fail_thread;
+		}
+
+		pthread_attr_destroy(&attr);
+	}
+
+	return 0;
+
+fail_thread:
+	pthread_attr_destroy(&attr);
+fail_attr:
+	free(worker->queue.slots);
+	worker->queue.slots = NULL;
+fail_worker:
+	acq_stop_workers(rt, worker);
+	close(rt->event_fd);
+fail_event:
+	if (rt->locked) {
+		munlockall();
+		rt->locked = false;
+	}
+	return rc;
+}
+
+/*
+ * Publish a sample from the read function of a task.
+ *
+ * @param task points to the running task
+ * @param channel channel of the task the sample belongs to
+ * @param status 0 for a measurement, negative error code for a failed read
+ * @param data points to the start of the data of the sample
+ * @param len length of the data, at most ACQ_SAMPLE_LEN
+ *
+ * @return - 0 if the sample was published
+ *         - negative if the sample was dropped
+ */
+int acq_publish(struct AcqTask *task, uint16_t channel, int32_t status,
+		const void *data, size_t len) {
+	struct AcqWorker *worker = task->worker;
+	struct AcqSample *sample;
+
+	if (len > ACQ_SAMPLE_LEN) {
+		printf("%s: sample of task %s is too long\r\n", __func__, task->name);
+		return -EINVAL;
+	}
+
+	sample = acq_queue_slot(&worker->queue);
+	if (!sample) {
+		atomic_fetch_add_explicit(&worker->dropped, 1, memory_order_relaxed);
+		return -ENOBUFS;
+	}
+
+	sample->task = task->id;
+	sample->channel = channel;
+	sample->status = status;
+	sample->timestamp_ns = acq_now_ns();
+	sample->len = len;
+	memcpy(sample->data, data, len);
+
+	acq_queue_commit(&worker->queue);
+	worker->published = true;
+
+	return 0;
+}
+
+/*
+ * Move the samples published by the workers out of their queues, taking the
+ * workers in turns so that a busy bus does not starve the others.
+ * Must be called from a single consumer thread.
+ *
+ * @param rt points to the started runtime
+ * @param samples points to the start of the samples to be read into
+ * @param num_samples maximum number of samples to be read
+ * @param timeout_ms time to wait for a sample when none is queued,
+ *        in milliseconds, negative to wait forever
+ *
+ * @return - number of samples read, 0 on timeout
+ *         - negative if the wait failed
+ */
+int acq_poll(struct AcqRuntime *rt, struct AcqSample *samples, size_t num_samples,
+		int timeout_ms) {
+	struct AcqWorker *worker;
+	struct pollfd fds;
+	size_t num_read = 0;
+	uint64_t value;
+	int rc;
+
+	while (1) {
+		worker = rt->poll_next;
+		do {
+			num_read += acq_queue_read(&worker->queue, samples + num_read,
+					num_samples - num_read);
+
+			worker = worker->next ? worker->next : rt->workers;
+		} while (worker != rt->poll_next && num_read < num_samples);
+
+		rt->poll_next = worker;
+
+		if (num_read || !timeout_ms) {
+			return num_read;
+		}
+
+		/*
+		 * Announce the wait and check the queues again before sleeping,
+		 * pairing with the fence of the workers.
+		 */
+		atomic_store_explicit(&rt->waiting, true, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+
+		for (worker = rt->workers; worker; worker = worker->next) {
+			if (atomic_load_explicit(&worker->queue.head, memory_order_relaxed) !=
+					atomic_load_explicit(&worker->queue.tail, memory_order_relaxed)) {
+				break;
+			}
+		}
+
+		if (!worker) {
+			fds.fd = rt->event_fd;
+			fds.events = POLLIN;
+
+			rc = poll(&fds, 1, timeout_ms);
+			if (rc < 0 && errno != EINTR) {
+				printf("%s: failed to wait for samples\r\n", __func__);
+				atomic_store_explicit(&rt->waiting, false, memory_order_relaxed);
+				return -errno;
+			}
+
+			if (read(rt->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+				printf("%s: failed to clear acquisition event\r\n", __func__);
+			}
+
+			/*
+			 * Return on timeout or signal, leaving the caller to decide
+			 * whether to keep waiting.
+			 */
+			if (rc <= 0) {
+				timeout_ms = 0;
+			}
+		}
+
+		atomic_store_explicit(&rt->waiting, false, memory_order_relaxed);
+	}
+}
+
+/*
+ * Stop the runtime, waiting for the running reads to complete.
+ * Samples left in the queues are discarded.
+ *
+ * @param rt points to the started runtime
+ */
+void acq_stop(struct AcqRuntime *rt) {
+	acq_stop_workers(rt, NULL);
+	close(rt->event_fd);
+
+	if (rt->locked) {
+		munlockall();
+		rt->locked = false;
+	}
+}
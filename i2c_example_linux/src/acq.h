@@ -0,0 +1,135 @@
+/*
+ * acq.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bus_stats.h"
+
+#ifndef SRC_ACQ_H_
+#define SRC_ACQ_H_
+
+/*
+ * Size of a cache line, used to keep the producer and consumer indexes apart.
+ */
+#define ACQ_CACHE_LINE 64
+
+/*
+ * Maximum length of the data of a sample.
+ */
+#define ACQ_SAMPLE_LEN 24
+
+/*
+ * Longest time a worker sleeps before checking whether it was stopped,
+ * in nanoseconds.
+ */
+#define ACQ_STOP_SLICE_NS 100000000L
+
+/*
+ * Stack size of the real-time workers, and the part of it touched when the
+ * worker starts, so that the worker does not page fault on its stack.
+ */
+#define ACQ_RT_STACK_SIZE (256 * 1024)
+#define ACQ_RT_PREFAULT_STACK (64 * 1024)
+
+struct AcqRuntime;
+struct AcqWorker;
+struct AcqTask;
+
+/*
+ * Sample handed from a worker to the consumer.
+ */
+struct AcqSample {
+	uint16_t task; /**< Identifier of the task that published the sample */
+	uint16_t channel; /**< Channel of the task, eg: index of a device read by the task */
+	int32_t status; /**< 0 for a measurement, negative error code if the read failed */
+	uint64_t timestamp_ns; /**< CLOCK_MONOTONIC time the sample was published at */
+	uint32_t len; /**< Length of the data */
+	uint8_t data[ACQ_SAMPLE_LEN]; /**< Data of the sample, to be copied out with memcpy */
+};
+
+/*
+ * Sample queue with a power-of-two size.
+ *
+ * The queue is lock-free for a single producer thread, the worker, and a
+ * single consumer thread, the one polling the runtime.
+ */
+struct AcqQueue {
+	struct AcqSample *slots; /**< Storage of the queue */
+	size_t size; /**< Number of slots, a power of two */
+
+	_Alignas(ACQ_CACHE_LINE) atomic_size_t head; /**< Free-running write index, owned by the producer */
+	_Alignas(ACQ_CACHE_LINE) atomic_size_t tail; /**< Free-running read index, owned by the consumer */
+};
+
+/*
+ * Periodic read of one or more devices, run by the worker of their bus.
+ */
+struct AcqTask {
+	const char *name; /**< Name of the task, eg: tmp3 */
+	long period_us; /**< Period of the task, in microseconds */
+	int (*read)(struct AcqTask *task); /**< Reads the devices and publishes samples with acq_publish, returns 0 or negative */
+	void *priv; /**< Private data of the read function */
+
+	uint16_t id; /**< Identifier of the task in the runtime, set when added */
+	struct AcqWorker *worker; /**< Worker running the task */
+	uint64_t deadline_ns; /**< CLOCK_MONOTONIC time of the next run */
+	atomic_uint_least64_t runs; /**< Number of runs */
+	atomic_uint_least64_t errors; /**< Number of failed runs */
+	atomic_uint_least64_t overruns; /**< Number of deadlines missed, periods skipped because a run ended late */
+	atomic_uint_least64_t max_lateness_ns; /**< Longest delay between a deadline and the start of its run */
+	struct BusStats lateness; /**< Histogram of the delays between the deadlines and the starts of their runs, the period jitter */
+	struct AcqTask *next; /**< Next task of the worker */
+};
+
+/*
+ * Thread servicing a single bus, running the tasks of the devices on the bus
+ * one at a time, in deadline order.
+ */
+struct AcqWorker {
+	const char *name; /**< Name of the bus serviced by the worker, eg: /dev/i2c-0 */
+	int cpu; /**< CPU to pin the worker to, -1 for none */
+	int priority; /**< SCHED_FIFO priority of the worker for the real-time mode, 0 for the default scheduling */
+	size_t queue_len; /**< Number of samples the queue can hold, a power of two */
+
+	struct AcqRuntime *rt; /**< Runtime the worker belongs to */
+	struct AcqTask *tasks; /**< Tasks run by the worker */
+	struct AcqQueue queue; /**< Samples published by the tasks */
+	pthread_t thread; /**< Thread of the worker */
+	bool published; /**< Whether the current run published samples */
+	atomic_uint_least64_t dropped; /**< Number of samples dropped because the queue was full */
+	struct AcqWorker *next; /**< Next worker of the runtime */
+};
+
+/*
+ * Acquisition runtime with one worker per bus, so that the buses run in
+ * parallel, and a single consumer thread polling the samples.
+ */
+struct AcqRuntime {
+	struct AcqWorker *workers; /**< Workers of the runtime */
+	size_t num_tasks; /**< Number of tasks added to the workers */
+	int event_fd; /**< Event file descriptor waking up the consumer */
+	atomic_bool running; /**< Whether the workers should keep running */
+	atomic_bool waiting; /**< Whether the consumer is waiting for samples */
+	bool locked; /**< Whether the memory was locked for real-time workers */
+	struct AcqWorker *poll_next; /**< Worker to be polled first, for fairness between the buses */
+};
+
+void acq_init(struct AcqRuntime *rt);
+int acq_add_worker(struct AcqRuntime *rt, struct AcqWorker *worker);
+int acq_add_task(struct AcqWorker *worker, struct AcqTask *task);
+int acq_start(struct AcqRuntime *rt);
+int acq_publish(struct AcqTask *task, uint16_t channel, int32_t status,
+		const void *data, size_t len);
+int acq_poll(struct AcqRuntime *rt, struct AcqSample *samples, size_t num_samples,
+		int timeout_ms);
+void acq_stop(struct AcqRuntime *rt);
+
+#endif /* SRC_ACQ_H_ */
@@ -0,0 +1,345 @@
+/*
+ * async.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "async.h"
+
+/*
+ * Complete a request, through its callback if it has one, through the
+ * completion queue otherwise.
+ *
+ * @param bus points to the started bus
+ * @param req points to the request that ran
+ */
+static void async_complete(struct AsyncBus *bus, struct AsyncRequest *req) {
+	/*
+	 * The callback owns the request from now on, and may submit it again.
+	 */
+	if (req->complete) {
+		req->complete(req);
+		return;
+	}
+
+	pthread_mutex_lock(&bus->lock);
+	req->next = NULL;
+	*bus->completions_tail = req;
+	bus->completions_tail = &req->next;
+	req->completed = true;
+	req->done = true;
+	pthread_cond_broadcast(&bus->completed);
+	pthread_mutex_unlock(&bus->lock);
+}
+
+/*
+ * Leave async_poll or async_wait, letting a stopping bus know once no
+ * thread waits on it anymore. Called with the lock of the bus held.
+ *
+ * @param bus points to the bus
+ */
+static void async_leave(struct AsyncBus *bus) {
+	bus->waiters--;
+	if (!bus->running && !bus->waiters) {
+		pthread_cond_broadcast(&bus->completed);
+	}
+}
+
+/*
+ * Worker thread, running the submitted requests in submission order.
+ *
+ * @param arg points to the bus
+ *
+ * @return NULL
+ */
+static void *async_worker(void *arg) {
+	struct AsyncBus *bus = arg;
+	struct AsyncRequest *req;
+
+	pthread_mutex_lock(&bus->lock);
+
+	while (1) {
+		while (bus->running && !bus->pending) {
+			pthread_cond_wait(&bus->submitted, &bus->lock);
+		}
+
+		if (!bus->running) {
+			break;
+		}
+
+		req = bus->pending;
+		bus->pending = req->next;
+		if (!bus->pending) {
+			bus->pending_tail = &bus->pending;
+		}
+
+		/*
+		 * Run the transaction without the lock, so that requests can be
+		 * submitted and polled meanwhile.
+		 */
+		pthread_mutex_unlock(&bus->lock);
+		req->result = req->run(req);
+		async_complete(bus, req);
+		pthread_mutex_lock(&bus->lock);
+	}
+
+	pthread_mutex_unlock(&bus->lock);
+
+	return NULL;
+}
+
+/*
+ * Start the worker of the bus.
+ *
+ * @param bus points to the bus to be started, having name populated
+ *
+ * @return - 0 if the start procedure succeeded
+ *         - negative if the start procedure failed
+ */
+int async_start(struct AsyncBus *bus) {
+	pthread_condattr_t attr;
+	int rc;
+
+	bus->pending = NULL;
+	bus->pending_tail = &bus->pending;
+	bus->completions = NULL;
+	bus->completions_tail = &bus->completions;
+	bus->waiters = 0;
+	bus->running = true;
+
+	/*
+	 * Time the waits for completions on CLOCK_MONOTONIC.
+	 */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	pthread_mutex_init(&bus->lock, NULL);
+	pthread_cond_init(&bus->submitted, NULL);
+	pthread_cond_init(&bus->completed, &attr);
+	pthread_condattr_destroy(&attr);
+
+	rc = pthread_create(&bus->thread, NULL, async_worker, bus);
+	if (rc) {
+		printf("%s: failed to create worker of bus %s\r\n", __func__, bus->name);
+		rc = -rc;
+		goto fail_thread;
+	}
+
+	return 0;
+
+fail_thread:
+	pthread_cond_destroy(&bus->completed);
+	pthread_cond_destroy(&bus->submitted);
+	pthread_mutex_destroy(&bus->lock);
+	return rc;
+}
+
+/*
+ * Submit a prepared request to the worker of the bus.
+ * The request must stay valid until it is completed.
+ *
+ * @param bus points to the started bus
+ * @param req points to the request, having run, complete and the
+ *  arguments of the transaction populated
+ *
+ * @return - 0 if the request was submitted
+ *         - negative if the bus is stopped
+ */
+int async_submit(struct AsyncBus *bus, struct AsyncRequest *req) {
+	int rc = 0;
+
+	req->completed = false;
+	req->done = false;
+	req->next = NULL;
+
+	pthread_mutex_lock(&bus->lock);
+
+	if (!bus->running) {
+		printf("%s: bus %s is stopped\r\n", __func__, bus->name);
+		rc = -ESHUTDOWN;
+		goto exit;
+	}
+
+	*bus->pending_tail = req;
+	bus->pending_tail = &req->next;
+	pthread_cond_signal(&bus->submitted);
+
+exit:
+	pthread_mutex_unlock(&bus->lock);
+
+	return rc;
+}
+
+/*
+ * Take completed requests out of the completion queue, in completion order.
+ *
+ * @param bus points to the started bus
+ * @param reqs points to the start of the requests to be taken into
+ * @param num_reqs maximum number of requests to be taken
+ * @param timeout_ms time to wait for a completion when none is queued,
+ *        in milliseconds, negative to wait forever
+ *
+ * @return - number of requests taken, 0 on timeout or once the bus stopped
+ *         - negative if the wait failed
+ */
+int async_poll(struct AsyncBus *bus, struct AsyncRequest **reqs, size_t num_reqs,
+		int timeout_ms) {
+	struct timespec deadline;
+	size_t num_taken = 0;
+	int rc = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&bus->lock);
+	bus->waiters++;
+
+	while (!bus->completions && bus->running && timeout_ms && rc != ETIMEDOUT) {
+		if (timeout_ms < 0) {
+			rc = pthread_cond_wait(&bus->completed, &bus->lock);
+		} else {
+			rc = pthread_cond_timedwait(&bus->completed, &bus->lock, &deadline);
+		}
+
+		if (rc && rc != ETIMEDOUT) {
+			printf("%s: failed to wait for completions\r\n", __func__);
+			async_leave(bus);
+			pthread_mutex_unlock(&bus->lock);
+			return -rc;
+		}
+	}
+
+	while (bus->completions && num_taken < num_reqs) {
+		reqs[num_taken] = bus->completions;
+		bus->completions = bus->completions->next;
+		reqs[num_taken]->done = false;
+		num_taken++;
+	}
+
+	if (!bus->completions) {
+		bus->completions_tail = &bus->completions;
+	}
+
+	async_leave(bus);
+	pthread_mutex_unlock(&bus->lock);
+
+	return num_taken;
+}
+
+/*
+ * Wait for a request submitted without a callback to complete, and take it
+ * out of the completion queue unless async_poll already took it.
+ *
+ * @param bus points to the started bus
+ * @param req points to the submitted request
+ *
+ * @return the result of the transaction
+ */
+int async_wait(struct AsyncBus *bus, struct AsyncRequest *req) {
+	struct AsyncRequest **link;
+
+	pthread_mutex_lock(&bus->lock);
+	bus->waiters++;
+
+	while (!req->completed) {
+		pthread_cond_wait(&bus->completed, &bus->lock);
+	}
+
+	if (req->done) {
+		for (link = &bus->completions; *link != req; link = &(*link)->next);
+
+		*link = req->next;
+		if (bus->completions_tail == &req->next) {
+			bus->completions_tail = link;
+		}
+		req->done = false;
+	}
+
+	async_leave(bus);
+	pthread_mutex_unlock(&bus->lock);
+
+	return req->result;
+}
+
+/*
+ * Stop the worker of the bus, after the running transaction completes.
+ * Requests still waiting to be run complete with -ECANCELED, and completed
+ * requests left in the completion queue are dropped.
+ *
+ * The threads already in async_poll or async_wait return before the bus is
+ * destroyed, no other call may be made on the bus once it is stopping.
+ *
+ * @param bus points to the started bus
+ */
+void async_stop(struct AsyncBus *bus) {
+	struct AsyncRequest *callbacks = NULL;
+	struct AsyncRequest **callbacks_tail = &callbacks;
+	struct AsyncRequest *req;
+
+	pthread_mutex_lock(&bus->lock);
+	bus->running = false;
+	pthread_cond_signal(&bus->submitted);
+	pthread_cond_broadcast(&bus->completed);
+	pthread_mutex_unlock(&bus->lock);
+
+	pthread_join(bus->thread, NULL);
+
+	/*
+	 * Queue the cancelled requests without a callback for completion
+	 * under the lock, and set aside the others, whose callbacks are called
+	 * without it since they may submit again.
+	 */
+	pthread_mutex_lock(&bus->lock);
+
+	while (bus->pending) {
+		req = bus->pending;
+		bus->pending = req->next;
+		req->result = -ECANCELED;
+		req->next = NULL;
+
+		if (req->complete) {
+			*callbacks_tail = req;
+			callbacks_tail = &req->next;
+			continue;
+		}
+
+		*bus->completions_tail = req;
+		bus->completions_tail = &req->next;
+		req->completed = true;
+		req->done = true;
+	}
+
+	bus->pending_tail = &bus->pending;
+	pthread_cond_broadcast(&bus->completed);
+
+	pthread_mutex_unlock(&bus->lock);
+
+	while (callbacks) {
+		req = callbacks;
+		callbacks = req->next;
+		req->complete(req);
+	}
+
+	/*
+	 * Wait for the waiters to leave before destroying what they wait on.
+	 */
+	pthread_mutex_lock(&bus->lock);
+	while (bus->waiters) {
+		pthread_cond_wait(&bus->completed, &bus->lock);
+	}
+	pthread_mutex_unlock(&bus->lock);
+
+	pthread_cond_destroy(&bus->completed);
+	pthread_cond_destroy(&bus->submitted);
+	pthread_mutex_destroy(&bus->lock);
+}
@@ -0,0 +1,65 @@
+/*
+ * async.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SRC_ASYNC_H_
+#define SRC_ASYNC_H_
+
+struct AsyncRequest;
+
+/*
+ * Bus transaction to be run asynchronously, prepared by a bus module,
+ * eg: i2c_async_readn_reg, and submitted to the worker of its bus.
+ */
+struct AsyncRequest {
+	int (*run)(struct AsyncRequest *req); /**< Runs the transaction on the worker, returns its result */
+	void (*complete)(struct AsyncRequest *req); /**< Called on the worker once the transaction ran, NULL to queue the request for async_poll and async_wait */
+	void *priv; /**< Private data of the caller */
+
+	void *dev; /**< Device of the transaction */
+	uint8_t reg; /**< Register of the transaction */
+	uint8_t *write_buf; /**< Buffer to be written from */
+	uint8_t *read_buf; /**< Buffer to be read into */
+	size_t len; /**< Length of the transaction */
+
+	int result; /**< Result of the transaction, valid once completed */
+	bool completed; /**< Whether the transaction ran, still set once polled, protected by the lock of the bus */
+	bool done; /**< Whether the request is in the completion queue, protected by the lock of the bus */
+	struct AsyncRequest *next; /**< Next request in the submission or completion queue */
+};
+
+/*
+ * Worker thread running the transactions submitted for a single bus,
+ * one at a time in submission order, while the submitting threads carry on.
+ */
+struct AsyncBus {
+	const char *name; /**< Name of the bus, eg: /dev/i2c-0 */
+
+	pthread_t thread; /**< Thread of the worker */
+	pthread_mutex_t lock; /**< Protects the queues */
+	pthread_cond_t submitted; /**< Signaled when a request is submitted or the bus stopped */
+	pthread_cond_t completed; /**< Signaled when a request is queued for completion, or the last waiter left a stopped bus */
+	struct AsyncRequest *pending; /**< Requests waiting to be run */
+	struct AsyncRequest **pending_tail; /**< Link to append submitted requests at */
+	struct AsyncRequest *completions; /**< Requests run, waiting to be polled */
+	struct AsyncRequest **completions_tail; /**< Link to append completed requests at */
+	size_t waiters; /**< Number of threads in async_poll or async_wait */
+	bool running; /**< Whether the worker should keep running */
+};
+
+int async_start(struct AsyncBus *bus);
+int async_submit(struct AsyncBus *bus, struct AsyncRequest *req);
+int async_poll(struct AsyncBus *bus, struct AsyncRequest **reqs, size_t num_reqs,
+		int timeout_ms);
+int async_wait(struct AsyncBus *bus, struct AsyncRequest *req);
+void async_stop(struct AsyncBus *bus);
+
+#endif /* SRC_ASYNC_H_ */
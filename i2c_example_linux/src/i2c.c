@@ -6,19 +6,462 @@
  */
 
 #include <linux/i2c-dev.h>
+#include <linux/i2c.h>
 #include <sys/ioctl.h>
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
 
 #include "i2c.h"
 
+/*
+ * Allocate the scratch buffer of the I2C device, used for register writes
+ * that do not fit on the stack, so that no allocation happens afterwards.
+ *
+ * @param dev points to the I2C device, must have scratch_len populated
+ *
+ * @return - 0 if the allocation procedure succeeded
+ *         - negative if the allocation procedure failed
+ */
+static int i2c_alloc_scratch(struct I2cDevice* dev) {
+	dev->scratch = NULL;
+	if (dev->scratch_len) {
+		dev->scratch = malloc(dev->scratch_len);
+		if (!dev->scratch) {
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Check whether a register of the cache is set in a bitmap.
+ */
+#define I2C_CACHE_TEST(bitmap, reg) ((bitmap)[(reg) / 8] & (1 << ((reg) % 8)))
+#define I2C_CACHE_SET(bitmap, reg) ((bitmap)[(reg) / 8] |= (1 << ((reg) % 8)))
+#define I2C_CACHE_CLEAR(bitmap, reg) ((bitmap)[(reg) / 8] &= ~(1 << ((reg) % 8)))
+
+/*
+ * Queue a register read as a register address write followed by
+ * a register data read.
+ *
+ * @param msgs points to the two messages to be filled
+ * @param read points to the register read to be queued
+ *
+ * @return the number of messages filled
+ */
+static size_t i2c_pack_reg_read(struct i2c_msg *msgs, struct I2cRegRead *read) {
+	msgs[0].addr = read->addr;
+	msgs[0].flags = 0;
+	msgs[0].len = 1;
+	msgs[0].buf = &read->reg;
+
+	msgs[1].addr = read->addr;
+	msgs[1].flags = I2C_M_RD;
+	msgs[1].len = read->buf_len;
+	msgs[1].buf = read->buf;
+
+	return 2;
+}
+
+#if BUS_STATS
+/*
+ * Get the total length of I2C messages.
+ *
+ * @param msgs points to the start of the messages
+ * @param num_msgs number of messages
+ *
+ * @return the total length
+ */
+static size_t i2c_msgs_len(struct i2c_msg *msgs, size_t num_msgs) {
+	size_t len = 0;
+	size_t i;
+
+	for (i = 0; i < num_msgs; i++) {
+		len += msgs[i].len;
+	}
+
+	return len;
+}
+#endif
+
+/*
+ * Transfer messages through a transport in a single transaction.
+ *
+ * @param transport points to the opened transport
+ * @param msgs points to the start of the messages to be transferred
+ * @param num_msgs number of messages, at most I2C_RDWR_IOCTL_MAX_MSGS
+ *
+ * @return - number of messages transferred if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+static int i2c_transport_rdwr(struct Transport *transport, struct i2c_msg *msgs, size_t num_msgs) {
+	struct TransportSegment segs[I2C_RDWR_IOCTL_MAX_MSGS];
+	size_t i;
+
+	if (num_msgs > I2C_RDWR_IOCTL_MAX_MSGS) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < num_msgs; i++) {
+		segs[i].addr = msgs[i].addr;
+		segs[i].write_buf = (msgs[i].flags & I2C_M_RD) ? NULL : msgs[i].buf;
+		segs[i].read_buf = (msgs[i].flags & I2C_M_RD) ? msgs[i].buf : NULL;
+		segs[i].len = msgs[i].len;
+	}
+
+	return transport_batch(transport, segs, num_msgs);
+}
+
+/*
+ * Get the functionality of the adapter of an I2C bus file.
+ *
+ * @param fd file descriptor of the I2C bus
+ * @param funcs is set to the functionality of the adapter, I2C_FUNC_*
+ *
+ * @return - 0 if the probe procedure succeeded
+ *         - negative if the probe procedure failed
+ */
+static int i2c_probe_funcs(int fd, unsigned long *funcs) {
+	if (ioctl(fd, I2C_FUNCS, funcs) < 0) {
+		printf("%s: failed to get i2c adapter functionality\r\n", __func__);
+		return -errno;
+	}
+
+	return 0;
+}
+
+/*
+ * Check whether a transfer of the I2C device failed with a transient error,
+ * and prepare the next attempt if the retry budget of the device allows it:
+ * recover the bus if the transfer timed out, then back off.
+ *
+ * The backoff happens outside the bus lock, so the other devices of the
+ * bus keep transferring meanwhile. A transfer thus takes at most
+ * retries + 1 adapter timeouts plus the backoffs before failing.
+ *
+ * @param dev points to the started I2C device, or NULL for a bus with no
+ *  device, which never retries
+ * @param rc the result of the failed transfer
+ * @param attempt number of attempts already retried
+ *
+ * @return - true if the transfer should be retried
+ *         - false if the error is final
+ */
+static bool i2c_retry(struct I2cDevice* dev, int rc, unsigned int attempt) {
+	unsigned int shift;
+
+	if (!dev || attempt >= dev->retries) {
+		return false;
+	}
+
+	/*
+	 * Retry the errors a busy or glitching slave causes: no acknowledge,
+	 * lost arbitration, a hung transfer and bus errors. The others come
+	 * from the request itself and would fail again.
+	 */
+	switch (rc) {
+	case -ENXIO:
+	case -EREMOTEIO:
+	case -EAGAIN:
+	case -ETIMEDOUT:
+	case -EIO:
+		break;
+	default:
+		return false;
+	}
+
+	if (rc == -ETIMEDOUT && dev->recover) {
+		rc = dev->recover(dev);
+		if (rc < 0) {
+			printf("%s: failed to recover i2c bus\r\n", __func__);
+			return false;
+		}
+	}
+
+	BUS_STATS_RETRY(&dev->stats);
+
+	shift = attempt < I2C_MAX_BACKOFF_SHIFT ? attempt : I2C_MAX_BACKOFF_SHIFT;
+	if (dev->retry_delay_us) {
+		usleep(dev->retry_delay_us << shift);
+	}
+
+	return true;
+}
+
+/*
+ * Set the timeout of the adapter of an I2C bus file.
+ *
+ * @param fd file descriptor of the I2C bus
+ * @param timeout_ms the timeout, in milliseconds, 0 to keep the adapter default
+ *
+ * @return - 0 if the set procedure succeeded
+ *         - negative if the set procedure failed
+ */
+static int i2c_set_timeout(int fd, unsigned int timeout_ms) {
+	/*
+	 * The kernel takes the timeout in units of 10 ms, round it up.
+	 */
+	if (timeout_ms && ioctl(fd, I2C_TIMEOUT, (timeout_ms + 9) / 10) < 0) {
+		printf("%s: failed to set i2c adapter timeout\r\n", __func__);
+		return -errno;
+	}
+
+	return 0;
+}
+
+/*
+ * Do a SMBus transfer with a slave of an I2C bus file.
+ *
+ * @param fd file descriptor of the I2C bus
+ * @param slave points to the slave address the file is set to, updated
+ *  when the slave address is changed
+ * @param addr address of the I2C slave
+ * @param read_write I2C_SMBUS_READ or I2C_SMBUS_WRITE
+ * @param reg register of the transfer
+ * @param size kind of the transfer, eg: I2C_SMBUS_WORD_DATA
+ * @param data points to the data of the transfer
+ *
+ * @return - 0 if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+static int i2c_smbus_access(int fd, uint16_t *slave, uint16_t addr, char read_write,
+		uint8_t reg, int size, union i2c_smbus_data *data) {
+	struct i2c_smbus_ioctl_data args;
+
+	/*
+	 * SMBus transfers go to the slave address of the file, unlike the
+	 * messages of combined transactions.
+	 */
+	if (*slave != addr) {
+		if (ioctl(fd, I2C_SLAVE, addr) < 0) {
+			return -errno;
+		}
+
+		*slave = addr;
+	}
+
+	args.read_write = read_write;
+	args.command = reg;
+	args.size = size;
+	args.data = data;
+
+	if (ioctl(fd, I2C_SMBUS, &args) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+/*
+ * Do a SMBus transfer on behalf of an I2C device, or of an I2C bus with no
+ * device, serialized with the other users of the bus if it is shared.
+ *
+ * @param bus points to the started I2C bus, used if dev is NULL
+ * @param dev points to the started I2C device, or NULL
+ * @param addr address of the I2C slave
+ * @param read_write I2C_SMBUS_READ or I2C_SMBUS_WRITE
+ * @param reg register of the transfer
+ * @param size kind of the transfer, eg: I2C_SMBUS_WORD_DATA
+ * @param data points to the data of the transfer
+ * @param len length of the data of the transfer
+ *
+ * @return - 0 if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+static int i2c_smbus_xfer(struct I2cBus *bus, struct I2cDevice* dev, uint16_t addr,
+		char read_write, uint8_t reg, int size, union i2c_smbus_data *data, size_t len) {
+	unsigned int attempt = 0;
+	int rc;
+
+	(void)len; /* Only recorded by the statistics */
+
+	if (dev) {
+		bus = dev->bus;
+	}
+
+	BUS_STATS_START(start);
+
+	do {
+		if (bus) {
+			pthread_mutex_lock(&bus->lock);
+			BUS_STATS_START(bus_start);
+			rc = i2c_smbus_access(bus->fd, &bus->slave, addr, read_write, reg, size, data);
+			BUS_STATS_RECORD(&bus->stats, bus_start, rc < 0 ? rc : (long)len, len);
+			pthread_mutex_unlock(&bus->lock);
+		} else {
+			rc = i2c_smbus_access(dev->fd, &dev->slave, addr, read_write, reg, size, data);
+		}
+	} while (rc < 0 && i2c_retry(dev, rc, attempt++));
+
+	if (dev) {
+		BUS_STATS_RECORD(&dev->stats, start, rc < 0 ? rc : (long)len, len);
+	}
+
+	return rc;
+}
+
+/*
+ * Read data from a register through SMBus transfers, for adapters that
+ * cannot do combined I2C transactions, picking the cheapest transfer the
+ * adapter supports: a byte read, a word read, I2C block reads, or byte
+ * reads of consecutive registers.
+ *
+ * @param bus points to the started I2C bus, used if dev is NULL
+ * @param dev points to the started I2C device, or NULL
+ * @param addr address of the I2C slave
+ * @param reg the register to read from
+ * @param buf points to the start of buffer to be read into
+ * @param buf_len length of the buffer to be read
+ *
+ * @return - 0 if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+static int i2c_smbus_read(struct I2cBus *bus, struct I2cDevice* dev, uint16_t addr,
+		uint8_t reg, uint8_t *buf, size_t buf_len) {
+	unsigned long funcs = dev ? dev->funcs : bus->funcs;
+	union i2c_smbus_data data;
+	size_t offset;
+	size_t len;
+	int rc;
+
+	if (buf_len == 1 && (funcs & I2C_FUNC_SMBUS_READ_BYTE_DATA)) {
+		rc = i2c_smbus_xfer(bus, dev, addr, I2C_SMBUS_READ, reg,
+				I2C_SMBUS_BYTE_DATA, &data, 1);
+		buf[0] = data.byte;
+		return rc;
+	}
+
+	/*
+	 * SMBus words are sent low byte first, so this keeps the bytes in
+	 * the order they are on the bus.
+	 */
+	if (buf_len == 2 && (funcs & I2C_FUNC_SMBUS_READ_WORD_DATA)) {
+		rc = i2c_smbus_xfer(bus, dev, addr, I2C_SMBUS_READ, reg,
+				I2C_SMBUS_WORD_DATA, &data, 2);
+		buf[0] = data.word & 0xFF;
+		buf[1] = data.word >> 8;
+		return rc;
+	}
+
+	if (funcs & I2C_FUNC_SMBUS_READ_I2C_BLOCK) {
+		for (offset = 0; offset < buf_len; offset += len) {
+			len = buf_len - offset;
+			if (len > I2C_SMBUS_BLOCK_MAX) {
+				len = I2C_SMBUS_BLOCK_MAX;
+			}
+
+			data.block[0] = len;
+			rc = i2c_smbus_xfer(bus, dev, addr, I2C_SMBUS_READ, reg + offset,
+					I2C_SMBUS_I2C_BLOCK_DATA, &data, len);
+			if (rc < 0) {
+				return rc;
+			}
+
+			memcpy(buf + offset, &data.block[1], len);
+		}
+
+		return 0;
+	}
+
+	if (funcs & I2C_FUNC_SMBUS_READ_BYTE_DATA) {
+		for (offset = 0; offset < buf_len; offset++) {
+			rc = i2c_smbus_xfer(bus, dev, addr, I2C_SMBUS_READ, reg + offset,
+					I2C_SMBUS_BYTE_DATA, &data, 1);
+			if (rc < 0) {
+				return rc;
+			}
+
+			buf[offset] = data.byte;
+		}
+
+		return 0;
+	}
+
+	printf("%s: i2c adapter cannot read registers\r\n", __func__);
+	return -EOPNOTSUPP;
+}
+
+/*
+ * Write data to a register through SMBus transfers, for adapters that
+ * cannot do plain I2C transfers, picking the cheapest transfer the adapter
+ * supports: a byte write, a word write, I2C block writes, or byte writes of
+ * consecutive registers.
+ *
+ * @param dev points to the started I2C device
+ * @param reg the register to write to
+ * @param buf points to the start of buffer to be written from
+ * @param buf_len length of the buffer to be written
+ *
+ * @return - 0 if the write procedure succeeded
+ *         - negative if the write procedure failed
+ */
+static int i2c_smbus_write(struct I2cDevice* dev, uint8_t reg, uint8_t *buf, size_t buf_len) {
+	union i2c_smbus_data data;
+	size_t offset;
+	size_t len;
+	int rc;
+
+	if (buf_len == 1 && (dev->funcs & I2C_FUNC_SMBUS_WRITE_BYTE_DATA)) {
+		data.byte = buf[0];
+		return i2c_smbus_xfer(NULL, dev, dev->addr, I2C_SMBUS_WRITE, reg,
+				I2C_SMBUS_BYTE_DATA, &data, 1);
+	}
+
+	if (buf_len == 2 && (dev->funcs & I2C_FUNC_SMBUS_WRITE_WORD_DATA)) {
+		data.word = buf[0] | (buf[1] << 8);
+		return i2c_smbus_xfer(NULL, dev, dev->addr, I2C_SMBUS_WRITE, reg,
+				I2C_SMBUS_WORD_DATA, &data, 2);
+	}
+
+	if (dev->funcs & I2C_FUNC_SMBUS_WRITE_I2C_BLOCK) {
+		for (offset = 0; offset < buf_len; offset += len) {
+			len = buf_len - offset;
+			if (len > I2C_SMBUS_BLOCK_MAX) {
+				len = I2C_SMBUS_BLOCK_MAX;
+			}
+
+			data.block[0] = len;
+			memcpy(&data.block[1], buf + offset, len);
+			rc = i2c_smbus_xfer(NULL, dev, dev->addr, I2C_SMBUS_WRITE, reg + offset,
+					I2C_SMBUS_I2C_BLOCK_DATA, &data, len);
+			if (rc < 0) {
+				return rc;
+			}
+		}
+
+		return 0;
+	}
+
+	if (dev->funcs & I2C_FUNC_SMBUS_WRITE_BYTE_DATA) {
+		for (offset = 0; offset < buf_len; offset++) {
+			data.byte = buf[offset];
+			rc = i2c_smbus_xfer(NULL, dev, dev->addr, I2C_SMBUS_WRITE, reg + offset,
+					I2C_SMBUS_BYTE_DATA, &data, 1);
+			if (rc < 0) {
+				return rc;
+			}
+		}
+
+		return 0;
+	}
+
+	printf("%s: i2c adapter cannot write registers\r\n", __func__);
+	return -EOPNOTSUPP;
+}
+
 /*
  * Start the I2C device.
  *
- * @param dev points to the I2C device to be started, must have filename and addr populated
+ * @param dev points to the I2C device to be started, must have filename, addr,
+ *  scratch_len, cache, transport, timeout_ms, retries, retry_delay_us and
+ *  recover populated
  *
  * @return - 0 if the starting procedure succeeded
  *         - negative if the starting procedure failed
@@ -27,12 +470,25 @@ int i2c_start(struct I2cDevice* dev) {
 	int fd;
 	int rc;
 
+	dev->bus = NULL;
+	bus_stats_init(&dev->stats);
+
+	/*
+	 * Devices on a transport have no I2C bus file to open, and do
+	 * combined transactions.
+	 */
+	if (dev->transport) {
+		dev->fd = -1;
+		dev->funcs = I2C_FUNC_I2C;
+		return i2c_alloc_scratch(dev);
+	}
+
 	/*
 	 * Open the given I2C bus filename.
 	 */
 	fd = open(dev->filename, O_RDWR);
 	if (fd < 0) {
-		rc = fd;
+		rc = -errno;
 		goto fail_open;
 	}
 
@@ -41,13 +497,40 @@ int i2c_start(struct I2cDevice* dev) {
 	 */
 	rc = ioctl(fd, I2C_SLAVE, dev->addr);
 	if (rc < 0) {
+		rc = -errno;
 		goto fail_set_i2c_slave;
 	}
 
+	dev->slave = dev->addr;
+
+	/*
+	 * Get the transfers the adapter supports, once.
+	 */
+	rc = i2c_probe_funcs(fd, &dev->funcs);
+	if (rc < 0) {
+		goto fail_probe_funcs;
+	}
+
+	/*
+	 * Bound the time a hung transfer can block the bus.
+	 */
+	rc = i2c_set_timeout(fd, dev->timeout_ms);
+	if (rc < 0) {
+		goto fail_set_timeout;
+	}
+
+	rc = i2c_alloc_scratch(dev);
+	if (rc < 0) {
+		goto fail_alloc_scratch;
+	}
+
 	dev->fd = fd;
 
 	return 0;
 
+fail_alloc_scratch:
+fail_set_timeout:
+fail_probe_funcs:
 fail_set_i2c_slave:
 	close(fd);
 fail_open:
@@ -63,11 +546,23 @@ fail_open:
  * @param buf_len length of the buffer to be read
  *
  * @return - number of bytes read if the read procedure succeeded
- *         - 0 if no bytes were read
  *         - negative if the read procedure failed
  */
 int i2c_read(struct I2cDevice* dev, uint8_t *buf, size_t buf_len) {
-	return read(dev->fd, buf, buf_len);
+	struct i2c_msg msg;
+	int rc;
+
+	msg.addr = dev->addr;
+	msg.flags = I2C_M_RD;
+	msg.len = buf_len;
+	msg.buf = buf;
+
+	rc = i2c_transfer(dev, &msg, 1);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return buf_len;
 }
 
 /*
@@ -78,47 +573,181 @@ int i2c_read(struct I2cDevice* dev, uint8_t *buf, size_t buf_len) {
  * @param buf_len length of the buffer to be written
 
  * @return - number of bytes written if the write procedure succeeded
- *         - 0 if no bytes were written
- *         - negative if the read procedure failed
+ *         - negative if the write procedure failed
  */
 int i2c_write(struct I2cDevice* dev, uint8_t *buf, size_t buf_len) {
-	return write(dev->fd, buf, buf_len);
+	struct i2c_msg msg;
+	int rc;
+
+	msg.addr = dev->addr;
+	msg.flags = 0;
+	msg.len = buf_len;
+	msg.buf = buf;
+
+	rc = i2c_transfer(dev, &msg, 1);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return buf_len;
+}
+
+/*
+ * Transfer messages with the I2C bus in a single combined transaction.
+ *
+ * The messages are separated by repeated starts, with a single stop at
+ * the end, so no other master can access the bus in between. Each message
+ * carries its own slave address.
+ *
+ * Transfers failing with a transient error are retried within the retry
+ * budget of the device.
+ *
+ * @param dev points to the I2C device whose bus is used
+ * @param msgs points to the start of the messages to be transferred
+ * @param num_msgs number of messages, at most I2C_RDWR_IOCTL_MAX_MSGS
+ *
+ * @return - number of messages transferred if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+int i2c_transfer(struct I2cDevice* dev, struct i2c_msg *msgs, size_t num_msgs) {
+	struct i2c_rdwr_ioctl_data data;
+	unsigned int attempt = 0;
+	int rc;
+
+	BUS_STATS_START(start);
+
+	do {
+		if (dev->bus) {
+			rc = i2c_bus_transfer(dev->bus, msgs, num_msgs);
+		} else if (dev->transport) {
+			rc = i2c_transport_rdwr(dev->transport, msgs, num_msgs);
+		} else {
+			data.msgs = msgs;
+			data.nmsgs = num_msgs;
+
+			rc = ioctl(dev->fd, I2C_RDWR, &data);
+			if (rc < 0) {
+				rc = -errno;
+			}
+		}
+	} while (rc < 0 && i2c_retry(dev, rc, attempt++));
+
+	BUS_STATS_RECORD(&dev->stats, start, rc < 0 ? rc : (long)i2c_msgs_len(msgs, rc),
+			i2c_msgs_len(msgs, num_msgs));
+
+	return rc;
+}
+
+/*
+ * Read data from multiple registers, possibly of multiple I2C slaves
+ * sharing the bus of the I2C device.
+ *
+ * Each register read is a register address write followed by a data read.
+ * As many reads as fit are packed into each combined transaction.
+ *
+ * @param dev points to the I2C device whose bus is used
+ * @param reads points to the start of the register reads to be done
+ * @param num_reads number of register reads
+ *
+ * @return - 0 if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+int i2c_read_regs(struct I2cDevice* dev, struct I2cRegRead *reads, size_t num_reads) {
+	struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+	size_t num_msgs;
+	size_t i;
+	int rc;
+
+	/*
+	 * Adapters that cannot do combined transactions read each register
+	 * through SMBus transfers.
+	 */
+	if (!(dev->funcs & I2C_FUNC_I2C)) {
+		for (i = 0; i < num_reads; i++) {
+			rc = i2c_smbus_read(NULL, dev, reads[i].addr, reads[i].reg, reads[i].buf,
+					reads[i].buf_len);
+			if (rc < 0) {
+				printf("%s: failed to read i2c registers\r\n", __func__);
+				return rc;
+			}
+		}
+
+		return 0;
+	}
+
+	num_msgs = 0;
+	for (i = 0; i < num_reads; i++) {
+		num_msgs += i2c_pack_reg_read(&msgs[num_msgs], &reads[i]);
+
+		/*
+		 * Transfer the queued messages once no other read fits,
+		 * or once all the reads have been queued.
+		 */
+		if (num_msgs + 2 > I2C_RDWR_IOCTL_MAX_MSGS || i == num_reads - 1) {
+			rc = i2c_transfer(dev, msgs, num_msgs);
+			if (rc < 0) {
+				printf("%s: failed to read i2c registers\r\n", __func__);
+				return rc;
+			}
+
+			num_msgs = 0;
+		}
+	}
+
+	return 0;
 }
 
 /*
  * Read data from a register of the I2C device.
  *
+ * The register address write and the data read are done in a single
+ * combined transaction.
+ *
  * @param dev points to the I2C device to be read from
  * @param reg the register to read from
  * @param buf points to the start of buffer to be read into
  * @param buf_len length of the buffer to be read
  *
  * @return - number of bytes read if the read procedure succeeded
- *         - 0 if no bytes were read
  *         - negative if the read procedure failed
  */
 int i2c_readn_reg(struct I2cDevice* dev, uint8_t reg, uint8_t *buf, size_t buf_len) {
+	struct I2cRegRead read;
 	int rc;
 
-	/*
-	 * Write the I2C register address.
-	 */
-	rc = i2c_write(dev, &reg, 1);
-	if (rc <= 0) {
-		printf("%s: failed to write i2c register address\r\n", __func__);
-		return rc;
-	}
+	read.addr = dev->addr;
+	read.reg = reg;
+	read.buf = buf;
+	read.buf_len = buf_len;
 
 	/*
-	 * Read the I2C register data.
+	 * Write the I2C register address and read the I2C register data.
 	 */
-	rc = i2c_read(dev, buf, buf_len);
-	if (rc <= 0) {
+	rc = i2c_read_regs(dev, &read, 1);
+	if (rc < 0) {
 		printf("%s: failed to read i2c register data\r\n", __func__);
 		return rc;
 	}
 
-	return rc;
+	return buf_len;
+}
+
+/*
+ * Forget the cached values of registers being written.
+ *
+ * @param dev points to the I2C device being written to
+ * @param reg the first register being written
+ * @param len number of registers being written
+ */
+static void i2c_cache_forget(struct I2cDevice* dev, uint8_t reg, size_t len) {
+	size_t i;
+
+	if (dev->cache) {
+		for (i = 0; i < len && reg + i < 256; i++) {
+			I2C_CACHE_CLEAR(dev->cache->valid, reg + i);
+			I2C_CACHE_CLEAR(dev->cache->dirty, reg + i);
+		}
+	}
 }
 
 /*
@@ -134,22 +763,42 @@ int i2c_readn_reg(struct I2cDevice* dev, uint8_t reg, uint8_t *buf, size_t buf_l
  *         - negative if the write procedure failed
  */
 int i2c_writen_reg(struct I2cDevice* dev, uint8_t reg, uint8_t *buf, size_t buf_len) {
+	uint8_t stack_buf[I2C_FRAME_STACK_LEN];
 	uint8_t *full_buf;
-	int full_buf_len;
+	size_t full_buf_len;
 	int rc;
-	int i;
+
+	if (!(dev->funcs & I2C_FUNC_I2C)) {
+		i2c_cache_forget(dev, reg, buf_len);
+
+		rc = i2c_smbus_write(dev, reg, buf, buf_len);
+		if (rc < 0) {
+			printf("%s: failed to write i2c register data\r\n", __func__);
+			return rc;
+		}
+
+		return 0;
+	}
 
 	/*
-	 * Allocate a buffer that also contains the register address as
-	 * the first element.
+	 * Pick a buffer that can also contain the register address as
+	 * the first element, the stack for short frames and the scratch
+	 * buffer of the device for long ones.
 	 */
 	full_buf_len = buf_len + 1;
-	full_buf = malloc(sizeof(uint8_t) * full_buf_len);
+	if (full_buf_len <= sizeof(stack_buf)) {
+		full_buf = stack_buf;
+	} else if (full_buf_len <= dev->scratch_len) {
+		full_buf = dev->scratch;
+	} else {
+		printf("%s: i2c register data does not fit in scratch buffer\r\n", __func__);
+		return -EMSGSIZE;
+	}
 
 	full_buf[0] = reg;
-	for (i = 0; i < buf_len; i++) {
-		full_buf[i + 1] = buf[i];
-	}
+	memcpy(full_buf + 1, buf, buf_len);
+
+	i2c_cache_forget(dev, reg, buf_len);
 
 	/*
 	 * Write the I2C register address and data.
@@ -157,20 +806,52 @@ int i2c_writen_reg(struct I2cDevice* dev, uint8_t reg, uint8_t *buf, size_t buf_
 	rc = i2c_write(dev, full_buf, full_buf_len);
 	if (rc <= 0) {
 		printf("%s: failed to write i2c register address and data\r\n", __func__);
-		goto fail_send;
+		return rc;
 	}
 
-	free(full_buf);
 	return 0;
-
-fail_send:
-	free(full_buf);
-	return rc;
 }
 
 /*
  * Read value from a register of the I2C device.
  *
+ * Cached registers are only read from the bus the first time.
+ *
+ * @param dev points to the I2C device to be read from
+ * @param reg the register to read from
+ * @param value is set to the value read from the register, 0 if the read
+ *  procedure failed
+ *
+ * @return - 0 if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+int i2c_get_reg(struct I2cDevice* dev, uint8_t reg, uint8_t *value) {
+	struct I2cRegCache *cache = dev->cache;
+	int rc;
+
+	if (cache && (cache->policy[reg] & I2C_REG_CACHE) && I2C_CACHE_TEST(cache->valid, reg)) {
+		*value = cache->value[reg];
+		return 0;
+	}
+
+	rc = i2c_readn_reg(dev, reg, value, 1);
+	if (rc < 0) {
+		*value = 0;
+		return rc;
+	}
+
+	if (cache && (cache->policy[reg] & I2C_REG_CACHE)) {
+		cache->value[reg] = *value & ~cache->self_clear[reg];
+		I2C_CACHE_SET(cache->valid, reg);
+	}
+
+	return 0;
+}
+
+/*
+ * Read value from a register of the I2C device, without telling a failed
+ * read apart from a register holding 0, see i2c_get_reg.
+ *
  * @param dev points to the I2C device to be read from
  * @param reg the register to read from
  *
@@ -178,8 +859,10 @@ fail_send:
  *         - 0 if the read procedure failed
  */
 uint8_t i2c_read_reg(struct I2cDevice* dev, uint8_t reg) {
-	uint8_t value = 0;
-	i2c_readn_reg(dev, reg, &value, 1);
+	uint8_t value;
+
+	i2c_get_reg(dev, reg, &value);
+
 	return value;
 }
 
@@ -195,7 +878,32 @@ uint8_t i2c_read_reg(struct I2cDevice* dev, uint8_t reg) {
  *         - negative if the write procedure failed
  */
 int i2c_write_reg(struct I2cDevice* dev, uint8_t reg, uint8_t value) {
-	return i2c_writen_reg(dev, reg, &value, 1);
+	struct I2cRegCache *cache = dev->cache;
+	int rc;
+
+	if (!cache || !cache->policy[reg]) {
+		return i2c_writen_reg(dev, reg, &value, 1);
+	}
+
+	/*
+	 * Keep write-back registers in the cache until flushed.
+	 */
+	if (cache->policy[reg] & I2C_REG_WRITE_BACK) {
+		cache->value[reg] = value;
+		I2C_CACHE_SET(cache->valid, reg);
+		I2C_CACHE_SET(cache->dirty, reg);
+		return 0;
+	}
+
+	rc = i2c_writen_reg(dev, reg, &value, 1);
+	if (rc < 0) {
+		return rc;
+	}
+
+	cache->value[reg] = value & ~cache->self_clear[reg];
+	I2C_CACHE_SET(cache->valid, reg);
+
+	return rc;
 }
 
 /*
@@ -213,7 +921,11 @@ int i2c_mask_reg(struct I2cDevice* dev, uint8_t reg, uint8_t mask) {
 	uint8_t value = 0;
 	int rc;
 
-	value = i2c_read_reg(dev, reg);
+	rc = i2c_get_reg(dev, reg, &value);
+	if (rc < 0) {
+		return rc;
+	}
+
 	value |= mask;
 
 	rc = i2c_write_reg(dev, reg, value);
@@ -231,7 +943,491 @@ int i2c_mask_reg(struct I2cDevice* dev, uint8_t reg, uint8_t mask) {
  */
 void i2c_stop(struct I2cDevice* dev) {
 	/*
-	 * Close the I2C bus file descriptor.
+	 * Close the I2C bus file descriptor, unless it is shared or there is none.
+	 */
+	if (!dev->bus && !dev->transport) {
+		close(dev->fd);
+	}
+
+	free(dev->scratch);
+}
+
+/*
+ * Initialize a register cache, with all the registers volatile.
+ *
+ * @param cache points to the register cache to be initialized
+ */
+void i2c_cache_init(struct I2cRegCache *cache) {
+	memset(cache, 0, sizeof(*cache));
+}
+
+/*
+ * Set the cache policy of a register.
+ *
+ * @param cache points to the register cache
+ * @param reg the register
+ * @param policy the policy, a combination of I2C_REG_CACHE and
+ *  I2C_REG_WRITE_BACK, or 0 for a volatile register
+ */
+void i2c_cache_set_policy(struct I2cRegCache *cache, uint8_t reg, uint8_t policy) {
+	if (policy & I2C_REG_WRITE_BACK) {
+		policy |= I2C_REG_CACHE;
+	}
+
+	cache->policy[reg] = policy;
+	if (!policy) {
+		I2C_CACHE_CLEAR(cache->valid, reg);
+	}
+}
+
+/*
+ * Set the bits of a register that the device clears by itself once it acted
+ * upon them, eg: a bit starting a conversion. These bits are written to the
+ * device, but never kept set in the cache, so that later read-modify-writes
+ * served from the cache do not set them again.
+ *
+ * @param cache points to the register cache
+ * @param reg the register
+ * @param mask the self-clearing bits
+ */
+void i2c_cache_set_self_clear(struct I2cRegCache *cache, uint8_t reg, uint8_t mask) {
+	cache->self_clear[reg] = mask;
+	cache->value[reg] &= ~mask;
+}
+
+/*
+ * Forget all the cached register values, eg: after a reset of the device.
+ * Values not flushed yet are lost.
+ *
+ * @param cache points to the register cache
+ */
+void i2c_cache_invalidate(struct I2cRegCache *cache) {
+	memset(cache->valid, 0, sizeof(cache->valid));
+	memset(cache->dirty, 0, sizeof(cache->dirty));
+}
+
+/*
+ * Write the write-back registers changed in the cache to the I2C device,
+ * batched in as few combined transactions as possible.
+ *
+ * @param dev points to the I2C device to be flushed
+ *
+ * @return - 0 if the flush procedure succeeded
+ *         - negative if the flush procedure failed
+ */
+int i2c_cache_flush(struct I2cDevice* dev) {
+	struct I2cRegCache *cache = dev->cache;
+	struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+	uint8_t bufs[I2C_RDWR_IOCTL_MAX_MSGS][2];
+	size_t num_msgs = 0;
+	int reg;
+	int rc;
+
+	if (!cache) {
+		return 0;
+	}
+
+	/*
+	 * Adapters that cannot do combined transactions write each register
+	 * through a SMBus transfer.
+	 */
+	if (!(dev->funcs & I2C_FUNC_I2C)) {
+		for (reg = 0; reg < 256; reg++) {
+			if (!I2C_CACHE_TEST(cache->dirty, reg)) {
+				continue;
+			}
+
+			rc = i2c_smbus_write(dev, reg, &cache->value[reg], 1);
+			if (rc < 0) {
+				printf("%s: failed to flush i2c registers\r\n", __func__);
+				return rc;
+			}
+
+			I2C_CACHE_CLEAR(cache->dirty, reg);
+			cache->value[reg] &= ~cache->self_clear[reg];
+		}
+
+		return 0;
+	}
+
+	for (reg = 0; reg < 256; reg++) {
+		if (I2C_CACHE_TEST(cache->dirty, reg)) {
+			/*
+			 * Queue a write of the register address and value.
+			 */
+			bufs[num_msgs][0] = reg;
+			bufs[num_msgs][1] = cache->value[reg];
+			msgs[num_msgs].addr = dev->addr;
+			msgs[num_msgs].flags = 0;
+			msgs[num_msgs].len = 2;
+			msgs[num_msgs].buf = bufs[num_msgs];
+			num_msgs++;
+		}
+
+		if (num_msgs && (num_msgs == I2C_RDWR_IOCTL_MAX_MSGS || reg == 255)) {
+			rc = i2c_transfer(dev, msgs, num_msgs);
+			if (rc < 0) {
+				printf("%s: failed to flush i2c registers\r\n", __func__);
+				return rc;
+			}
+
+			/*
+			 * Mark the written registers clean, their self-clearing
+			 * bits cleared by the device.
+			 */
+			while (num_msgs) {
+				num_msgs--;
+				I2C_CACHE_CLEAR(cache->dirty, bufs[num_msgs][0]);
+				cache->value[bufs[num_msgs][0]] &= ~cache->self_clear[bufs[num_msgs][0]];
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Start the I2C bus.
+ *
+ * @param bus points to the I2C bus to be started, must have filename,
+ *  transport and timeout_ms populated
+ *
+ * @return - 0 if the starting procedure succeeded
+ *         - negative if the starting procedure failed
+ */
+int i2c_bus_start(struct I2cBus *bus) {
+	int fd = -1;
+	int rc;
+
+	/*
+	 * Open the given I2C bus filename, get the transfers its adapter
+	 * supports and bound its timeout, unless the bus is on a transport.
+	 */
+	bus->funcs = I2C_FUNC_I2C;
+	bus->slave = I2C_NO_SLAVE;
+
+	if (!bus->transport) {
+		fd = open(bus->filename, O_RDWR);
+		if (fd < 0) {
+			printf("%s: failed to open i2c bus\r\n", __func__);
+			return -errno;
+		}
+
+		rc = i2c_probe_funcs(fd, &bus->funcs);
+		if (rc < 0) {
+			close(fd);
+			return rc;
+		}
+
+		rc = i2c_set_timeout(fd, bus->timeout_ms);
+		if (rc < 0) {
+			close(fd);
+			return rc;
+		}
+	}
+
+	pthread_mutex_init(&bus->lock, NULL);
+	pthread_mutex_init(&bus->pending_lock, NULL);
+	bus->num_pending = 0;
+	bus_stats_init(&bus->stats);
+	bus->fd = fd;
+
+	return 0;
+}
+
+/*
+ * Start an I2C device on a shared I2C bus.
+ *
+ * The device addresses its slave per message, so no I2C_SLAVE switching
+ * is needed between the devices of the bus. The device must be stopped
+ * with i2c_stop before the bus is stopped.
+ *
+ * @param bus points to the started I2C bus
+ * @param dev points to the I2C device to be started, must have addr,
+ *  scratch_len, cache, retries, retry_delay_us and recover populated
+ *
+ * @return - 0 if the starting procedure succeeded
+ *         - negative if the starting procedure failed
+ */
+int i2c_bus_add_device(struct I2cBus *bus, struct I2cDevice* dev) {
+	int rc;
+
+	rc = i2c_alloc_scratch(dev);
+	if (rc < 0) {
+		return rc;
+	}
+
+	bus_stats_init(&dev->stats);
+	dev->filename = bus->filename;
+	dev->fd = bus->fd;
+	dev->transport = bus->transport;
+	dev->funcs = bus->funcs;
+	dev->bus = bus;
+
+	return 0;
+}
+
+/*
+ * Transfer messages with the I2C bus in a single combined transaction,
+ * serialized with the transfers of the other threads using the bus.
+ *
+ * @param bus points to the I2C bus to be used
+ * @param msgs points to the start of the messages to be transferred
+ * @param num_msgs number of messages, at most I2C_RDWR_IOCTL_MAX_MSGS
+ *
+ * @return - number of messages transferred if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+int i2c_bus_transfer(struct I2cBus *bus, struct i2c_msg *msgs, size_t num_msgs) {
+	struct i2c_rdwr_ioctl_data data;
+	int rc;
+
+	data.msgs = msgs;
+	data.nmsgs = num_msgs;
+
+	pthread_mutex_lock(&bus->lock);
+	BUS_STATS_START(start);
+	if (bus->transport) {
+		rc = i2c_transport_rdwr(bus->transport, msgs, num_msgs);
+	} else {
+		rc = ioctl(bus->fd, I2C_RDWR, &data);
+		if (rc < 0) {
+			rc = -errno;
+		}
+	}
+	BUS_STATS_RECORD(&bus->stats, start, rc < 0 ? rc : (long)i2c_msgs_len(msgs, rc),
+			i2c_msgs_len(msgs, num_msgs));
+	pthread_mutex_unlock(&bus->lock);
+
+	return rc;
+}
+
+/*
+ * Queue a register read on the I2C bus, to be done on the next flush
+ * together with the other pending register reads.
+ *
+ * @param bus points to the I2C bus to be used
+ * @param read points to the register read, must stay valid until the flush
+ *
+ * @return - 0 if the queueing procedure succeeded
+ *         - negative if too many register reads are pending
+ */
+int i2c_bus_queue_read(struct I2cBus *bus, struct I2cRegRead *read) {
+	int rc = 0;
+
+	pthread_mutex_lock(&bus->pending_lock);
+	if (bus->num_pending < I2C_BUS_MAX_PENDING) {
+		bus->pending[bus->num_pending++] = read;
+	} else {
+		rc = -ENOBUFS;
+	}
+	pthread_mutex_unlock(&bus->pending_lock);
+
+	return rc;
+}
+
+/*
+ * Do register reads one at a time on the I2C bus, to find out which of the
+ * reads of a failed combined transaction failed.
+ *
+ * @param bus points to the I2C bus to be used
+ * @param reads points to the start of the register reads to be done
+ * @param num_reads number of register reads
+ *
+ * @return - 0 if all the reads succeeded
+ *         - negative if some read failed, the error of the first one
+ */
+static int i2c_bus_read_each(struct I2cBus *bus, struct I2cRegRead **reads, size_t num_reads) {
+	struct i2c_msg msgs[2];
+	int result = 0;
+	size_t i;
+	int rc;
+
+	for (i = 0; i < num_reads; i++) {
+		if (!(bus->funcs & I2C_FUNC_I2C)) {
+			rc = i2c_smbus_read(bus, NULL, reads[i]->addr, reads[i]->reg, reads[i]->buf,
+					reads[i]->buf_len);
+		} else {
+			i2c_pack_reg_read(msgs, reads[i]);
+			rc = i2c_bus_transfer(bus, msgs, 2);
+		}
+
+		reads[i]->status = rc < 0 ? rc : 0;
+		if (rc < 0 && !result) {
+			result = rc;
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Do all the pending register reads of the I2C bus, coalesced across
+ * devices into as few combined transactions as possible.
+ *
+ * When a combined transaction fails, its reads are done again one at a
+ * time, so that the status of each read tells whether it failed, eg: on a
+ * slave that does not acknowledge, and the reads of the other slaves still
+ * complete.
+ *
+ * @param bus points to the I2C bus to be flushed
+ *
+ * @return - 0 if all the reads succeeded
+ *         - negative if some read failed, the error of the first one
+ */
+int i2c_bus_flush(struct I2cBus *bus) {
+	struct I2cRegRead *reads[I2C_BUS_MAX_PENDING];
+	struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+	size_t num_reads;
+	size_t num_msgs;
+	size_t first;
+	int result = 0;
+	size_t i;
+	int rc;
+
+	/*
+	 * Take the pending register reads, so that new ones can be queued
+	 * while these are being done.
 	 */
-	close(dev->fd);
+	pthread_mutex_lock(&bus->pending_lock);
+	num_reads = bus->num_pending;
+	memcpy(reads, bus->pending, num_reads * sizeof(*reads));
+	bus->num_pending = 0;
+	pthread_mutex_unlock(&bus->pending_lock);
+
+	if (!(bus->funcs & I2C_FUNC_I2C)) {
+		result = i2c_bus_read_each(bus, reads, num_reads);
+		if (result < 0) {
+			printf("%s: failed to read i2c registers\r\n", __func__);
+		}
+
+		return result;
+	}
+
+	num_msgs = 0;
+	first = 0;
+	for (i = 0; i < num_reads; i++) {
+		num_msgs += i2c_pack_reg_read(&msgs[num_msgs], reads[i]);
+
+		if (num_msgs + 2 > I2C_RDWR_IOCTL_MAX_MSGS || i == num_reads - 1) {
+			rc = i2c_bus_transfer(bus, msgs, num_msgs);
+			if (rc < 0) {
+				rc = i2c_bus_read_each(bus, &reads[first], i + 1 - first);
+			} else {
+				for (; first <= i; first++) {
+					reads[first]->status = 0;
+				}
+			}
+
+			if (rc < 0 && !result) {
+				printf("%s: failed to read i2c registers\r\n", __func__);
+				result = rc;
+			}
+
+			num_msgs = 0;
+			first = i + 1;
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Stop the I2C bus.
+ *
+ * @param bus points to the I2C bus to be stopped
+ */
+void i2c_bus_stop(struct I2cBus *bus) {
+	if (!bus->transport) {
+		close(bus->fd);
+	}
+
+	pthread_mutex_destroy(&bus->lock);
+	pthread_mutex_destroy(&bus->pending_lock);
+}
+
+static int i2c_transport_open(struct Transport *transport) {
+	return i2c_bus_start(transport->priv);
+}
+
+static int i2c_transport_batch(struct Transport *transport, struct TransportSegment *segs,
+		size_t num_segs) {
+	struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+	size_t i;
+
+	if (num_segs > I2C_RDWR_IOCTL_MAX_MSGS) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < num_segs; i++) {
+		msgs[i].addr = segs[i].addr;
+		msgs[i].flags = segs[i].read_buf ? I2C_M_RD : 0;
+		msgs[i].buf = segs[i].read_buf ? segs[i].read_buf : (uint8_t *)segs[i].write_buf;
+		msgs[i].len = segs[i].len;
+	}
+
+	return i2c_bus_transfer(transport->priv, msgs, num_segs);
+}
+
+static void i2c_transport_close(struct Transport *transport) {
+	i2c_bus_stop(transport->priv);
+}
+
+const struct TransportOps i2c_transport_ops = {
+	.name = "i2c",
+	.open = i2c_transport_open,
+	.batch = i2c_transport_batch,
+	.close = i2c_transport_close,
+};
+
+static int i2c_async_run_readn_reg(struct AsyncRequest *req) {
+	return i2c_readn_reg(req->dev, req->reg, req->read_buf, req->len);
+}
+
+static int i2c_async_run_writen_reg(struct AsyncRequest *req) {
+	return i2c_writen_reg(req->dev, req->reg, req->write_buf, req->len);
+}
+
+/*
+ * Prepare an asynchronous i2c_readn_reg, to be submitted to the worker of
+ * the I2C bus with async_submit.
+ *
+ * @param req points to the request to be prepared, having complete and
+ *  priv populated
+ * @param dev points to the started I2C device
+ * @param reg register to read from
+ * @param buf points to the start of buffer to be read into,
+ *  must stay valid until the request completes
+ * @param buf_len length of the buffer to be read
+ */
+void i2c_async_readn_reg(struct AsyncRequest *req, struct I2cDevice* dev, uint8_t reg,
+		uint8_t *buf, size_t buf_len) {
+	req->run = i2c_async_run_readn_reg;
+	req->dev = dev;
+	req->reg = reg;
+	req->write_buf = NULL;
+	req->read_buf = buf;
+	req->len = buf_len;
+}
+
+/*
+ * Prepare an asynchronous i2c_writen_reg, to be submitted to the worker of
+ * the I2C bus with async_submit.
+ *
+ * @param req points to the request to be prepared, having complete and
+ *  priv populated
+ * @param dev points to the started I2C device
+ * @param reg register to write to
+ * @param buf points to the start of buffer to be written from,
+ *  must stay valid until the request completes
+ * @param buf_len length of the buffer to be written
+ */
+void i2c_async_writen_reg(struct AsyncRequest *req, struct I2cDevice* dev, uint8_t reg,
+		uint8_t *buf, size_t buf_len) {
+	req->run = i2c_async_run_writen_reg;
+	req->dev = dev;
+	req->reg = reg;
+	req->write_buf = buf;
+	req->read_buf = NULL;
+	req->len = buf_len;
 }
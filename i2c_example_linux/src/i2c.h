@@ -5,29 +5,187 @@
  * @author Cosmin Tanislav
  */
 
+#include <linux/i2c.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "transport.h"
+#include "bus_stats.h"
+#include "async.h"
+
 #ifndef SRC_I2C_H_
 #define SRC_I2C_H_
 
+/*
+ * Maximum length of a register write frame built on the stack.
+ * Longer frames are built in the scratch buffer of the I2C device.
+ */
+#define I2C_FRAME_STACK_LEN 32
+
+/*
+ * Maximum number of register reads that can be pending on an I2C bus.
+ */
+#define I2C_BUS_MAX_PENDING 64
+
+/*
+ * Slave address of an I2C bus file not set to any slave yet.
+ */
+#define I2C_NO_SLAVE 0xFFFF
+
+/*
+ * Largest shift of the retry delay, bounding the backoff of a transfer
+ * to retry_delay_us << I2C_MAX_BACKOFF_SHIFT.
+ */
+#define I2C_MAX_BACKOFF_SHIFT 6
+
+struct I2cRegRead;
+
+/*
+ * Register cache policies, to be combined.
+ * Registers with no policy are volatile, always accessed on the bus.
+ */
+#define I2C_REG_CACHE 0b00000001 /**< Reads are served from the cache, writes go through */
+#define I2C_REG_WRITE_BACK 0b00000010 /**< Writes stay in the cache until flushed */
+
+/*
+ * Shadow copy of the registers of an I2C device.
+ */
+struct I2cRegCache {
+	uint8_t policy[256]; /**< Policy of each register */
+	uint8_t self_clear[256]; /**< Bits of each register the device clears by itself, never cached as set */
+	uint8_t value[256]; /**< Cached value of each register */
+	uint8_t valid[256 / 8]; /**< Bitmap of the registers with a cached value */
+	uint8_t dirty[256 / 8]; /**< Bitmap of the registers written in the cache only */
+};
+
+/*
+ * I2C bus shared by multiple I2C devices through a single file descriptor.
+ */
+struct I2cBus {
+	char* filename; /**< Path of the I2C bus, eg: /dev/i2c-0 */
+	struct Transport *transport; /**< Opened transport to use instead of filename, NULL for none */
+	unsigned int timeout_ms; /**< Time after which the adapter gives up on a hung transfer, in 10 ms steps, 0 for the adapter default */
+
+	int fd; /**< File descriptor for the I2C bus */
+	pthread_mutex_t lock; /**< Serializes the transfers on the I2C bus */
+	pthread_mutex_t pending_lock; /**< Protects the pending register reads */
+	struct I2cRegRead *pending[I2C_BUS_MAX_PENDING]; /**< Register reads waiting for a flush */
+	size_t num_pending; /**< Number of pending register reads */
+	unsigned long funcs; /**< Transfers supported by the adapter of the bus, I2C_FUNC_* */
+	uint16_t slave; /**< Slave address the bus file is set to for SMBus transfers */
+	struct BusStats stats; /**< Statistics of the transactions on the bus, excluding the waits for the bus */
+};
+
 /*
  * Configuration for the I2C device.
  */
 struct I2cDevice {
 	char* filename; /**< Path of the I2C bus, eg: /dev/i2c-0 */
 	uint16_t addr; /**< Address of the I2C slave, eg: 0x48 */
+	size_t scratch_len; /**< Length of the scratch buffer for long register writes, 0 for none */
+	struct I2cRegCache *cache; /**< Initialized register cache, NULL for none */
+	struct Transport *transport; /**< Opened transport to use instead of filename, NULL for none */
+	unsigned int timeout_ms; /**< Time after which the adapter gives up on a hung transfer, in 10 ms steps, 0 for the adapter default, set on the bus if shared */
+	unsigned int retries; /**< Number of times a transfer failing with a transient error is retried */
+	unsigned int retry_delay_us; /**< Delay before the first retry, doubled for each following one */
+	int (*recover)(struct I2cDevice* dev); /**< Called after a transfer timed out, before retrying it, eg: to clock out a stuck slave, NULL for none */
 
 	int fd; /**< File descriptor for the I2C bus */
+	struct I2cBus *bus; /**< Shared I2C bus, NULL if the device owns its file descriptor */
+	uint8_t *scratch; /**< Scratch buffer allocated when starting the device */
+	unsigned long funcs; /**< Transfers supported by the adapter of the bus, I2C_FUNC_* */
+	uint16_t slave; /**< Slave address the bus file is set to for SMBus transfers, if not shared */
+	struct BusStats stats; /**< Statistics of the transactions of the device */
+};
+
+/*
+ * Register read to be batched with other register reads in a single
+ * combined transaction.
+ */
+struct I2cRegRead {
+	uint16_t addr; /**< Address of the I2C slave to read from, eg: 0x48 */
+	uint8_t reg; /**< Register to read from */
+	uint8_t *buf; /**< Buffer to read the register data into */
+	uint16_t buf_len; /**< Length of the buffer to be read */
+	int status; /**< Result of the read once flushed with i2c_bus_flush, 0 or negative */
 };
 
 int i2c_start(struct I2cDevice* dev);
 int i2c_read(struct I2cDevice* dev, uint8_t *buf, size_t buf_len);
 int i2c_write(struct I2cDevice* dev, uint8_t *buf, size_t buf_len);
+int i2c_transfer(struct I2cDevice* dev, struct i2c_msg *msgs, size_t num_msgs);
+int i2c_read_regs(struct I2cDevice* dev, struct I2cRegRead *reads, size_t num_reads);
 int i2c_readn_reg(struct I2cDevice* dev, uint8_t reg, uint8_t *buf, size_t buf_len);
 int i2c_writen_reg(struct I2cDevice* dev, uint8_t reg, uint8_t *buf, size_t buf_len);
+int i2c_get_reg(struct I2cDevice* dev, uint8_t reg, uint8_t *value);
 uint8_t i2c_read_reg(struct I2cDevice* dev, uint8_t reg);
 int i2c_write_reg(struct I2cDevice* dev, uint8_t reg, uint8_t value);
 int i2c_mask_reg(struct I2cDevice* dev, uint8_t reg, uint8_t mask);
 void i2c_stop(struct I2cDevice* dev);
 
+/*
+ * Expand a register map (see regmap.h) into I2C accessors: prefix_read_reg
+ * and prefix_write_reg for each register, prefix_read_field and
+ * prefix_write_field for each field, the latter going through the
+ * register cache when the register is cached. A field is only written if
+ * its register could be read.
+ */
+#define I2C_REGMAP_REG(p, REG, reg, addr, width) \
+	static inline int p##_read_##reg(struct I2cDevice* dev, uint8_t *buf) { \
+		return i2c_readn_reg(dev, REG, buf, width); \
+	} \
+	static inline int p##_write_##reg(struct I2cDevice* dev, uint8_t *buf) { \
+		return i2c_writen_reg(dev, REG, buf, width); \
+	}
+#define I2C_REGMAP_FIELD(p, REG, reg, FIELD, field, shift, bits) \
+	static inline int p##_read_##field(struct I2cDevice* dev, uint8_t *value) { \
+		int rc = i2c_get_reg(dev, REG, value); \
+		*value = p##_get_##field(*value); \
+		return rc; \
+	} \
+	static inline int p##_write_##field(struct I2cDevice* dev, uint8_t value) { \
+		uint8_t reg_value; \
+		int rc = i2c_get_reg(dev, REG, &reg_value); \
+		if (rc < 0) { \
+			return rc; \
+		} \
+		return i2c_write_reg(dev, REG, p##_set_##field(reg_value, value)); \
+	}
+
+/*
+ * Burst read function of the I2C backend, for regmap_read_merged.
+ */
+static inline int i2c_regmap_read(void *dev, uint8_t reg, uint8_t *buf, size_t buf_len) {
+	return i2c_readn_reg(dev, reg, buf, buf_len);
+}
+
+void i2c_cache_init(struct I2cRegCache *cache);
+void i2c_cache_set_policy(struct I2cRegCache *cache, uint8_t reg, uint8_t policy);
+void i2c_cache_set_self_clear(struct I2cRegCache *cache, uint8_t reg, uint8_t mask);
+void i2c_cache_invalidate(struct I2cRegCache *cache);
+int i2c_cache_flush(struct I2cDevice* dev);
+
+int i2c_bus_start(struct I2cBus *bus);
+int i2c_bus_add_device(struct I2cBus *bus, struct I2cDevice* dev);
+int i2c_bus_transfer(struct I2cBus *bus, struct i2c_msg *msgs, size_t num_msgs);
+int i2c_bus_queue_read(struct I2cBus *bus, struct I2cRegRead *read);
+int i2c_bus_flush(struct I2cBus *bus);
+void i2c_bus_stop(struct I2cBus *bus);
+
+/*
+ * Transport backend on a real I2C bus, with an I2C bus as private data,
+ * having filename populated and no transport.
+ */
+extern const struct TransportOps i2c_transport_ops;
+
+/*
+ * Asynchronous register accesses, run by the worker of the I2C bus
+ * (see async.h). All the devices of a bus must use the same worker.
+ */
+void i2c_async_readn_reg(struct AsyncRequest *req, struct I2cDevice* dev, uint8_t reg,
+		uint8_t *buf, size_t buf_len);
+void i2c_async_writen_reg(struct AsyncRequest *req, struct I2cDevice* dev, uint8_t reg,
+		uint8_t *buf, size_t buf_len);
+
 #endif /* SRC_I2C_H_ */
@@ -6,73 +6,255 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
+#include <string.h>
 
 #include "i2c.h"
+#include "tmp3.h"
+#include "acq.h"
+#ifdef SIM
+#include "sim.h"
+#include "tmp3_sim.h"
+#endif
 
-#define TEMP_REG 0x0
-#define CONFIG_REG 0x1
+/*
+ * Addresses of the PmodTMP3 devices on the I2C bus.
+ */
+static const uint16_t tmp3_addrs[] = { 0x48 };
+
+#define NUM_TMP3 (sizeof(tmp3_addrs) / sizeof(tmp3_addrs[0]))
+
+/*
+ * SCHED_FIFO priority of the worker of the I2C bus, eg: 80 for real-time
+ * sweeps, 0 for the default scheduling.
+ */
+#define TMP3_WORKER_PRIORITY 0
+
+/*
+ * Sample published for each PmodTMP3 device by the sweep task.
+ */
+struct Tmp3Reading {
+	float temperature; /**< Temperature of the device */
+	long latency_us; /**< Duration of the sweep that read the device */
+};
+
+/*
+ * Acquisition task sweeping the PmodTMP3 devices, publishing a sample on
+ * the channel of each device.
+ *
+ * @param task points to the running task, with the sweep as private data
+ *
+ * @return 0
+ */
+static int tmp3_sweep_task(struct AcqTask *task) {
+	struct Tmp3Sweep *sweep = task->priv;
+	struct Tmp3Reading reading;
+	size_t i;
+
+	tmp3_sweep(sweep);
+
+	for (i = 0; i < sweep->num_devs; i++) {
+		if (sweep->errors[i] < 0) {
+			acq_publish(task, i, sweep->errors[i], NULL, 0);
+			continue;
+		}
+
+		reading.temperature = sweep->temperatures[i];
+		reading.latency_us = sweep->latency_us;
+		acq_publish(task, i, 0, &reading, sizeof(reading));
+	}
 
-#define CONFIG_SHUTDOWN 0b00000001
-#define CONFIG_ONESHOT 0b10000000
-float tmp3_read_temperature(struct I2cDevice *dev) {
+	return 0;
+}
+
+int main() {
+	struct I2cRegCache caches[NUM_TMP3];
+	struct I2cDevice devs[NUM_TMP3];
+	float temperatures[NUM_TMP3];
+	int errors[NUM_TMP3];
+	struct BusStatsSnapshot lateness;
+	uint64_t max_lateness_ns;
+	uint64_t p99_lateness_ns;
+	struct AcqSample samples[NUM_TMP3];
+	struct Tmp3Reading reading;
+	struct AcqWorker worker;
+	struct Tmp3Sweep sweep;
+	struct AcqRuntime rt;
+	struct AcqTask task;
+	struct I2cBus bus;
+	size_t num_read;
+	size_t i;
 	int rc;
+#ifdef SIM
+	struct Tmp3Sim sims[NUM_TMP3];
+	struct SimBus sim_bus;
 
 	/*
-	 * Start conversion process.
+	 * Simulate the PmodTMP3 devices on a 100 kHz I2C bus.
 	 */
-	i2c_mask_reg(dev, CONFIG_REG, CONFIG_ONESHOT);
+	sim_bus.timing.clock_hz = 100000;
+	sim_bus.timing.bits_per_byte = 9;
+	sim_bus.timing.transaction_ns = 50000;
+	sim_bus.timing.rx_buffered = 0;
+	sim_bus_init(&sim_bus);
 
-	/*
-	 * Wait for conversion process to complete.
-	 */
-	usleep(40000);
+	for (i = 0; i < NUM_TMP3; i++) {
+		sims[i].celsius = 21.5 + i;
+		sims[i].script = NULL;
+		tmp3_sim_init(&sims[i], tmp3_addrs[i]);
+
+		/*
+		 * Convert as slowly as the datasheet allows, 75 ms at 9-bit
+		 * resolution, so that a shorter wait reads a stale temperature.
+		 */
+		sims[i].conversion_ns = 75000000L;
+		sim_bus_add_device(&sim_bus, &sims[i].sim);
+	}
+
+	bus.transport = &sim_bus.transport;
+#else
+	bus.transport = NULL;
+#endif
 
 	/*
-	 * Read temperature register.
+	 * Start the I2C bus shared by the PmodTMP3 devices,
+	 * giving up on a hung transfer after 50 ms.
 	 */
-	uint8_t data[2] = {0};
-	rc = i2c_readn_reg(dev, TEMP_REG, data, 2);
+	bus.filename = "/dev/i2c-0";
+	bus.timeout_ms = 50;
+
+	rc = i2c_bus_start(&bus);
 	if (rc) {
-		printf("failed to read i2c register\r\n");
+		printf("failed to start i2c bus\r\n");
 		return rc;
 	}
 
-	return (data[0] << 8 | data[1]) / 256.0;
-}
+	for (i = 0; i < NUM_TMP3; i++) {
+		/*
+		 * Set the I2C slave address,
+		 * register writes are short enough to not need a scratch buffer.
+		 */
+		devs[i].addr = tmp3_addrs[i];
+		devs[i].scratch_len = 0;
 
-int main() {
-	struct I2cDevice dev;
-	int rc;
+		/*
+		 * Retry failed transfers twice, 1 ms then 2 ms later,
+		 * the PmodTMP3 needs no bus recovery.
+		 */
+		devs[i].retries = 2;
+		devs[i].retry_delay_us = 1000;
+		devs[i].recover = NULL;
 
-	/*
-	 * Set the I2C bus filename and slave address,
-	 */
-	dev.filename = "/dev/i2c-0";
-	dev.addr = 0x48;
+		/*
+		 * Cache the configuration register, so that starting a conversion
+		 * is a single write instead of a read-modify-write. The one-shot
+		 * bit clears once the conversion completes.
+		 */
+		i2c_cache_init(&caches[i]);
+		i2c_cache_set_policy(&caches[i], TMP3_REG_CONFIG, I2C_REG_CACHE);
+		i2c_cache_set_self_clear(&caches[i], TMP3_REG_CONFIG, TMP3_CONFIG_ONESHOT);
+		devs[i].cache = &caches[i];
+
+		/*
+		 * Start the I2C device.
+		 */
+		rc = i2c_bus_add_device(&bus, &devs[i]);
+		if (rc) {
+			printf("failed to start i2c device\r\n");
+			return rc;
+		}
+
+		/*
+		 * Write shutdown mode to the configuration register,
+		 * to use one-shot mode for measurements.
+		 */
+		rc = tmp3_write_shutdown(&devs[i], 1);
+		if (rc < 0) {
+			printf("failed to write shutdown mode\r\n");
+			return rc;
+		}
+	}
+
+	sweep.devs = devs;
+	sweep.num_devs = NUM_TMP3;
+	sweep.temperatures = temperatures;
+	sweep.errors = errors;
 
 	/*
-	 * Start the I2C device.
+	 * Sweep the devices every second on a worker dedicated to the bus,
+	 * unpinned.
 	 */
-	rc = i2c_start(&dev);
+	acq_init(&rt);
+
+	worker.name = bus.filename;
+	worker.cpu = -1;
+	worker.priority = TMP3_WORKER_PRIORITY;
+	worker.queue_len = 64;
+	acq_add_worker(&rt, &worker);
+
+	task.name = "tmp3";
+	task.period_us = 1000000;
+	task.read = tmp3_sweep_task;
+	task.priv = &sweep;
+	acq_add_task(&worker, &task);
+
+	rc = acq_start(&rt);
 	if (rc) {
-		printf("failed to start i2c device\r\n");
+		printf("failed to start acquisition\r\n");
 		return rc;
 	}
 
+	for (size_t n = 0; n < 10 * NUM_TMP3; n += num_read) {
+		rc = acq_poll(&rt, samples, NUM_TMP3, -1);
+		if (rc < 0) {
+			break;
+		}
+
+		num_read = rc;
+		for (i = 0; i < num_read; i++) {
+			if (samples[i].status) {
+				printf("temperature 0x%02X: failed: %s\n", devs[samples[i].channel].addr,
+						strerror(-samples[i].status));
+				continue;
+			}
+
+			memcpy(&reading, samples[i].data, sizeof(reading));
+			printf("temperature 0x%02X: %f, sweep latency: %ld us\n",
+					devs[samples[i].channel].addr, reading.temperature, reading.latency_us);
+		}
+	}
+
+	acq_stop(&rt);
+
 	/*
-	 * Write shutdown mode to the configuration register,
-	 * to use one-shot mode for measurements.
+	 * Report the period jitter, the percentile being the upper bound of its
+	 * histogram bucket.
 	 */
-	i2c_mask_reg(&dev, CONFIG_REG, CONFIG_SHUTDOWN);
+	bus_stats_snapshot(&task.lateness, &lateness);
+	max_lateness_ns = atomic_load(&task.max_lateness_ns);
+	p99_lateness_ns = bus_stats_percentile(&lateness, 0.99);
+	if (p99_lateness_ns > max_lateness_ns) {
+		p99_lateness_ns = max_lateness_ns;
+	}
+
+	printf("period jitter p99: %lu us, max: %lu us, missed deadlines: %lu\n",
+			(unsigned long)(p99_lateness_ns / 1000),
+			(unsigned long)(max_lateness_ns / 1000),
+			(unsigned long)atomic_load(&task.overruns));
+
+#ifdef SIM
+	for (i = 0; i < NUM_TMP3; i++) {
+		if (sims[i].early_reads) {
+			printf("temperature 0x%02X: %lu reads before the conversion completed\n",
+					tmp3_addrs[i], sims[i].early_reads);
+		}
+	}
+#endif
 
-	for (size_t i = 0; i < 10; i++) {
-		float temperature = tmp3_read_temperature(&dev);
-		printf("temperature: %f\n", temperature);
-		sleep(1);
+	for (i = 0; i < NUM_TMP3; i++) {
+		i2c_stop(&devs[i]);
 	}
 
-	i2c_stop(&dev);
+	i2c_bus_stop(&bus);
 
     return 0;
 }
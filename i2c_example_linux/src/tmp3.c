@@ -0,0 +1,298 @@
+/*
+ * tmp3.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#include "tmp3.h"
+
+/*
+ * Convert the temperature register data to degrees Celsius.
+ *
+ * @param data the two bytes of the temperature register
+ *
+ * @return the temperature
+ */
+static float tmp3_to_celsius(uint8_t *data) {
+	return (int16_t)(data[0] << 8 | data[1]) / 256.0;
+}
+
+/*
+ * Start a one-shot conversion of a PmodTMP3.
+ *
+ * @param dev points to the started PmodTMP3, in shutdown mode
+ *
+ * @return - maximum time the conversion takes at the configured resolution,
+ *           in microseconds, if the start procedure succeeded
+ *         - negative if the start procedure failed
+ */
+static long tmp3_start_conversion(struct I2cDevice *dev) {
+	uint8_t config;
+	int rc;
+
+	rc = i2c_get_reg(dev, TMP3_REG_CONFIG, &config);
+	if (rc < 0) {
+		return rc;
+	}
+
+	rc = i2c_write_reg(dev, TMP3_REG_CONFIG, tmp3_set_oneshot(config, 1));
+	if (rc < 0) {
+		return rc;
+	}
+
+	return TMP3_CONVERSION_US << tmp3_get_resolution(config);
+}
+
+/*
+ * Read the temperature of a PmodTMP3 through a one-shot conversion.
+ *
+ * @param dev points to the started PmodTMP3, in shutdown mode
+ * @param temperature is set to the temperature, only if the read
+ *  procedure succeeded
+ *
+ * @return - 0 if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+int tmp3_read_temperature(struct I2cDevice *dev, float *temperature) {
+	uint8_t data[2];
+	long conversion_us;
+	int rc;
+
+	/*
+	 * Start conversion process.
+	 */
+	conversion_us = tmp3_start_conversion(dev);
+	if (conversion_us < 0) {
+		printf("%s: failed to start conversion\r\n", __func__);
+		return conversion_us;
+	}
+
+	/*
+	 * Wait for conversion process to complete.
+	 */
+	usleep(conversion_us);
+
+	/*
+	 * Read temperature register.
+	 */
+	rc = tmp3_read_temp(dev, data);
+	if (rc < 0) {
+		printf("%s: failed to read temperature\r\n", __func__);
+		return rc;
+	}
+
+	*temperature = tmp3_to_celsius(data);
+
+	return 0;
+}
+
+/*
+ * Check whether all the devices of a sweep share a single I2C bus, so that
+ * their temperature reads can be coalesced into combined transactions.
+ *
+ * @param sweep points to the sweep
+ *
+ * @return whether the devices share a bus
+ */
+static bool tmp3_sweep_shared(struct Tmp3Sweep *sweep) {
+	size_t i;
+
+	for (i = 0; i < sweep->num_devs; i++) {
+		if (!sweep->devs[i].bus || sweep->devs[i].bus != sweep->devs[0].bus) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Get the time between two points in time.
+ *
+ * @param end the later point in time
+ * @param start the earlier point in time
+ *
+ * @return the time between the two, in microseconds
+ */
+static long tmp3_elapsed_us(const struct timespec *end, const struct timespec *start) {
+	return (end->tv_sec - start->tv_sec) * 1000000L + (end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+/*
+ * Sort the devices of a sweep by the time their conversion completes.
+ *
+ * @param ready the time the conversion of each device completes
+ * @param order is set to the indexes of the devices, soonest first
+ * @param num_devs number of devices
+ */
+static void tmp3_sweep_order(struct timespec *ready, size_t *order, size_t num_devs) {
+	size_t index;
+	size_t i;
+	size_t j;
+
+	/*
+	 * Insertion sort, the devices being few and mostly in order.
+	 */
+	for (i = 0; i < num_devs; i++) {
+		index = i;
+		for (j = i; j > 0 && tmp3_elapsed_us(&ready[order[j - 1]], &ready[index]) > 0; j--) {
+			order[j] = order[j - 1];
+		}
+
+		order[j] = index;
+	}
+}
+
+/*
+ * Run a sweep of at least one device, see tmp3_sweep.
+ */
+static int tmp3_sweep_run(struct Tmp3Sweep *sweep) {
+	struct timespec ready[sweep->num_devs];
+	struct I2cRegRead reads[sweep->num_devs];
+	uint8_t data[sweep->num_devs][2];
+	size_t order[sweep->num_devs];
+	bool shared = tmp3_sweep_shared(sweep);
+	struct timespec start;
+	struct timespec end;
+	long conversion_us;
+	int result = 0;
+	size_t last;
+	size_t next;
+	size_t i;
+	size_t j;
+	size_t k;
+	int rc;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/*
+	 * Start the conversions, remembering when each one completes at the
+	 * resolution of its device.
+	 */
+	for (i = 0; i < sweep->num_devs; i++) {
+		conversion_us = tmp3_start_conversion(&sweep->devs[i]);
+		if (conversion_us < 0) {
+			printf("%s: failed to start conversion\r\n", __func__);
+			result = conversion_us;
+		}
+
+		sweep->errors[i] = conversion_us < 0 ? conversion_us : 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &ready[i]);
+		if (conversion_us > 0) {
+			ready[i].tv_sec += conversion_us / 1000000;
+			ready[i].tv_nsec += conversion_us % 1000000 * 1000;
+			if (ready[i].tv_nsec >= 1000000000) {
+				ready[i].tv_sec++;
+				ready[i].tv_nsec -= 1000000000;
+			}
+		}
+	}
+
+	/*
+	 * Collect the temperatures in the order the conversions complete.
+	 */
+	tmp3_sweep_order(ready, order, sweep->num_devs);
+
+	for (i = 0; i < sweep->num_devs; i = next) {
+		/*
+		 * Group the devices whose conversion completes shortly after this
+		 * one, waiting for the last of them.
+		 */
+		last = i;
+		for (next = i + 1; shared && next < sweep->num_devs && next - i < I2C_BUS_MAX_PENDING &&
+				tmp3_elapsed_us(&ready[order[next]], &ready[order[i]]) <= TMP3_SWEEP_SLACK_US;
+				next++) {
+			last = next;
+		}
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ready[order[last]], NULL);
+
+		for (k = i; k < next; k++) {
+			j = order[k];
+
+			/*
+			 * Do not read a stale temperature from a device whose
+			 * conversion did not start.
+			 */
+			if (sweep->errors[j] < 0) {
+				reads[j].status = sweep->errors[j];
+				continue;
+			}
+
+			if (shared) {
+				reads[j].addr = sweep->devs[j].addr;
+				reads[j].reg = TMP3_REG_TEMP;
+				reads[j].buf = data[j];
+				reads[j].buf_len = sizeof(data[j]);
+				reads[j].status = i2c_bus_queue_read(sweep->devs[j].bus, &reads[j]);
+			} else {
+				rc = tmp3_read_temp(&sweep->devs[j], data[j]);
+				reads[j].status = rc < 0 ? rc : 0;
+			}
+		}
+
+		/*
+		 * The flush sets the status of each read it does.
+		 */
+		if (shared) {
+			i2c_bus_flush(sweep->devs[0].bus);
+		}
+
+		for (k = i; k < next; k++) {
+			j = order[k];
+
+			if (reads[j].status < 0) {
+				if (sweep->errors[j] >= 0) {
+					printf("%s: failed to read temperature\r\n", __func__);
+				}
+
+				sweep->temperatures[j] = NAN;
+				sweep->errors[j] = reads[j].status;
+				result = reads[j].status;
+				continue;
+			}
+
+			sweep->temperatures[j] = tmp3_to_celsius(data[j]);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	sweep->latency_us = tmp3_elapsed_us(&end, &start);
+
+	return result;
+}
+
+/*
+ * Read the temperature of many PmodTMP3 devices, overlapping their
+ * one-shot conversions.
+ *
+ * The conversions are started on all the devices back-to-back, then the
+ * temperature of each device is read as soon as its conversion completes,
+ * the conversion time depending on the resolution of each device.
+ * When the devices share an I2C bus, the reads of the conversions that
+ * complete within TMP3_SWEEP_SLACK_US of each other are queued on the bus
+ * and flushed in a single combined transaction.
+ *
+ * @param sweep points to the sweep, must have devs, num_devs, temperatures
+ *  and errors populated
+ *
+ * @return - 0 if all the devices were read
+ *         - negative if some device failed
+ */
+int tmp3_sweep(struct Tmp3Sweep *sweep) {
+	if (!sweep->num_devs) {
+		printf("%s: no devices to sweep\r\n", __func__);
+		return -EINVAL;
+	}
+
+	return tmp3_sweep_run(sweep);
+}
@@ -0,0 +1,45 @@
+/*
+ * tmp3.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+
+#include "i2c.h"
+#include "tmp3_regmap.h"
+
+#ifndef SRC_TMP3_H_
+#define SRC_TMP3_H_
+
+/*
+ * Maximum time a one-shot conversion takes to complete at 9-bit resolution,
+ * in microseconds, 2.5 times the typical 30 ms, doubling with each extra
+ * bit up to 600 ms at 12-bit.
+ */
+#define TMP3_CONVERSION_US 75000L
+
+/*
+ * Time a sweep waits past the completion of a conversion for the next ones
+ * to complete too, so that their reads share a combined transaction,
+ * in microseconds.
+ */
+#define TMP3_SWEEP_SLACK_US 1000
+
+/*
+ * Sweep of one-shot conversions across many PmodTMP3 devices.
+ */
+struct Tmp3Sweep {
+	struct I2cDevice *devs; /**< Started PmodTMP3 devices, in shutdown mode */
+	size_t num_devs; /**< Number of PmodTMP3 devices */
+	float *temperatures; /**< Temperature of each device, NAN if it failed */
+	int *errors; /**< Result of the read of each device, 0 or negative */
+
+	long latency_us; /**< Duration of the last sweep, in microseconds */
+};
+
+int tmp3_read_temperature(struct I2cDevice *dev, float *temperature);
+int tmp3_sweep(struct Tmp3Sweep *sweep);
+
+#endif /* SRC_TMP3_H_ */
@@ -0,0 +1,36 @@
+/*
+ * tmp3_regmap.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include "regmap.h"
+#include "i2c.h"
+
+#ifndef SRC_TMP3_REGMAP_H_
+#define SRC_TMP3_REGMAP_H_
+
+/*
+ * Register map of the PmodTMP3 (TCN75A).
+ */
+#define TMP3_REGMAP(REG, FIELD) \
+	REG(tmp3, TMP3_REG_TEMP, temp, 0x00, 2) \
+	REG(tmp3, TMP3_REG_CONFIG, config, 0x01, 1) \
+	REG(tmp3, TMP3_REG_HYST, hyst, 0x02, 2) \
+	REG(tmp3, TMP3_REG_LIMIT, limit, 0x03, 2) \
+	FIELD(tmp3, TMP3_REG_CONFIG, config, TMP3_CONFIG_SHUTDOWN, shutdown, 0, 1) \
+	FIELD(tmp3, TMP3_REG_CONFIG, config, TMP3_CONFIG_INTERRUPT, interrupt, 1, 1) \
+	FIELD(tmp3, TMP3_REG_CONFIG, config, TMP3_CONFIG_ALERT_HIGH, alert_high, 2, 1) \
+	FIELD(tmp3, TMP3_REG_CONFIG, config, TMP3_CONFIG_FAULT_QUEUE, fault_queue, 3, 2) \
+	FIELD(tmp3, TMP3_REG_CONFIG, config, TMP3_CONFIG_RESOLUTION, resolution, 5, 2) \
+	FIELD(tmp3, TMP3_REG_CONFIG, config, TMP3_CONFIG_ONESHOT, oneshot, 7, 1)
+
+enum {
+	TMP3_REGMAP(REGMAP_ENUM_REG, REGMAP_ENUM_FIELD)
+};
+
+TMP3_REGMAP(REGMAP_NONE, REGMAP_FIELD_HELPERS)
+TMP3_REGMAP(I2C_REGMAP_REG, I2C_REGMAP_FIELD)
+
+#endif /* SRC_TMP3_REGMAP_H_ */
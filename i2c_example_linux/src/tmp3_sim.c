@@ -0,0 +1,195 @@
+/*
+ * tmp3_sim.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <errno.h>
+
+#include "tmp3_sim.h"
+#include "tmp3.h"
+
+/*
+ * Get the time a conversion takes at the configured resolution,
+ * doubling with each extra bit.
+ *
+ * @param tmp3 points to the simulated PmodTMP3
+ *
+ * @return the conversion time, in nanoseconds
+ */
+static long tmp3_sim_conversion_ns(struct Tmp3Sim *tmp3) {
+	return tmp3->conversion_ns << tmp3_get_resolution(tmp3->config);
+}
+
+/*
+ * Measure the temperature into the temperature register, truncated
+ * to the configured resolution.
+ *
+ * @param tmp3 points to the simulated PmodTMP3
+ */
+static void tmp3_sim_convert(struct Tmp3Sim *tmp3) {
+	float celsius = tmp3->celsius;
+	int16_t raw;
+
+	if (tmp3->script) {
+		celsius = tmp3->script(tmp3, sim_elapsed(&tmp3->epoch));
+	}
+
+	raw = (int16_t)(celsius * 256);
+	raw &= (int16_t)(0xFFFF << (7 - tmp3_get_resolution(tmp3->config)));
+
+	tmp3->regs[TMP3_REG_TEMP][0] = (uint16_t)raw >> 8;
+	tmp3->regs[TMP3_REG_TEMP][1] = raw & 0xFF;
+}
+
+/*
+ * Complete the pending one-shot conversion if its time has come, or keep
+ * converting continuously when not in shutdown mode.
+ *
+ * @param tmp3 points to the simulated PmodTMP3
+ */
+static void tmp3_sim_update(struct Tmp3Sim *tmp3) {
+	struct timespec now;
+
+	if (!tmp3_get_shutdown(tmp3->config)) {
+		tmp3_sim_convert(tmp3);
+		return;
+	}
+
+	if (!tmp3->converting) {
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec < tmp3->conversion_end.tv_sec ||
+			(now.tv_sec == tmp3->conversion_end.tv_sec &&
+			now.tv_nsec < tmp3->conversion_end.tv_nsec)) {
+		return;
+	}
+
+	tmp3_sim_convert(tmp3);
+	tmp3->converting = 0;
+	tmp3->config = tmp3_set_oneshot(tmp3->config, 0);
+}
+
+/*
+ * Write the configuration register, starting a one-shot conversion
+ * when requested in shutdown mode.
+ *
+ * @param tmp3 points to the simulated PmodTMP3
+ * @param value value written into the configuration register
+ */
+static void tmp3_sim_write_config(struct Tmp3Sim *tmp3, uint8_t value) {
+	long ns;
+
+	tmp3->config = value;
+
+	if (!tmp3_get_shutdown(value) || !tmp3_get_oneshot(value) || tmp3->converting) {
+		return;
+	}
+
+	ns = tmp3_sim_conversion_ns(tmp3);
+
+	clock_gettime(CLOCK_MONOTONIC, &tmp3->conversion_end);
+	tmp3->conversion_end.tv_sec += ns / 1000000000;
+	tmp3->conversion_end.tv_nsec += ns % 1000000000;
+	if (tmp3->conversion_end.tv_nsec >= 1000000000) {
+		tmp3->conversion_end.tv_sec++;
+		tmp3->conversion_end.tv_nsec -= 1000000000;
+	}
+
+	tmp3->converting = 1;
+}
+
+/*
+ * Transfer an I2C message with the simulated PmodTMP3. The first byte of
+ * a write sets the register pointer, the next ones are written into the
+ * register. Reads start at the register pointer, wrapping within the
+ * register.
+ */
+static int tmp3_sim_transfer(struct SimDevice *dev, struct TransportSegment *seg) {
+	struct Tmp3Sim *tmp3 = dev->priv;
+	uint8_t *reg;
+	size_t width;
+	size_t i;
+
+	if (seg->write_buf && seg->len) {
+		tmp3->pointer = seg->write_buf[0] & 0x03;
+	}
+
+	tmp3_sim_update(tmp3);
+
+	if (tmp3->pointer == TMP3_REG_CONFIG) {
+		reg = &tmp3->config;
+		width = 1;
+	} else {
+		reg = tmp3->regs[tmp3->pointer];
+		width = 2;
+	}
+
+	if (seg->read_buf) {
+		/*
+		 * Reading the temperature before the conversion completed
+		 * returns the previous one.
+		 */
+		if (tmp3->pointer == TMP3_REG_TEMP && tmp3->converting) {
+			tmp3->early_reads++;
+		}
+
+		for (i = 0; i < seg->len; i++) {
+			seg->read_buf[i] = reg[i % width];
+		}
+
+		return seg->len;
+	}
+
+	/*
+	 * The temperature register is read-only.
+	 */
+	for (i = 1; i < seg->len && tmp3->pointer != TMP3_REG_TEMP; i++) {
+		if (tmp3->pointer == TMP3_REG_CONFIG) {
+			tmp3_sim_write_config(tmp3, seg->write_buf[i]);
+		} else {
+			reg[(i - 1) % width] = seg->write_buf[i];
+		}
+	}
+
+	return seg->len;
+}
+
+static const struct SimDeviceOps tmp3_sim_ops = {
+	.transfer = tmp3_sim_transfer,
+};
+
+/*
+ * Initialize a simulated PmodTMP3 in its power-on state, converting
+ * continuously at 9-bit resolution. Conversions take the typical 30 ms,
+ * conversion_ns may be changed once initialized, eg: to model a slower part.
+ *
+ * @param tmp3 points to the simulated PmodTMP3, must have celsius, script
+ *  and script_priv populated
+ * @param addr address of the PmodTMP3 on the simulated I2C bus
+ */
+void tmp3_sim_init(struct Tmp3Sim *tmp3, uint16_t addr) {
+	tmp3->sim.addr = addr;
+	tmp3->sim.ops = &tmp3_sim_ops;
+	tmp3->sim.priv = tmp3;
+
+	clock_gettime(CLOCK_MONOTONIC, &tmp3->epoch);
+	tmp3->converting = 0;
+	tmp3->conversion_ns = 30000000L;
+	tmp3->early_reads = 0;
+	tmp3->pointer = TMP3_REG_TEMP;
+	tmp3->config = 0;
+
+	/*
+	 * Power-on hysteresis of 75 C and limit of 80 C.
+	 */
+	tmp3->regs[TMP3_REG_HYST][0] = 75;
+	tmp3->regs[TMP3_REG_HYST][1] = 0;
+	tmp3->regs[TMP3_REG_LIMIT][0] = 80;
+	tmp3->regs[TMP3_REG_LIMIT][1] = 0;
+
+	tmp3_sim_convert(tmp3);
+}
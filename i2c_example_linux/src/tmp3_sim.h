@@ -0,0 +1,37 @@
+/*
+ * tmp3_sim.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "sim.h"
+
+#ifndef SRC_TMP3_SIM_H_
+#define SRC_TMP3_SIM_H_
+
+/*
+ * Simulated PmodTMP3 (TCN75A), to be attached to a simulated I2C bus.
+ */
+struct Tmp3Sim {
+	float celsius; /**< Temperature measured when there is no script */
+	float (*script)(struct Tmp3Sim *tmp3, double elapsed_s); /**< Temperature over time, NULL for celsius */
+	void *script_priv; /**< Private data of the script */
+
+	struct SimDevice sim; /**< Device attached to the simulated bus */
+	struct timespec epoch; /**< Time the model was initialized at */
+	struct timespec conversion_end; /**< Time the pending one-shot conversion completes at */
+	int converting; /**< Whether a one-shot conversion is pending */
+	long conversion_ns; /**< Time a conversion takes at 9-bit resolution, doubling with each extra bit */
+	unsigned long early_reads; /**< Number of temperature reads while a one-shot conversion was pending */
+	uint8_t pointer; /**< Register pointer */
+	uint8_t config; /**< Configuration register */
+	uint8_t regs[4][2]; /**< Temperature, hysteresis and limit registers */
+};
+
+void tmp3_sim_init(struct Tmp3Sim *tmp3, uint16_t addr);
+
+#endif /* SRC_TMP3_SIM_H_ */
@@ -0,0 +1,99 @@
+/*
+ * transport.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <errno.h>
+
+#include "transport.h"
+
+/*
+ * Open a transport.
+ *
+ * @param transport points to the transport to be opened, must have ops
+ *  and priv populated
+ *
+ * @return - 0 if the opening procedure succeeded
+ *         - negative if the opening procedure failed
+ */
+int transport_open(struct Transport *transport) {
+	if (!transport->ops->open) {
+		return 0;
+	}
+
+	return transport->ops->open(transport);
+}
+
+/*
+ * Transfer a single segment through a transport.
+ *
+ * @param transport points to the opened transport
+ * @param seg points to the segment to be transferred
+ *
+ * @return - number of bytes transferred if the transfer procedure succeeded,
+ *           possibly less than the segment length on streams such as UART
+ *         - negative if the transfer procedure failed
+ */
+int transport_transfer(struct Transport *transport, struct TransportSegment *seg) {
+	int rc;
+
+	if (transport->ops->transfer) {
+		return transport->ops->transfer(transport, seg);
+	}
+
+	rc = transport->ops->batch(transport, seg, 1);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return seg->len;
+}
+
+/*
+ * Transfer multiple segments through a transport in a single transaction,
+ * eg: a combined I2C transaction or a single SPI chip select assertion.
+ *
+ * Backends without batching transfer the segments one by one.
+ *
+ * @param transport points to the opened transport
+ * @param segs points to the start of the segments to be transferred
+ * @param num_segs number of segments
+ *
+ * @return - 0 or a positive backend-specific value if all the segments
+ *           were transferred
+ *         - negative if the transfer procedure failed
+ */
+int transport_batch(struct Transport *transport, struct TransportSegment *segs, size_t num_segs) {
+	size_t i;
+	int rc;
+
+	if (transport->ops->batch) {
+		return transport->ops->batch(transport, segs, num_segs);
+	}
+
+	for (i = 0; i < num_segs; i++) {
+		rc = transport->ops->transfer(transport, &segs[i]);
+		if (rc < 0) {
+			return rc;
+		}
+
+		if ((size_t)rc != segs[i].len) {
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Close a transport.
+ *
+ * @param transport points to the transport to be closed
+ */
+void transport_close(struct Transport *transport) {
+	if (transport->ops->close) {
+		transport->ops->close(transport);
+	}
+}
@@ -0,0 +1,264 @@
+/*
+ * bench.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "bench.h"
+
+/*
+ * Number of warm-up iterations run before measuring, to fault in the
+ * buffers and fill the caches.
+ */
+#define BENCH_WARMUP 100
+
+static uint64_t bench_transactions;
+static uint64_t bench_allocs;
+
+#ifdef __GLIBC__
+/*
+ * Count the heap allocations by interposing the allocator entry points
+ * of the application, including the aligned ones used for DMA-friendly
+ * buffers, eg: spi_alloc_buf.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) {
+	bench_allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size) {
+	bench_allocs++;
+	return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	bench_allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+	bench_allocs++;
+	return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+	bench_allocs++;
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+	void *buf;
+
+	if (!alignment || alignment % sizeof(void *) || (alignment & (alignment - 1))) {
+		return EINVAL;
+	}
+
+	bench_allocs++;
+	buf = __libc_memalign(alignment, size);
+	if (!buf) {
+		return ENOMEM;
+	}
+
+	*ptr = buf;
+
+	return 0;
+}
+#endif
+
+static int bench_counter_transfer(struct Transport *transport, struct TransportSegment *seg) {
+	struct BenchCounter *counter = transport->priv;
+
+	bench_transactions++;
+	return transport_transfer(counter->inner, seg);
+}
+
+static int bench_counter_batch(struct Transport *transport, struct TransportSegment *segs,
+		size_t num_segs) {
+	struct BenchCounter *counter = transport->priv;
+
+	bench_transactions++;
+	return transport_batch(counter->inner, segs, num_segs);
+}
+
+static const struct TransportOps bench_counter_ops = {
+	.name = "counter",
+	.transfer = bench_counter_transfer,
+	.batch = bench_counter_batch,
+};
+
+/*
+ * Initialize a counting transport.
+ *
+ * @param counter points to the counting transport, must have inner populated
+ */
+void bench_counter_init(struct BenchCounter *counter) {
+	counter->transport.ops = &bench_counter_ops;
+	counter->transport.priv = counter;
+}
+
+static int bench_compare_ns(const void *a, const void *b) {
+	long x = *(const long *)a;
+	long y = *(const long *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Get the latency below which a fraction of the sorted latencies are.
+ *
+ * @param latencies points to the start of the sorted latencies
+ * @param num_latencies number of latencies
+ * @param fraction the fraction, eg: 0.99
+ *
+ * @return the latency, in nanoseconds
+ */
+static long bench_percentile(long *latencies, size_t num_latencies, double fraction) {
+	size_t i = fraction * num_latencies;
+
+	if (i >= num_latencies) {
+		i = num_latencies - 1;
+	}
+
+	return latencies[i];
+}
+
+/*
+ * Run a benchmarked operation for the given number of iterations,
+ * measuring the latency of each one.
+ *
+ * The preparation, if any, runs before each iteration and is not measured,
+ * eg: to feed the data the operation reads.
+ * @param name name of the operation, eg: spi_transfer
+ * @param fn the operation
+ * @param prepare the preparation of each iteration, or NULL
+ * @param priv private data of the operation and preparation
+ * @param iterations number of iterations to be measured
+ * @param result points to the result to be filled
+ *
+ * @return - 0 if the benchmark procedure succeeded
+ *         - negative if the benchmark procedure failed
+ */
+int bench_run(const char *name, bench_fn fn, bench_fn prepare, void *priv,
+		size_t iterations, struct BenchResult *result) {
+	struct timespec t0;
+	struct timespec t1;
+	uint64_t before_transactions;
+	uint64_t before_allocs;
+	uint64_t transactions;
+	uint64_t allocs;
+	long long total_ns;
+	long *latencies;
+	double total_s;
+	size_t i;
+
+	if (!iterations) {
+		return -EINVAL;
+	}
+
+	latencies = malloc(iterations * sizeof(*latencies));
+	if (!latencies) {
+		printf("%s: failed to allocate latencies\r\n", __func__);
+		return -ENOMEM;
+	}
+
+	memset(result, 0, sizeof(*result));
+	result->name = name;
+	result->iterations = iterations;
+
+	for (i = 0; i < BENCH_WARMUP; i++) {
+		if (prepare) {
+			prepare(priv);
+		}
+		fn(priv);
+	}
+
+	/*
+	 * Only the operation itself is accounted, not the preparation.
+	 */
+	transactions = 0;
+	allocs = 0;
+	total_ns = 0;
+
+	for (i = 0; i < iterations; i++) {
+		if (prepare) {
+			prepare(priv);
+		}
+
+		before_transactions = bench_transactions;
+		before_allocs = bench_allocs;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		if (fn(priv) < 0) {
+			result->errors++;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		transactions += bench_transactions - before_transactions;
+		allocs += bench_allocs - before_allocs;
+
+		latencies[i] = (t1.tv_sec - t0.tv_sec) * 1000000000L + (t1.tv_nsec - t0.tv_nsec);
+		total_ns += latencies[i];
+	}
+
+	total_s = total_ns / 1e9;
+	result->ops_per_sec = iterations / total_s;
+	result->transactions_per_op = (double)transactions / iterations;
+	result->allocs_per_op = (double)allocs / iterations;
+
+	qsort(latencies, iterations, sizeof(*latencies), bench_compare_ns);
+	result->p50_ns = bench_percentile(latencies, iterations, 0.50);
+	result->p99_ns = bench_percentile(latencies, iterations, 0.99);
+	result->p999_ns = bench_percentile(latencies, iterations, 0.999);
+	result->max_ns = latencies[iterations - 1];
+
+	free(latencies);
+
+	return 0;
+}
+
+/*
+ * Print benchmark results as a JSON document, for trending.
+ *
+ * @param file the file to print into
+ * @param suite name of the benchmark suite, eg: spi
+ * @param backend name of the backend the operations ran on, eg: sim
+ * @param results points to the start of the results
+ * @param num_results number of results
+ */
+void bench_print_json(FILE *file, const char *suite, const char *backend,
+		struct BenchResult *results, size_t num_results) {
+	struct timespec now;
+	size_t i;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"suite\": \"%s\",\n", suite);
+	fprintf(file, "  \"backend\": \"%s\",\n", backend);
+	fprintf(file, "  \"timestamp\": %lld,\n", (long long)now.tv_sec);
+	fprintf(file, "  \"results\": [\n");
+
+	for (i = 0; i < num_results; i++) {
+		fprintf(file, "    {\"name\": \"%s\", \"iterations\": %zu, \"errors\": %d, "
+				"\"ops_per_sec\": %.1f, \"transactions_per_op\": %.3f, "
+				"\"allocs_per_op\": %.3f, \"p50_ns\": %ld, \"p99_ns\": %ld, "
+				"\"p999_ns\": %ld, \"max_ns\": %ld}%s\n",
+				results[i].name, results[i].iterations, results[i].errors,
+				results[i].ops_per_sec, results[i].transactions_per_op,
+				results[i].allocs_per_op, results[i].p50_ns, results[i].p99_ns,
+				results[i].p999_ns, results[i].max_ns,
+				i + 1 < num_results ? "," : "");
+	}
+
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+}
@@ -0,0 +1,53 @@
+/*
+ * bench.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "transport.h"
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Operation to be benchmarked, called once per iteration.
+ */
+typedef int (*bench_fn)(void *priv);
+
+/*
+ * Measurements of a benchmarked operation.
+ */
+struct BenchResult {
+	const char *name; /**< Name of the operation, eg: spi_transfer */
+	size_t iterations; /**< Number of iterations measured */
+	double ops_per_sec; /**< Throughput of the operation */
+	double transactions_per_op; /**< Bus transactions per operation, one syscall each on real buses */
+	double allocs_per_op; /**< Heap allocations per operation */
+	long p50_ns; /**< Median latency */
+	long p99_ns; /**< 99th percentile latency */
+	long p999_ns; /**< 99.9th percentile latency */
+	long max_ns; /**< Maximum latency */
+	int errors; /**< Number of failed iterations */
+};
+
+/*
+ * Transport counting the transactions done through another transport.
+ */
+struct BenchCounter {
+	struct Transport *inner; /**< Opened transport to count the transactions of */
+
+	struct Transport transport; /**< Transport to bind the benchmarked devices to */
+};
+
+void bench_counter_init(struct BenchCounter *counter);
+int bench_run(const char *name, bench_fn fn, bench_fn prepare, void *priv,
+		size_t iterations, struct BenchResult *result);
+void bench_print_json(FILE *file, const char *suite, const char *backend,
+		struct BenchResult *results, size_t num_results);
+
+#endif // BENCH_H
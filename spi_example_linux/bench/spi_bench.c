@@ -0,0 +1,218 @@
+/*
+ * spi_bench.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "bench.h"
+#include "spi.h"
+#include "sim.h"
+#include "acl2.h"
+#include "acl2_sim.h"
+
+#define SPI_BENCH_NUM_OPS 6
+
+/*
+ * Number of XYZ samples drained by a FIFO burst.
+ */
+#define SPI_BENCH_FIFO_SAMPLES 160
+
+/*
+ * Length of the block read by a stream, longer than the default spidev
+ * buffer size limit.
+ */
+#define SPI_BENCH_STREAM_LEN (16 * 1024)
+
+static uint8_t *stream_buf;
+static struct AsyncBus async_bus;
+
+static int bench_transfer(void *priv) {
+	uint8_t write_buf[3] = { ACL2_CMD_READ_REG, ACL2_REG_DEVID, 0 };
+	uint8_t read_buf[3];
+
+	return spi_transfer(priv, write_buf, read_buf, sizeof(write_buf));
+}
+
+static int bench_async_transfer(void *priv) {
+	uint8_t write_buf[3] = { ACL2_CMD_READ_REG, ACL2_REG_DEVID, 0 };
+	uint8_t read_buf[3];
+	struct AsyncRequest req;
+	int rc;
+
+	req.complete = NULL;
+	req.priv = NULL;
+	spi_async_transfer(&req, priv, write_buf, read_buf, sizeof(write_buf));
+
+	rc = async_submit(&async_bus, &req);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return async_wait(&async_bus, &req);
+}
+
+static int bench_read_reg(void *priv) {
+	return acl2_read_reg(priv, ACL2_REG_STATUS);
+}
+
+static int bench_nread_reg(void *priv) {
+	uint8_t data[3];
+
+	return acl2_nread_reg(priv, ACL2_REG_STATUS, data, sizeof(data));
+}
+
+static int bench_read_fifo(void *priv) {
+	static uint8_t fifo_buf[SPI_BENCH_FIFO_SAMPLES * 3 * 2];
+	uint8_t cmd = ACL2_CMD_READ_FIFO;
+	struct SpiMessage msg;
+
+	spi_message_init(&msg, priv);
+	spi_message_add(&msg, &cmd, NULL, 1);
+	spi_message_add(&msg, NULL, fifo_buf, sizeof(fifo_buf));
+
+	return spi_message_transfer(&msg);
+}
+
+static int bench_stream(void *priv) {
+	uint8_t cmd = ACL2_CMD_READ_FIFO;
+
+	return spi_stream(priv, &cmd, 1, NULL, stream_buf, SPI_BENCH_STREAM_LEN);
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [-d /dev/spidevB.C] [-s speed_hz] [-n iterations] [-c clock_hz]\n", name);
+	fprintf(stderr, "  -d  benchmark a real SPI device instead of the simulator\n");
+	fprintf(stderr, "  -s  speed of the real SPI device, default 1000000\n");
+	fprintf(stderr, "  -n  number of iterations per operation, default 10000\n");
+	fprintf(stderr, "  -c  clock of the simulated bus, default 0 to measure the software only\n");
+}
+
+int main(int argc, char **argv) {
+	struct BenchResult results[SPI_BENCH_NUM_OPS];
+	struct BenchCounter counter;
+	struct Transport real;
+	struct SpiDevice real_dev;
+	struct SpiDevice dev;
+	struct SimBus sim_bus;
+	struct Acl2Sim acl2;
+	char *filename = NULL;
+	uint32_t speed = 1000000;
+	size_t iterations = 10000;
+	uint32_t clock_hz = 0;
+	int opt;
+	int rc;
+
+	while ((opt = getopt(argc, argv, "d:s:n:c:")) != -1) {
+		switch (opt) {
+		case 'd':
+			filename = optarg;
+			break;
+		case 's':
+			speed = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			clock_hz = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	/*
+	 * Count the transactions of either the real device or the simulator.
+	 */
+	if (filename) {
+		real_dev.filename = filename;
+		real_dev.mode = 0;
+		real_dev.bpw = 8;
+		real_dev.speed = speed;
+		real_dev.transport = NULL;
+		real_dev.max_message_len = 0;
+		real.ops = &spi_transport_ops;
+		real.priv = &real_dev;
+
+		rc = transport_open(&real);
+		if (rc) {
+			printf("failed to start SPI device\r\n");
+			return rc;
+		}
+
+		counter.inner = &real;
+	} else {
+		sim_bus.timing.clock_hz = clock_hz;
+		sim_bus.timing.bits_per_byte = 8;
+		sim_bus.timing.transaction_ns = 0;
+		sim_bus.timing.rx_buffered = 0;
+		sim_bus_init(&sim_bus);
+
+		acl2.xyz[0] = 0;
+		acl2.xyz[1] = 0;
+		acl2.xyz[2] = 1000;
+		acl2.script = NULL;
+		acl2_sim_init(&acl2);
+		sim_bus_add_device(&sim_bus, &acl2.sim);
+
+		counter.inner = &sim_bus.transport;
+	}
+
+	bench_counter_init(&counter);
+
+	dev.filename = filename;
+	dev.mode = 0;
+	dev.bpw = 8;
+	dev.speed = speed;
+	dev.transport = &counter.transport;
+	dev.max_message_len = filename ? real_dev.max_message_len : 0;
+
+	rc = spi_start(&dev);
+	if (rc) {
+		printf("failed to start SPI device\r\n");
+		return rc;
+	}
+
+	bench_run("spi_transfer", bench_transfer, NULL, &dev, iterations, &results[0]);
+	bench_run("acl2_read_reg", bench_read_reg, NULL, &dev, iterations, &results[1]);
+	bench_run("acl2_nread_reg_3", bench_nread_reg, NULL, &dev, iterations, &results[2]);
+	bench_run("acl2_read_fifo_160", bench_read_fifo, NULL, &dev, iterations, &results[3]);
+
+	stream_buf = spi_alloc_buf(SPI_BENCH_STREAM_LEN);
+	if (!stream_buf) {
+		return -ENOMEM;
+	}
+
+	bench_run("spi_stream_16k", bench_stream, NULL, &dev, iterations, &results[4]);
+	spi_free_buf(stream_buf);
+
+	/*
+	 * Round trip of a transfer through the worker of the bus.
+	 */
+	async_bus.name = filename ? filename : "sim";
+	rc = async_start(&async_bus);
+	if (rc) {
+		printf("failed to start SPI bus worker\r\n");
+		return rc;
+	}
+
+	bench_run("spi_async_transfer", bench_async_transfer, NULL, &dev, iterations, &results[5]);
+	async_stop(&async_bus);
+
+	bench_print_json(stdout, "spi", filename ? "spi" : "sim", results, SPI_BENCH_NUM_OPS);
+
+	spi_stop(&dev);
+
+	if (filename) {
+		transport_close(&real);
+	}
+
+	return 0;
+}
@@ -0,0 +1,458 @@
+/*
+ * acl2.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "acl2.h"
+
+/*
+ * Write data from a register of a SPI device.
+ *
+ * @param dev points to the SPI device to be written to
+ * @param reg the register to write to
+ * @param buf points to the start of buffer to be written from
+ * @param buf_len length of the buffer to be written
+ *
+ * @return - 0 if the wrote procedure succeeded
+ *         - negative if the write procedure failed
+ */
+int acl2_nwrite_reg(struct SpiDevice *dev, uint8_t reg, uint8_t *buf, int buf_len) {
+	struct SpiMessage msg;
+	uint8_t header[2];
+
+	/*
+	 * Build a header that contains the instruction and
+	 * the register address.
+	 */
+	header[0] = ACL2_CMD_WRITE_REG;
+	header[1] = reg;
+
+	/*
+	 * Queue the header and the data as two segments of the same message,
+	 * keeping the chip select asserted in between.
+	 */
+	spi_message_init(&msg, dev);
+	spi_message_add(&msg, header, NULL, sizeof(header));
+	spi_message_add(&msg, buf, NULL, buf_len);
+
+	/*
+	 * Transfer the instruction, register address and data.
+	 */
+	return spi_message_transfer(&msg);
+}
+
+/*
+ * Read data from a register of a SPI device.
+ *
+ * @param dev points to the SPI device to be read from
+ * @param reg the register to read from
+ * @param buf points to the start of buffer to be read into
+ * @param buf_len length of the buffer to be read
+ *
+ * @return - 0 if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+int acl2_nread_reg(struct SpiDevice *dev, uint8_t reg, uint8_t *buf, int buf_len) {
+	struct SpiMessage msg;
+	uint8_t header[2];
+
+	/*
+	 * Build a header that contains the instruction and
+	 * the register address.
+	 */
+	header[0] = ACL2_CMD_READ_REG;
+	header[1] = reg;
+
+	/*
+	 * Queue the header and the data as two segments of the same message,
+	 * reading the data straight into the given buffer.
+	 */
+	spi_message_init(&msg, dev);
+	spi_message_add(&msg, header, NULL, sizeof(header));
+	spi_message_add(&msg, NULL, buf, buf_len);
+
+	/*
+	 * Transfer the instruction, register address and data.
+	 */
+	return spi_message_transfer(&msg);
+}
+
+/*
+ * Read value from a register of a SPI device
+ *
+ * @param dev points to the SPI device to be read from
+ * @param reg the register to read from
+ *
+ * @return the value read from the register
+ */
+int acl2_read_reg(struct SpiDevice *dev, uint8_t reg) {
+	uint8_t data = 0;
+	acl2_nread_reg(dev, reg, &data, 1);
+	return data;
+}
+
+/*
+ * Write value to the register of a SPI device.
+ *
+ * @param dev points to the SPI device to be written to
+ * @param reg the register to write to
+ * @param value the value to be written
+ *
+ * @return - 0 if the write procedure succeeded
+ *         - negative if the write procedure failed
+ */
+int acl2_write_reg(struct SpiDevice *dev, uint8_t reg, uint8_t value) {
+	return acl2_nwrite_reg(dev, reg, &value, 1);
+}
+
+/*
+ * Start continuous sampling of the PmodACL2 through its FIFO.
+ *
+ * @param acl2 points to the PmodACL2 to be started, must have spi, odr,
+ *  watermark, num_samples and int1 populated
+ *
+ * @return - 0 if the starting procedure succeeded
+ *         - negative if the starting procedure failed
+ */
+int acl2_start(struct Acl2Device *acl2) {
+	uint16_t entries;
+	uint8_t fifo_control;
+	int rc;
+
+	if (!acl2->num_samples || (acl2->num_samples & (acl2->num_samples - 1))) {
+		printf("%s: sample ring buffer size must be a power of two\r\n", __func__);
+		return -EINVAL;
+	}
+
+	/*
+	 * Each sample takes one FIFO entry per axis.
+	 */
+	entries = acl2->watermark * 3;
+	if (!entries || entries > ACL2_FIFO_ENTRIES) {
+		printf("%s: invalid FIFO watermark\r\n", __func__);
+		return -EINVAL;
+	}
+
+	acl2->samples = malloc(acl2->num_samples * sizeof(*acl2->samples));
+	if (!acl2->samples) {
+		printf("%s: failed to allocate sample ring buffer\r\n", __func__);
+		return -ENOMEM;
+	}
+
+	acl2->head = 0;
+	acl2->tail = 0;
+	acl2->overruns = 0;
+
+	/*
+	 * Set the output data rate.
+	 */
+	rc = acl2_write_reg(acl2->spi, ACL2_REG_FILTER_CTL, acl2_set_odr(0, acl2->odr));
+	if (rc < 0) {
+		goto fail_configure;
+	}
+
+	/*
+	 * Set the FIFO watermark, whose ninth bit is in FIFO_CONTROL,
+	 * and stream the samples into the FIFO.
+	 */
+	fifo_control = acl2_set_fifo_mode(0, ACL2_FIFO_MODE_STREAM);
+	fifo_control = acl2_set_fifo_ah(fifo_control, entries >> 8);
+
+	rc = acl2_write_reg(acl2->spi, ACL2_REG_FIFO_SAMPLES, entries & 0xFF);
+	if (rc < 0) {
+		goto fail_configure;
+	}
+
+	rc = acl2_write_reg(acl2->spi, ACL2_REG_FIFO_CONTROL, fifo_control);
+	if (rc < 0) {
+		goto fail_configure;
+	}
+
+	/*
+	 * Signal the FIFO watermark on INT1.
+	 */
+	rc = acl2_write_reg(acl2->spi, ACL2_REG_INTMAP1, acl2_set_int1_fifo_watermark(0, 1));
+	if (rc < 0) {
+		goto fail_configure;
+	}
+
+	/*
+	 * Enable measurement.
+	 */
+	rc = acl2_write_reg(acl2->spi, ACL2_REG_POWER_CTL, acl2_set_measure(0, ACL2_MEASURE_ON));
+	if (rc < 0) {
+		goto fail_configure;
+	}
+
+	return 0;
+
+fail_configure:
+	printf("%s: failed to configure PmodACL2\r\n", __func__);
+	free(acl2->samples);
+	return rc;
+}
+
+/*
+ * Read the status register and the number of FIFO entries of the PmodACL2,
+ * merged into a single burst.
+ *
+ * @param acl2 points to the started PmodACL2
+ * @param status is set to the status register
+ * @param entries is set to the number of FIFO entries
+ *
+ * @return - 0 if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+static int acl2_read_fifo_status(struct Acl2Device *acl2, uint8_t *status, uint16_t *entries) {
+	struct RegmapRead reads[2];
+	uint8_t fifo_entries[2];
+	int rc;
+
+	reads[0].reg = ACL2_REG_STATUS;
+	reads[0].buf = status;
+	reads[0].buf_len = 1;
+	reads[1].reg = ACL2_REG_FIFO_ENTRIES;
+	reads[1].buf = fifo_entries;
+	reads[1].buf_len = sizeof(fifo_entries);
+
+	rc = regmap_read_merged(acl2->spi, acl2_regmap_read, reads, 2, 0);
+	if (rc < 0) {
+		return rc;
+	}
+
+	*entries = (fifo_entries[0] | fifo_entries[1] << 8) & 0x3FF;
+
+	return 0;
+}
+
+/*
+ * Wait for the FIFO watermark of the PmodACL2 to be reached.
+ *
+ * The INT1 GPIO line is waited on when available. Otherwise the status
+ * register is polled, sleeping in between for the time the missing
+ * samples take to be measured at the output data rate.
+ *
+ * @param acl2 points to the started PmodACL2
+ * @param timeout_ms maximum time to wait
+ *
+ * @return - 1 if the FIFO watermark was reached
+ *         - 0 if the timeout expired
+ *         - negative if the wait procedure failed
+ */
+int acl2_wait(struct Acl2Device *acl2, int timeout_ms) {
+	struct timespec deadline;
+	struct timespec wakeup;
+	uint8_t status;
+	uint16_t entries;
+	long wait_ns;
+	int rc;
+
+	if (acl2->int1) {
+		return gpio_wait(acl2->int1, timeout_ms);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	while (1) {
+		rc = acl2_read_fifo_status(acl2, &status, &entries);
+		if (rc < 0) {
+			return rc;
+		}
+
+		if (acl2_get_fifo_watermark(status)) {
+			return 1;
+		}
+
+		/*
+		 * Sleep until the missing samples are measured, or until
+		 * the deadline.
+		 */
+		wait_ns = 80000000L >> acl2->odr;
+		if (entries < acl2->watermark * 3) {
+			wait_ns *= (acl2->watermark * 3 - entries + 2) / 3;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &wakeup);
+		if (wakeup.tv_sec > deadline.tv_sec ||
+				(wakeup.tv_sec == deadline.tv_sec && wakeup.tv_nsec >= deadline.tv_nsec)) {
+			return 0;
+		}
+
+		wakeup.tv_sec += wait_ns / 1000000000;
+		wakeup.tv_nsec += wait_ns % 1000000000;
+		if (wakeup.tv_nsec >= 1000000000) {
+			wakeup.tv_sec++;
+			wakeup.tv_nsec -= 1000000000;
+		}
+
+		if (wakeup.tv_sec > deadline.tv_sec ||
+				(wakeup.tv_sec == deadline.tv_sec && wakeup.tv_nsec > deadline.tv_nsec)) {
+			wakeup = deadline;
+		}
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL);
+	}
+}
+
+/*
+ * Drain the FIFO of the PmodACL2 into the sample ring buffer, if the FIFO
+ * watermark was reached.
+ *
+ * All the complete samples of the FIFO are read in a single burst, and are
+ * timestamped backwards from the drain time using the output data rate.
+ * Samples that do not fit in the sample ring buffer are dropped.
+ *
+ * @param acl2 points to the started PmodACL2
+ *
+ * @return - number of samples drained if the drain procedure succeeded
+ *         - negative if the drain procedure failed
+ */
+int acl2_drain_fifo(struct Acl2Device *acl2) {
+	struct SpiMessage msg;
+	struct Acl2Sample sample;
+	struct timespec now;
+	uint8_t cmd = ACL2_CMD_READ_FIFO;
+	uint8_t status;
+	uint16_t entries;
+	uint16_t entry;
+	int16_t value;
+	long period_ns;
+	long age_ns;
+	int num_samples;
+	int axis;
+	int next_axis;
+	int i;
+	int rc;
+
+	rc = acl2_read_fifo_status(acl2, &status, &entries);
+	if (rc < 0) {
+		return rc;
+	}
+
+	if (acl2_get_fifo_overrun(status)) {
+		acl2->overruns++;
+	}
+
+	if (!acl2_get_fifo_watermark(status)) {
+		return 0;
+	}
+
+	/*
+	 * Read only complete samples, so that the next drain starts on X.
+	 */
+	entries -= entries % 3;
+	if (!entries) {
+		return 0;
+	}
+
+	spi_message_init(&msg, acl2->spi);
+	spi_message_add(&msg, &cmd, NULL, 1);
+	spi_message_add(&msg, NULL, acl2->fifo_buf, entries * 2);
+
+	rc = spi_message_transfer(&msg);
+	if (rc < 0) {
+		return rc;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	period_ns = 80000000L >> acl2->odr;
+
+	/*
+	 * Each entry holds the axis in its two upper bits and the sign-extended
+	 * 12-bit data in the lower ones, the newest sample being the last one.
+	 */
+	num_samples = 0;
+	next_axis = 0;
+	for (i = 0; i < entries; i++) {
+		entry = acl2->fifo_buf[2 * i] | acl2->fifo_buf[2 * i + 1] << 8;
+		axis = entry >> 14;
+		value = (int16_t)(entry << 2) >> 2;
+
+		/*
+		 * Resynchronize on the next X entry after an out-of-order one,
+		 * which may itself be that X entry.
+		 */
+		if (axis != next_axis) {
+			next_axis = 0;
+			if (axis != 0) {
+				continue;
+			}
+		}
+
+		if (axis == 0) {
+			sample.x = value;
+		} else if (axis == 1) {
+			sample.y = value;
+		} else {
+			sample.z = value;
+		}
+
+		next_axis = (axis + 1) % 3;
+		if (next_axis) {
+			continue;
+		}
+
+		age_ns = (entries - 1 - i) / 3 * period_ns;
+		sample.timestamp.tv_sec = now.tv_sec - age_ns / 1000000000;
+		sample.timestamp.tv_nsec = now.tv_nsec - age_ns % 1000000000;
+		if (sample.timestamp.tv_nsec < 0) {
+			sample.timestamp.tv_sec--;
+			sample.timestamp.tv_nsec += 1000000000;
+		}
+
+		if (acl2->head - acl2->tail < acl2->num_samples) {
+			acl2->samples[acl2->head & (acl2->num_samples - 1)] = sample;
+			acl2->head++;
+		}
+
+		num_samples++;
+	}
+
+	return num_samples;
+}
+
+/*
+ * Read samples out of the sample ring buffer of the PmodACL2.
+ *
+ * @param acl2 points to the started PmodACL2
+ * @param samples points to the start of the samples to be read into
+ * @param num_samples maximum number of samples to be read
+ *
+ * @return the number of samples read
+ */
+size_t acl2_read_samples(struct Acl2Device *acl2, struct Acl2Sample *samples, size_t num_samples) {
+	size_t i;
+
+	for (i = 0; i < num_samples && acl2->tail != acl2->head; i++) {
+		samples[i] = acl2->samples[acl2->tail & (acl2->num_samples - 1)];
+		acl2->tail++;
+	}
+
+	return i;
+}
+
+/*
+ * Stop continuous sampling of the PmodACL2.
+ *
+ * @param acl2 points to the started PmodACL2
+ */
+void acl2_stop(struct Acl2Device *acl2) {
+	/*
+	 * Put the PmodACL2 back in standby.
+	 */
+	acl2_write_reg(acl2->spi, ACL2_REG_POWER_CTL, 0);
+
+	free(acl2->samples);
+}
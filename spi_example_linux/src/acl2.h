@@ -0,0 +1,120 @@
+/*
+ * acl2.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "spi.h"
+#include "gpio.h"
+#include "acl2_regmap.h"
+
+#ifndef ACL2_H
+#define ACL2_H
+
+/*
+ * PmodACL2 instructions.
+ */
+#define ACL2_CMD_WRITE_REG 0x0A
+#define ACL2_CMD_READ_REG 0x0B
+#define ACL2_CMD_READ_FIFO 0x0D
+
+/*
+ * Values of the FIFO_CONTROL mode and POWER_CTL measure fields.
+ */
+#define ACL2_FIFO_MODE_STREAM 2
+#define ACL2_MEASURE_ON 2
+
+/*
+ * Output data rates, to be written into the FILTER_CTL register.
+ */
+#define ACL2_ODR_12_5HZ 0
+#define ACL2_ODR_25HZ 1
+#define ACL2_ODR_50HZ 2
+#define ACL2_ODR_100HZ 3
+#define ACL2_ODR_200HZ 4
+#define ACL2_ODR_400HZ 5
+
+/*
+ * Number of 16-bit entries of the FIFO.
+ */
+#define ACL2_FIFO_ENTRIES 512
+
+/*
+ * Acceleration sample, in mg for the default +/-2g range.
+ */
+struct Acl2Sample {
+	struct timespec timestamp; /**< CLOCK_MONOTONIC time the sample was measured at */
+	int16_t x; /**< Acceleration on the X axis */
+	int16_t y; /**< Acceleration on the Y axis */
+	int16_t z; /**< Acceleration on the Z axis */
+};
+
+/*
+ * PmodACL2 sampling continuously through its FIFO.
+ */
+struct Acl2Device {
+	struct SpiDevice *spi; /**< Started SPI device the PmodACL2 is on */
+	uint8_t odr; /**< Output data rate, eg: ACL2_ODR_400HZ */
+	uint16_t watermark; /**< Number of XYZ samples that triggers a FIFO drain */
+	size_t num_samples; /**< Size of the sample ring buffer, a power of two */
+	struct GpioLine *int1; /**< Started GPIO line INT1 is wired to, NULL to poll the status register */
+
+	struct Acl2Sample *samples; /**< Sample ring buffer */
+	size_t head; /**< Free-running write index of the sample ring buffer */
+	size_t tail; /**< Free-running read index of the sample ring buffer */
+	size_t overruns; /**< Number of FIFO overruns detected */
+	uint8_t fifo_buf[ACL2_FIFO_ENTRIES * 2]; /**< Buffer the FIFO is drained into */
+};
+
+int acl2_nwrite_reg(struct SpiDevice *dev, uint8_t reg, uint8_t *buf, int buf_len);
+int acl2_nread_reg(struct SpiDevice *dev, uint8_t reg, uint8_t *buf, int buf_len);
+int acl2_read_reg(struct SpiDevice *dev, uint8_t reg);
+int acl2_write_reg(struct SpiDevice *dev, uint8_t reg, uint8_t value);
+int acl2_start(struct Acl2Device *acl2);
+int acl2_wait(struct Acl2Device *acl2, int timeout_ms);
+int acl2_drain_fifo(struct Acl2Device *acl2);
+size_t acl2_read_samples(struct Acl2Device *acl2, struct Acl2Sample *samples, size_t num_samples);
+void acl2_stop(struct Acl2Device *acl2);
+
+/*
+ * Expand a register map (see regmap.h) into PmodACL2 SPI accessors:
+ * prefix_read_reg and prefix_write_reg for each register, prefix_read_field
+ * and prefix_write_field for each field.
+ */
+#define ACL2_REGMAP_REG(p, REG, reg, addr, width) \
+	static inline int p##_read_##reg(struct SpiDevice *dev, uint8_t *buf) { \
+		return acl2_nread_reg(dev, REG, buf, width); \
+	} \
+	static inline int p##_write_##reg(struct SpiDevice *dev, uint8_t *buf) { \
+		return acl2_nwrite_reg(dev, REG, buf, width); \
+	}
+#define ACL2_REGMAP_FIELD(p, REG, reg, FIELD, field, shift, bits) \
+	static inline int p##_read_##field(struct SpiDevice *dev, uint8_t *value) { \
+		int rc = acl2_nread_reg(dev, REG, value, 1); \
+		*value = p##_get_##field(*value); \
+		return rc; \
+	} \
+	static inline int p##_write_##field(struct SpiDevice *dev, uint8_t value) { \
+		uint8_t reg_value; \
+		int rc = acl2_nread_reg(dev, REG, &reg_value, 1); \
+		if (rc < 0) { \
+			return rc; \
+		} \
+		return acl2_write_reg(dev, REG, p##_set_##field(reg_value, value)); \
+	}
+
+ACL2_REGMAP(ACL2_REGMAP_REG, ACL2_REGMAP_FIELD)
+
+/*
+ * Burst read function of the PmodACL2 SPI backend, for regmap_read_merged.
+ */
+static inline int acl2_regmap_read(void *dev, uint8_t reg, uint8_t *buf, size_t buf_len) {
+	return acl2_nread_reg(dev, reg, buf, buf_len);
+}
+
+#endif // ACL2_H
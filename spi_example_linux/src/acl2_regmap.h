@@ -0,0 +1,54 @@
+/*
+ * acl2_regmap.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include "regmap.h"
+
+#ifndef ACL2_REGMAP_H
+#define ACL2_REGMAP_H
+
+/*
+ * Register map of the PmodACL2 (ADXL362).
+ */
+#define ACL2_REGMAP(REG, FIELD) \
+	REG(acl2, ACL2_REG_DEVID, devid, 0x00, 1) \
+	REG(acl2, ACL2_REG_XDATA, xdata, 0x08, 1) \
+	REG(acl2, ACL2_REG_YDATA, ydata, 0x09, 1) \
+	REG(acl2, ACL2_REG_ZDATA, zdata, 0x0A, 1) \
+	REG(acl2, ACL2_REG_STATUS, status, 0x0B, 1) \
+	REG(acl2, ACL2_REG_FIFO_ENTRIES, fifo_entries, 0x0C, 2) \
+	REG(acl2, ACL2_REG_XDATA16, xdata16, 0x0E, 2) \
+	REG(acl2, ACL2_REG_YDATA16, ydata16, 0x10, 2) \
+	REG(acl2, ACL2_REG_ZDATA16, zdata16, 0x12, 2) \
+	REG(acl2, ACL2_REG_TEMP16, temp16, 0x14, 2) \
+	REG(acl2, ACL2_REG_SOFT_RESET, soft_reset, 0x1F, 1) \
+	REG(acl2, ACL2_REG_FIFO_CONTROL, fifo_control, 0x28, 1) \
+	REG(acl2, ACL2_REG_FIFO_SAMPLES, fifo_samples, 0x29, 1) \
+	REG(acl2, ACL2_REG_INTMAP1, intmap1, 0x2A, 1) \
+	REG(acl2, ACL2_REG_INTMAP2, intmap2, 0x2B, 1) \
+	REG(acl2, ACL2_REG_FILTER_CTL, filter_ctl, 0x2C, 1) \
+	REG(acl2, ACL2_REG_POWER_CTL, power_ctl, 0x2D, 1) \
+	FIELD(acl2, ACL2_REG_STATUS, status, ACL2_STATUS_DATA_READY, data_ready, 0, 1) \
+	FIELD(acl2, ACL2_REG_STATUS, status, ACL2_STATUS_FIFO_READY, fifo_ready, 1, 1) \
+	FIELD(acl2, ACL2_REG_STATUS, status, ACL2_STATUS_FIFO_WATERMARK, fifo_watermark, 2, 1) \
+	FIELD(acl2, ACL2_REG_STATUS, status, ACL2_STATUS_FIFO_OVERRUN, fifo_overrun, 3, 1) \
+	FIELD(acl2, ACL2_REG_FIFO_CONTROL, fifo_control, ACL2_FIFO_CONTROL_MODE, fifo_mode, 0, 2) \
+	FIELD(acl2, ACL2_REG_FIFO_CONTROL, fifo_control, ACL2_FIFO_CONTROL_TEMP, fifo_temp, 2, 1) \
+	FIELD(acl2, ACL2_REG_FIFO_CONTROL, fifo_control, ACL2_FIFO_CONTROL_AH, fifo_ah, 3, 1) \
+	FIELD(acl2, ACL2_REG_INTMAP1, intmap1, ACL2_INTMAP1_FIFO_WATERMARK, int1_fifo_watermark, 2, 1) \
+	FIELD(acl2, ACL2_REG_INTMAP1, intmap1, ACL2_INTMAP1_INT_LOW, int1_low, 7, 1) \
+	FIELD(acl2, ACL2_REG_FILTER_CTL, filter_ctl, ACL2_FILTER_CTL_ODR, odr, 0, 3) \
+	FIELD(acl2, ACL2_REG_FILTER_CTL, filter_ctl, ACL2_FILTER_CTL_HALF_BW, half_bw, 4, 1) \
+	FIELD(acl2, ACL2_REG_FILTER_CTL, filter_ctl, ACL2_FILTER_CTL_RANGE, range, 6, 2) \
+	FIELD(acl2, ACL2_REG_POWER_CTL, power_ctl, ACL2_POWER_CTL_MEASURE, measure, 0, 2)
+
+enum {
+	ACL2_REGMAP(REGMAP_ENUM_REG, REGMAP_ENUM_FIELD)
+};
+
+ACL2_REGMAP(REGMAP_NONE, REGMAP_FIELD_HELPERS)
+
+#endif // ACL2_REGMAP_H
@@ -0,0 +1,301 @@
+/*
+ * acl2_sim.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <string.h>
+
+#include "acl2_sim.h"
+
+/*
+ * Device ID register values of the ADXL362.
+ */
+#define ACL2_SIM_DEVID_AD 0xAD
+#define ACL2_SIM_DEVID_MST 0x1D
+#define ACL2_SIM_PARTID 0xF2
+
+/*
+ * Code resetting the device when written into SOFT_RESET.
+ */
+#define ACL2_SIM_SOFT_RESET 0x52
+
+/*
+ * Put the simulated PmodACL2 in its power-on state.
+ *
+ * @param acl2 points to the simulated PmodACL2
+ */
+static void acl2_sim_reset(struct Acl2Sim *acl2) {
+	memset(acl2->regs, 0, sizeof(acl2->regs));
+	acl2->regs[0x00] = ACL2_SIM_DEVID_AD;
+	acl2->regs[0x01] = ACL2_SIM_DEVID_MST;
+	acl2->regs[0x02] = ACL2_SIM_PARTID;
+	acl2->regs[ACL2_REG_FIFO_SAMPLES] = 0x80;
+	acl2->regs[ACL2_REG_FILTER_CTL] = acl2_set_odr(0, ACL2_ODR_100HZ);
+
+	acl2->fifo_head = 0;
+	acl2->fifo_len = 0;
+	acl2->overrun = 0;
+}
+
+/*
+ * Push an entry into the FIFO, according to the FIFO mode.
+ *
+ * @param acl2 points to the simulated PmodACL2
+ * @param entry FIFO entry, axis in the two upper bits
+ */
+static void acl2_sim_push(struct Acl2Sim *acl2, uint16_t entry) {
+	uint8_t mode = acl2_get_fifo_mode(acl2->regs[ACL2_REG_FIFO_CONTROL]);
+
+	if (!mode) {
+		return;
+	}
+
+	if (acl2->fifo_len == ACL2_FIFO_ENTRIES) {
+		acl2->overrun = 1;
+
+		/*
+		 * Oldest-saved mode keeps the FIFO, the others drop the oldest entry.
+		 */
+		if (mode == 1) {
+			return;
+		}
+
+		acl2->fifo_head = (acl2->fifo_head + 1) % ACL2_FIFO_ENTRIES;
+		acl2->fifo_len--;
+	}
+
+	acl2->fifo[(acl2->fifo_head + acl2->fifo_len) % ACL2_FIFO_ENTRIES] = entry;
+	acl2->fifo_len++;
+}
+
+/*
+ * Measure a sample into the data registers and the FIFO.
+ *
+ * @param acl2 points to the simulated PmodACL2
+ * @param elapsed_s time the sample is measured at, since initialization
+ */
+static void acl2_sim_sample(struct Acl2Sim *acl2, double elapsed_s) {
+	int16_t xyz[3];
+	int16_t value;
+	int axis;
+
+	memcpy(xyz, acl2->xyz, sizeof(xyz));
+	if (acl2->script) {
+		acl2->script(acl2, elapsed_s, xyz);
+	}
+
+	for (axis = 0; axis < 3; axis++) {
+		value = xyz[axis];
+		if (value > 2047) {
+			value = 2047;
+		} else if (value < -2048) {
+			value = -2048;
+		}
+
+		acl2->regs[ACL2_REG_XDATA + axis] = value >> 4;
+		acl2->regs[ACL2_REG_XDATA16 + 2 * axis] = value & 0xFF;
+		acl2->regs[ACL2_REG_XDATA16 + 2 * axis + 1] = (uint16_t)value >> 8;
+
+		acl2_sim_push(acl2, axis << 14 | (value & 0x3FFF));
+	}
+
+	acl2->regs[ACL2_REG_STATUS] |= ACL2_STATUS_DATA_READY;
+}
+
+/*
+ * Measure the samples due since the last update, at the output data rate.
+ *
+ * @param acl2 points to the simulated PmodACL2
+ */
+static void acl2_sim_update(struct Acl2Sim *acl2) {
+	long period_ns = 80000000L >> acl2_get_odr(acl2->regs[ACL2_REG_FILTER_CTL]);
+	struct timespec now;
+	double elapsed_s;
+	long behind_ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	if (acl2_get_measure(acl2->regs[ACL2_REG_POWER_CTL]) != ACL2_MEASURE_ON) {
+		acl2->next_sample = now;
+		return;
+	}
+
+	/*
+	 * Skip the samples that would overflow the FIFO anyway.
+	 */
+	behind_ns = (now.tv_sec - acl2->next_sample.tv_sec) * 1000000000L +
+			(now.tv_nsec - acl2->next_sample.tv_nsec);
+	if (behind_ns > ACL2_FIFO_ENTRIES / 3 * period_ns) {
+		acl2->overrun = 1;
+		acl2->next_sample = now;
+	}
+
+	while (acl2->next_sample.tv_sec < now.tv_sec ||
+			(acl2->next_sample.tv_sec == now.tv_sec &&
+			acl2->next_sample.tv_nsec <= now.tv_nsec)) {
+		elapsed_s = (acl2->next_sample.tv_sec - acl2->epoch.tv_sec) +
+				(acl2->next_sample.tv_nsec - acl2->epoch.tv_nsec) / 1e9;
+		acl2_sim_sample(acl2, elapsed_s);
+
+		acl2->next_sample.tv_nsec += period_ns;
+		if (acl2->next_sample.tv_nsec >= 1000000000) {
+			acl2->next_sample.tv_sec++;
+			acl2->next_sample.tv_nsec -= 1000000000;
+		}
+	}
+}
+
+/*
+ * Read a register of the simulated PmodACL2, computing the status and
+ * FIFO registers from the FIFO state.
+ *
+ * @param acl2 points to the simulated PmodACL2
+ * @param reg register to be read
+ *
+ * @return the value of the register
+ */
+static uint8_t acl2_sim_read_reg(struct Acl2Sim *acl2, uint8_t reg) {
+	uint8_t *regs = acl2->regs;
+	size_t watermark;
+	uint8_t status;
+
+	switch (reg) {
+	case ACL2_REG_STATUS:
+		watermark = regs[ACL2_REG_FIFO_SAMPLES] |
+				acl2_get_fifo_ah(regs[ACL2_REG_FIFO_CONTROL]) << 8;
+
+		status = regs[ACL2_REG_STATUS];
+		status = acl2_set_fifo_ready(status, acl2->fifo_len > 0);
+		status = acl2_set_fifo_watermark(status, acl2->fifo_len >= watermark);
+		status = acl2_set_fifo_overrun(status, acl2->overrun);
+
+		regs[ACL2_REG_STATUS] = 0;
+		acl2->overrun = 0;
+
+		return status;
+	case ACL2_REG_FIFO_ENTRIES:
+		return acl2->fifo_len & 0xFF;
+	case ACL2_REG_FIFO_ENTRIES + 1:
+		return acl2->fifo_len >> 8;
+	default:
+		return regs[reg & 0x3F];
+	}
+}
+
+/*
+ * Write a register of the simulated PmodACL2, the read-only registers
+ * ignoring writes.
+ *
+ * @param acl2 points to the simulated PmodACL2
+ * @param reg register to be written
+ * @param value value to be written
+ */
+static void acl2_sim_write_reg(struct Acl2Sim *acl2, uint8_t reg, uint8_t value) {
+	if (reg == ACL2_REG_SOFT_RESET) {
+		if (value == ACL2_SIM_SOFT_RESET) {
+			acl2_sim_reset(acl2);
+		}
+		return;
+	}
+
+	if (reg < ACL2_REG_SOFT_RESET || reg >= sizeof(acl2->regs)) {
+		return;
+	}
+
+	acl2->regs[reg] = value;
+}
+
+/*
+ * Pop the next byte out of the FIFO, the entries being read low byte first.
+ *
+ * @param acl2 points to the simulated PmodACL2
+ * @param offset offset of the byte in the FIFO read
+ *
+ * @return the FIFO byte, 0 if the FIFO is empty
+ */
+static uint8_t acl2_sim_read_fifo(struct Acl2Sim *acl2, size_t offset) {
+	uint16_t entry;
+
+	if (!acl2->fifo_len) {
+		return 0;
+	}
+
+	entry = acl2->fifo[acl2->fifo_head];
+	if (!(offset & 1)) {
+		return entry & 0xFF;
+	}
+
+	acl2->fifo_head = (acl2->fifo_head + 1) % ACL2_FIFO_ENTRIES;
+	acl2->fifo_len--;
+
+	return entry >> 8;
+}
+
+/*
+ * Start a transaction on chip select assertion.
+ */
+static void acl2_sim_select(struct SimDevice *dev) {
+	struct Acl2Sim *acl2 = dev->priv;
+
+	acl2_sim_update(acl2);
+	acl2->index = 0;
+}
+
+/*
+ * Transfer a full-duplex segment with the simulated PmodACL2, continuing
+ * the instruction of the current transaction.
+ */
+static int acl2_sim_transfer(struct SimDevice *dev, struct TransportSegment *seg) {
+	struct Acl2Sim *acl2 = dev->priv;
+	uint8_t tx;
+	uint8_t rx;
+	size_t i;
+
+	for (i = 0; i < seg->len; i++, acl2->index++) {
+		tx = seg->write_buf ? seg->write_buf[i] : 0;
+		rx = 0;
+
+		if (acl2->index == 0) {
+			acl2->cmd = tx;
+		} else if (acl2->cmd == ACL2_CMD_READ_FIFO) {
+			rx = acl2_sim_read_fifo(acl2, acl2->index - 1);
+		} else if (acl2->index == 1) {
+			acl2->addr = tx;
+		} else if (acl2->cmd == ACL2_CMD_READ_REG) {
+			rx = acl2_sim_read_reg(acl2, acl2->addr++);
+		} else if (acl2->cmd == ACL2_CMD_WRITE_REG) {
+			acl2_sim_write_reg(acl2, acl2->addr++, tx);
+		}
+
+		if (seg->read_buf) {
+			seg->read_buf[i] = rx;
+		}
+	}
+
+	return seg->len;
+}
+
+static const struct SimDeviceOps acl2_sim_ops = {
+	.select = acl2_sim_select,
+	.transfer = acl2_sim_transfer,
+};
+
+/*
+ * Initialize a simulated PmodACL2 in its power-on state, in standby.
+ *
+ * @param acl2 points to the simulated PmodACL2, must have xyz, script and
+ *  script_priv populated
+ */
+void acl2_sim_init(struct Acl2Sim *acl2) {
+	acl2->sim.addr = 0;
+	acl2->sim.ops = &acl2_sim_ops;
+	acl2->sim.priv = acl2;
+
+	clock_gettime(CLOCK_MONOTONIC, &acl2->epoch);
+	acl2->next_sample = acl2->epoch;
+	acl2->index = 0;
+
+	acl2_sim_reset(acl2);
+}
@@ -0,0 +1,41 @@
+/*
+ * acl2_sim.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "sim.h"
+#include "acl2.h"
+
+#ifndef ACL2_SIM_H
+#define ACL2_SIM_H
+
+/*
+ * Simulated PmodACL2 (ADXL362), to be attached to a simulated SPI bus.
+ */
+struct Acl2Sim {
+	int16_t xyz[3]; /**< Acceleration measured when there is no script, in mg */
+	void (*script)(struct Acl2Sim *acl2, double elapsed_s, int16_t *xyz); /**< Acceleration over time, NULL for xyz */
+	void *script_priv; /**< Private data of the script */
+
+	struct SimDevice sim; /**< Device attached to the simulated bus */
+	struct timespec epoch; /**< Time the model was initialized at */
+	struct timespec next_sample; /**< Time the next sample is measured at */
+	uint8_t regs[0x40]; /**< Register file */
+	uint16_t fifo[ACL2_FIFO_ENTRIES]; /**< FIFO entries ring buffer */
+	size_t fifo_head; /**< Index of the oldest FIFO entry */
+	size_t fifo_len; /**< Number of FIFO entries */
+	int overrun; /**< Whether the FIFO overran since the last status read */
+	uint8_t cmd; /**< Instruction of the current transaction */
+	uint8_t addr; /**< Register address of the current transaction */
+	size_t index; /**< Index of the next byte in the current transaction */
+};
+
+void acl2_sim_init(struct Acl2Sim *acl2);
+
+#endif // ACL2_SIM_H
@@ -0,0 +1,160 @@
+/*
+ * bus_stats.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <string.h>
+
+#include "bus_stats.h"
+
+#if BUS_STATS
+/*
+ * Get the histogram bucket of a latency.
+ *
+ * @param ns the latency, in nanoseconds
+ *
+ * @return the bucket index
+ */
+static size_t bus_stats_bucket(uint64_t ns) {
+	int msb;
+
+	if (ns < 8) {
+		return ns;
+	}
+
+	if (ns >= 1ULL << 40) {
+		return BUS_STATS_BUCKETS - 1;
+	}
+
+	msb = 63 - __builtin_clzll(ns);
+
+	return (msb - 2) * 8 + ((ns >> (msb - 3)) & 7);
+}
+
+/*
+ * Record the outcome of a transaction.
+ *
+ * @param stats points to the statistics of the bus user
+ * @param start CLOCK_MONOTONIC time the transaction started at
+ * @param transferred number of bytes transferred, negative if the
+ *  transaction failed
+ * @param len number of bytes requested
+ */
+void bus_stats_record(struct BusStats *stats, const struct timespec *start,
+		long transferred, size_t len) {
+	struct timespec end;
+	int64_t ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ns = (end.tv_sec - start->tv_sec) * 1000000000LL + (end.tv_nsec - start->tv_nsec);
+
+	atomic_fetch_add_explicit(&stats->latency[bus_stats_bucket(ns < 0 ? 0 : ns)], 1,
+			memory_order_relaxed);
+
+	if (transferred < 0) {
+		atomic_fetch_add_explicit(&stats->errors, 1, memory_order_relaxed);
+		return;
+	}
+
+	atomic_fetch_add_explicit(&stats->bytes, transferred, memory_order_relaxed);
+
+	if ((size_t)transferred < len) {
+		atomic_fetch_add_explicit(&stats->short_transfers, 1, memory_order_relaxed);
+	}
+}
+#endif
+
+/*
+ * Reset the statistics of a bus user.
+ *
+ * @param stats points to the statistics to be reset
+ */
+void bus_stats_init(struct BusStats *stats) {
+#if BUS_STATS
+	size_t i;
+
+	atomic_init(&stats->bytes, 0);
+	atomic_init(&stats->errors, 0);
+	atomic_init(&stats->retries, 0);
+	atomic_init(&stats->short_transfers, 0);
+
+	for (i = 0; i < BUS_STATS_BUCKETS; i++) {
+		atomic_init(&stats->latency[i], 0);
+	}
+#else
+	(void)stats;
+#endif
+}
+
+/*
+ * Take a snapshot of the statistics of a bus user, while it may still be
+ * in use. The counters are read one by one, so they may be off by the
+ * transactions that completed meanwhile.
+ *
+ * @param stats points to the statistics
+ * @param snapshot points to the snapshot to be filled, zeroed if the
+ *  statistics are compiled out
+ */
+void bus_stats_snapshot(struct BusStats *stats, struct BusStatsSnapshot *snapshot) {
+#if BUS_STATS
+	size_t i;
+
+	snapshot->bytes = atomic_load_explicit(&stats->bytes, memory_order_relaxed);
+	snapshot->errors = atomic_load_explicit(&stats->errors, memory_order_relaxed);
+	snapshot->retries = atomic_load_explicit(&stats->retries, memory_order_relaxed);
+	snapshot->short_transfers = atomic_load_explicit(&stats->short_transfers, memory_order_relaxed);
+
+	snapshot->transactions = 0;
+	for (i = 0; i < BUS_STATS_BUCKETS; i++) {
+		snapshot->latency[i] = atomic_load_explicit(&stats->latency[i], memory_order_relaxed);
+		snapshot->transactions += snapshot->latency[i];
+	}
+#else
+	(void)stats;
+	memset(snapshot, 0, sizeof(*snapshot));
+#endif
+}
+
+/*
+ * Get the latency below which a fraction of the transactions of a
+ * snapshot completed.
+ *
+ * @param snapshot points to the snapshot
+ * @param fraction the fraction, eg: 0.99
+ *
+ * @return the upper bound of the latency bucket, in nanoseconds,
+ *  0 if there are no transactions
+ */
+uint64_t bus_stats_percentile(const struct BusStatsSnapshot *snapshot, double fraction) {
+	uint64_t total = snapshot->transactions;
+	uint64_t target;
+	uint64_t count = 0;
+	size_t i;
+	int shift;
+
+	if (!total) {
+		return 0;
+	}
+
+	target = fraction * total;
+	if (target >= total) {
+		target = total - 1;
+	}
+
+	for (i = 0; i < BUS_STATS_BUCKETS - 1; i++) {
+		count += snapshot->latency[i];
+		if (count > target) {
+			break;
+		}
+	}
+
+	if (i < 8) {
+		return i;
+	}
+
+	shift = i / 8 - 1;
+
+	return ((8 + i % 8 + 1ULL) << shift) - 1;
+}
@@ -0,0 +1,88 @@
+/*
+ * bus_stats.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef BUS_STATS_H
+#define BUS_STATS_H
+
+/*
+ * Compile-time switch of the bus statistics, build with -DBUS_STATS=0
+ * to reduce the recording to nothing.
+ */
+#ifndef BUS_STATS
+#define BUS_STATS 1
+#endif
+
+/*
+ * Number of buckets of the latency histograms. Latencies are bucketed
+ * log-linearly, 8 buckets per power of two of nanoseconds, for a precision
+ * of 12.5% up to 2^40 ns.
+ */
+#define BUS_STATS_BUCKETS 304
+
+/*
+ * Copy of the statistics of a bus user at a point in time.
+ */
+struct BusStatsSnapshot {
+	uint64_t transactions; /**< Number of transactions */
+	uint64_t bytes; /**< Number of bytes transferred */
+	uint64_t errors; /**< Number of failed transactions */
+	uint64_t retries; /**< Number of transactions retried */
+	uint64_t short_transfers; /**< Number of transactions that transferred less than requested */
+	uint64_t latency[BUS_STATS_BUCKETS]; /**< Histogram of the transaction latencies */
+};
+
+#if BUS_STATS
+
+#include <stdatomic.h>
+
+/*
+ * Statistics of a bus user, updated without locks from any thread.
+ */
+struct BusStats {
+	atomic_uint_least64_t bytes; /**< Number of bytes transferred */
+	atomic_uint_least64_t errors; /**< Number of failed transactions */
+	atomic_uint_least64_t retries; /**< Number of transactions retried */
+	atomic_uint_least64_t short_transfers; /**< Number of short transactions */
+	atomic_uint_least64_t latency[BUS_STATS_BUCKETS]; /**< Histogram of the transaction latencies, summing to the number of transactions */
+};
+
+void bus_stats_record(struct BusStats *stats, const struct timespec *start,
+		long transferred, size_t len);
+
+/*
+ * Hooks for the bus hot paths: start the latency measurement of a
+ * transaction, record its outcome, count a retry.
+ */
+#define BUS_STATS_START(start) \
+	struct timespec start; \
+	clock_gettime(CLOCK_MONOTONIC, &start)
+#define BUS_STATS_RECORD(stats, start, transferred, len) \
+	bus_stats_record(stats, &start, transferred, len)
+#define BUS_STATS_RETRY(stats) \
+	atomic_fetch_add_explicit(&(stats)->retries, 1, memory_order_relaxed)
+
+#else
+
+struct BusStats {
+	char unused; /**< Statistics are compiled out */
+};
+
+#define BUS_STATS_START(start)
+#define BUS_STATS_RECORD(stats, start, transferred, len) ((void)(stats))
+#define BUS_STATS_RETRY(stats) ((void)(stats))
+
+#endif
+
+void bus_stats_init(struct BusStats *stats);
+void bus_stats_snapshot(struct BusStats *stats, struct BusStatsSnapshot *snapshot);
+uint64_t bus_stats_percentile(const struct BusStatsSnapshot *snapshot, double fraction);
+
+#endif // BUS_STATS_H
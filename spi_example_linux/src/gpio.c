@@ -0,0 +1,123 @@
+/*
+ * gpio.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <linux/gpio.h>
+#include <sys/ioctl.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "gpio.h"
+
+/*
+ * Start watching the GPIO line for rising edges.
+ *
+ * @param line points to the GPIO line to be started, must have filename
+ *  and offset populated
+ *
+ * @return - 0 if the starting procedure succeeded
+ *         - negative if the starting procedure failed
+ */
+int gpio_start(struct GpioLine *line) {
+	struct gpioevent_request req;
+	int fd;
+	int rc;
+
+	fd = open(line->filename, O_RDWR);
+	if (fd < 0) {
+		printf("%s: failed to open GPIO chip\r\n", __func__);
+		return -errno;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.lineoffset = line->offset;
+	req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+	req.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+	strncpy(req.consumer_label, "linux-userspace-examples", sizeof(req.consumer_label) - 1);
+
+	rc = ioctl(fd, GPIO_GET_LINEEVENT_IOCTL, &req);
+	if (rc < 0) {
+		printf("%s: failed to request GPIO line events\r\n", __func__);
+		rc = -errno;
+		close(fd);
+		return rc;
+	}
+
+	/*
+	 * The line events have their own file descriptor, the chip is no
+	 * longer needed.
+	 */
+	close(fd);
+
+	line->fd = req.fd;
+
+	return 0;
+}
+
+/*
+ * Wait for a rising edge on the GPIO line.
+ *
+ * All the edges queued so far are consumed, so a single call covers
+ * edges that happened while the caller was busy.
+ *
+ * @param line points to the started GPIO line
+ * @param timeout_ms maximum time to wait, -1 to wait forever
+ *
+ * @return - 1 if an edge happened
+ *         - 0 if the timeout expired
+ *         - negative if the wait procedure failed
+ */
+int gpio_wait(struct GpioLine *line, int timeout_ms) {
+	struct gpioevent_data events[16];
+	struct pollfd fd;
+	int rc;
+
+	fd.fd = line->fd;
+	fd.events = POLLIN;
+
+	rc = poll(&fd, 1, timeout_ms);
+	if (rc < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+
+		printf("%s: failed to wait for GPIO line event\r\n", __func__);
+		return -errno;
+	}
+
+	if (rc == 0) {
+		return 0;
+	}
+
+	/*
+	 * Consume the queued events.
+	 */
+	do {
+		rc = read(line->fd, events, sizeof(events));
+		if (rc < 0) {
+			printf("%s: failed to read GPIO line events\r\n", __func__);
+			return -errno;
+		}
+
+		rc = poll(&fd, 1, 0);
+	} while (rc > 0);
+
+	return 1;
+}
+
+/*
+ * Stop watching the GPIO line.
+ *
+ * @param line points to the GPIO line to be stopped
+ */
+void gpio_stop(struct GpioLine *line) {
+	close(line->fd);
+}
@@ -0,0 +1,27 @@
+/*
+ * gpio.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdint.h>
+
+#ifndef GPIO_H
+#define GPIO_H
+
+/*
+ * GPIO line watched for rising edges, eg: a data-ready interrupt output.
+ */
+struct GpioLine {
+	char *filename; /**< Path of the GPIO chip, eg: /dev/gpiochip0 */
+	uint32_t offset; /**< Offset of the line on the GPIO chip */
+
+	int fd; /**< File descriptor for the line events */
+};
+
+int gpio_start(struct GpioLine *line);
+int gpio_wait(struct GpioLine *line, int timeout_ms);
+void gpio_stop(struct GpioLine *line);
+
+#endif // GPIO_H
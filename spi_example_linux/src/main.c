@@ -6,131 +6,66 @@
  */
 
 #include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
 
 #include "spi.h"
-
+#include "acl2.h"
+#include "gpio.h"
+#ifdef SIM
+#include "sim.h"
+#include "acl2_sim.h"
+#endif
 
 /*
- * Write data from a register of a SPI device.
- *
- * @param dev points to the SPI device to be written to
- * @param reg the register to write to
- * @param buf points to the start of buffer to be written from
- * @param buf_len length of the buffer to be written
- *
- * @return - 0 if the wrote procedure succeeded
- *         - negative if the write procedure failed
+ * GPIO line the INT1 pin of the PmodACL2 is wired to.
  */
-int acl2_nwrite_reg(struct SpiDevice *dev, uint8_t reg, uint8_t *buf, int buf_len) {
-	uint8_t *full_buf;
-	int full_buf_len;
-
-	/*
-	 * Allocate a buffer that contains the instruction and
-	 * the register address as the first two elements.
-	 */
-	full_buf_len = buf_len + 2;
-	full_buf = malloc(full_buf_len * sizeof(*full_buf));
-	full_buf[0] = 0xA;
-	full_buf[1] = reg;
-
-	/*
-	 * Copy the data to be written into the full buffer.
-	 */
-	memcpy(full_buf + 2, buf, buf_len);
-
-	/*
-	 * Transfer the instruction, register address and data.
-	 */
-	return spi_transfer(dev, full_buf, NULL, full_buf_len);
-}
+#define ACL2_INT1_GPIO_CHIP "/dev/gpiochip0"
+#define ACL2_INT1_GPIO_LINE 0
 
-/*
- * Read data from a register of a SPI device.
- *
- * @param dev points to the SPI device to be read from
- * @param reg the register to read from
- * @param buf points to the start of buffer to be read into
- * @param buf_len length of the buffer to be read
- *
- * @return - 0 if the read procedure succeeded
- *         - negative if the read procedure failed
- */
-int acl2_nread_reg(struct SpiDevice *dev, uint8_t reg, uint8_t *buf, int buf_len) {
-	uint8_t *full_buf;
-	int full_buf_len;
+int main() {
+	struct Acl2Sample samples[ACL2_FIFO_ENTRIES / 3];
+	struct Acl2Device acl2;
+	struct GpioLine int1;
+	struct SpiDevice dev;
+	size_t num_samples;
 	int rc;
+#ifdef SIM
+	struct Acl2Sim sim;
+	struct SimBus sim_bus;
 
 	/*
-	 * Allocate a buffer that contains the instruction and
-	 * the register address as the first element.
-	 */
-	full_buf_len = buf_len + 2;
-	full_buf = malloc(full_buf_len * sizeof(*full_buf));
-	full_buf[0] = 0x0B;
-	full_buf[1] = reg;
-
-	/*
-	 * Transfer the instruction, register address and data.
-	 */
-	rc = spi_transfer(dev, full_buf, full_buf, full_buf_len);
-
-	/*
-	 * Copy the read data into the buffer.
+	 * Simulate the PmodACL2 lying flat, on a 1 MHz SPI bus.
 	 */
-	memcpy(buf, full_buf + 2, buf_len);
-
-	return rc;
-}
-
-/*
- * Read value from a register of a SPI device
- *
- * @param dev points to the SPI device to be read from
- * @param reg the register to read from
- *
- * @return the value read from the register
- */
-int acl2_read_reg(struct SpiDevice *dev, uint8_t reg) {
-	uint8_t data = 0;
-	acl2_nread_reg(dev, reg, &data, 1);
-	return data;
-}
-
-/*
- * Write value to the register of a SPI device.
- *
- * @param dev points to the SPI device to be written to
- * @param reg the register to write to
- * @param value the value to be written
- *
- * @return - 0 if the write procedure succeeded
- *         - negative if the write procedure failed
- */
-int acl2_write_reg(struct SpiDevice *dev, uint8_t reg, uint8_t value) {
-	return acl2_nwrite_reg(dev, reg, &value, 1);
-}
-
-int main() {
-	uint8_t values[3];
-	uint8_t value;
-	struct SpiDevice dev;
-	int rc;
+	sim_bus.timing.clock_hz = 1000000;
+	sim_bus.timing.bits_per_byte = 8;
+	sim_bus.timing.transaction_ns = 20000;
+	sim_bus.timing.rx_buffered = 0;
+	sim_bus_init(&sim_bus);
+
+	sim.xyz[0] = 0;
+	sim.xyz[1] = 0;
+	sim.xyz[2] = 1000;
+	sim.script = NULL;
+	acl2_sim_init(&sim);
+	sim_bus_add_device(&sim_bus, &sim.sim);
+
+	dev.transport = &sim_bus.transport;
+#else
+	dev.transport = NULL;
+#endif
 
 	/*
-	 * Set the SPI bus filename, mode, bits-per-word and speed.
+	 * Set the SPI bus filename, mode, bits-per-word and speed, and read the
+	 * message length limit from spidev.
 	 * See: https://github.com/torvalds/linux/blob/master/include/uapi/linux/spi/spidev.h
 	 */
 	dev.filename = "/dev/spidev1.0";
 	dev.mode = 0;
 	dev.bpw = 8;
-	dev.speed = 100000 / 16;
+	dev.speed = 1000000;
+	dev.max_message_len = 0;
 
 	/*
-	 * Start the I2C device.
+	 * Start the SPI device.
 	 */
 	rc = spi_start(&dev);
 	if (rc) {
@@ -139,31 +74,56 @@ int main() {
 	}
 
 	/*
-	 * Read power status register.
+	 * Sample at 400 Hz, draining the FIFO every 40 samples.
 	 */
-	value = acl2_read_reg(&dev, 0x2D);
+	acl2.spi = &dev;
+	acl2.odr = ACL2_ODR_400HZ;
+	acl2.watermark = 40;
+	acl2.num_samples = 1024;
 
 	/*
-	 * Enable measurement.
+	 * Wait for the FIFO watermark on INT1 if its GPIO line is available,
+	 * poll the status register otherwise.
 	 */
-	value |= 0b0000010;
+	int1.filename = ACL2_INT1_GPIO_CHIP;
+	int1.offset = ACL2_INT1_GPIO_LINE;
+	acl2.int1 = gpio_start(&int1) ? NULL : &int1;
 
-	/*
-	 * Write back status register.
-	 */
-	acl2_write_reg(&dev, 0x2D, value);
+	rc = acl2_start(&acl2);
+	if (rc) {
+		printf("failed to start PmodACL2\r\n");
+		return rc;
+	}
 
 	while (1) {
 		/*
-		 * Burst read 0x08, 0x09, 0x0A.
+		 * Wait for the watermark to be sampled. The FIFO is drained even
+		 * on timeout, in case an edge of INT1 was missed.
 		 */
-		acl2_nread_reg(&dev, 0x08, values, 3);
-
-		printf("x: %2.2X, y: %2.2X, z: %2.2X\r\n",
-					values[0], values[1], values[2]);
+		rc = acl2_wait(&acl2, 200);
+		if (rc < 0) {
+			printf("failed to wait for PmodACL2 FIFO\r\n");
+		}
+
+		rc = acl2_drain_fifo(&acl2);
+		if (rc < 0) {
+			printf("failed to drain PmodACL2 FIFO\r\n");
+			continue;
+		}
+
+		num_samples = acl2_read_samples(&acl2, samples, sizeof(samples) / sizeof(samples[0]));
+		if (num_samples) {
+			printf("%zu samples, last x: %d, y: %d, z: %d mg\r\n", num_samples,
+					samples[num_samples - 1].x, samples[num_samples - 1].y,
+					samples[num_samples - 1].z);
+		}
+	}
 
-		sleep(1);
+	acl2_stop(&acl2);
+	if (acl2.int1) {
+		gpio_stop(&int1);
 	}
+	spi_stop(&dev);
 
     return 0;
 }
@@ -0,0 +1,93 @@
+/*
+ * regmap.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "regmap.h"
+
+/*
+ * Read multiple registers, merging the reads of neighbouring registers into
+ * bursts, for devices that auto-increment the register address during bursts.
+ *
+ * @param dev points to the device to be read from
+ * @param read the burst read function of the bus backend
+ * @param reads points to the start of the register reads, sorted in place
+ *  by register address
+ * @param num_reads number of register reads
+ * @param max_gap number of unrequested registers that may be read in between
+ *  two reads to merge them
+ *
+ * @return - 0 if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+int regmap_read_merged(void *dev, regmap_read_fn read, struct RegmapRead *reads,
+		size_t num_reads, size_t max_gap) {
+	struct RegmapRead tmp;
+	uint8_t burst[256];
+	size_t first;
+	size_t last;
+	size_t end;
+	size_t i;
+	size_t j;
+	int rc;
+
+	/*
+	 * Sort the reads by register address.
+	 */
+	for (i = 1; i < num_reads; i++) {
+		tmp = reads[i];
+		for (j = i; j > 0 && reads[j - 1].reg > tmp.reg; j--) {
+			reads[j] = reads[j - 1];
+		}
+		reads[j] = tmp;
+	}
+
+	for (first = 0; first < num_reads; first = last) {
+		/*
+		 * Extend the burst over the reads that start close enough
+		 * to its end.
+		 */
+		end = reads[first].reg + reads[first].buf_len;
+		for (last = first + 1; last < num_reads; last++) {
+			if (reads[last].reg > end + max_gap) {
+				break;
+			}
+
+			if (reads[last].reg + reads[last].buf_len > end) {
+				end = reads[last].reg + reads[last].buf_len;
+			}
+		}
+
+		if (last - first == 1) {
+			rc = read(dev, reads[first].reg, reads[first].buf, reads[first].buf_len);
+			if (rc < 0) {
+				return rc;
+			}
+
+			continue;
+		}
+
+		if (end - reads[first].reg > sizeof(burst)) {
+			return -EINVAL;
+		}
+
+		rc = read(dev, reads[first].reg, burst, end - reads[first].reg);
+		if (rc < 0) {
+			return rc;
+		}
+
+		/*
+		 * Hand out the data of each read.
+		 */
+		for (i = first; i < last; i++) {
+			memcpy(reads[i].buf, burst + reads[i].reg - reads[first].reg, reads[i].buf_len);
+		}
+	}
+
+	return 0;
+}
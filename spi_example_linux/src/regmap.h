@@ -0,0 +1,67 @@
+/*
+ * regmap.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef REGMAP_H
+#define REGMAP_H
+
+/*
+ * A register map is a table macro taking two expanders, one invoked for
+ * each register and one for each bitfield of a 8-bit register:
+ *
+ *	#define DEV_REGMAP(REG, FIELD) \
+ *		REG(dev, DEV_REG_CONFIG, config, 0x01, 1) \
+ *		FIELD(dev, DEV_REG_CONFIG, config, DEV_CONFIG_ENABLE, enable, 0, 1)
+ *
+ * REG(prefix, REG_NAME, reg_name, address, width in bytes)
+ * FIELD(prefix, REG_NAME, reg_name, FIELD_NAME, field_name, shift, bits)
+ *
+ * The table is expanded with the expanders below into constants and inline
+ * field helpers, and with the expanders of a bus backend into inline bus
+ * accessors specialized for each register and field.
+ */
+
+/*
+ * Expand a register map into register addresses and field masks,
+ * to be used inside an enum.
+ */
+#define REGMAP_ENUM_REG(p, REG, reg, addr, width) REG = (addr),
+#define REGMAP_ENUM_FIELD(p, REG, reg, FIELD, field, shift, bits) FIELD = (((1 << (bits)) - 1) << (shift)),
+
+/*
+ * Expand a register map into helpers extracting and replacing the fields
+ * of a register value.
+ */
+#define REGMAP_NONE(...)
+#define REGMAP_FIELD_HELPERS(p, REG, reg, FIELD, field, shift, bits) \
+	static inline uint8_t p##_get_##field(uint8_t value) { \
+		return (value & FIELD) >> (shift); \
+	} \
+	static inline uint8_t p##_set_##field(uint8_t value, uint8_t field_value) { \
+		return (value & ~FIELD) | ((field_value << (shift)) & FIELD); \
+	}
+
+/*
+ * Register read to be merged with the reads of neighbouring registers.
+ */
+struct RegmapRead {
+	uint8_t reg; /**< First register to read from */
+	uint8_t *buf; /**< Buffer to read the register data into */
+	size_t buf_len; /**< Length of the buffer to be read */
+};
+
+/*
+ * Burst read function of a bus backend.
+ */
+typedef int (*regmap_read_fn)(void *dev, uint8_t reg, uint8_t *buf, size_t buf_len);
+
+int regmap_read_merged(void *dev, regmap_read_fn read, struct RegmapRead *reads,
+		size_t num_reads, size_t max_gap);
+
+#endif // REGMAP_H
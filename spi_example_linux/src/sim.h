@@ -0,0 +1,73 @@
+/*
+ * sim.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "transport.h"
+
+#ifndef SIM_H
+#define SIM_H
+
+/*
+ * Timing of a simulated bus.
+ */
+struct SimTiming {
+	uint32_t clock_hz; /**< Clock of the bus, 0 for instantaneous transfers */
+	uint32_t bits_per_byte; /**< Clock cycles per byte, eg: 9 for I2C, 8 for SPI, 10 for UART 8N1 */
+	long transaction_ns; /**< Fixed overhead of each transaction, eg: syscall and chip select */
+	int rx_buffered; /**< Whether reads are served from a receive buffer without clocking the bus, eg: UART */
+};
+
+struct SimDevice;
+
+/*
+ * Operations of a simulated device model.
+ */
+struct SimDeviceOps {
+	/*
+	 * Called when a transaction starts addressing the device,
+	 * eg: chip select asserted or I2C start condition. May be NULL.
+	 */
+	void (*select)(struct SimDevice *dev);
+
+	/*
+	 * Transfer a segment with the device, returning the number of bytes
+	 * transferred or a negative error.
+	 */
+	int (*transfer)(struct SimDevice *dev, struct TransportSegment *seg);
+};
+
+/*
+ * Device model attached to a simulated bus.
+ */
+struct SimDevice {
+	uint16_t addr; /**< Address of the device, 0 on unaddressed buses such as SPI and UART */
+	const struct SimDeviceOps *ops; /**< Operations of the model */
+	void *priv; /**< State of the model */
+
+	struct SimDevice *next; /**< Next device on the bus */
+};
+
+/*
+ * Simulated bus, exposed as a transport. Not thread-safe, transactions
+ * must be serialized by the caller.
+ */
+struct SimBus {
+	struct SimTiming timing; /**< Timing of the bus */
+
+	struct Transport transport; /**< Transport to bind the bus users to */
+	struct SimDevice *devices; /**< Devices attached to the bus */
+	uint64_t transactions; /**< Number of transactions done */
+	uint64_t bytes; /**< Number of bytes transferred */
+};
+
+void sim_bus_init(struct SimBus *bus);
+void sim_bus_add_device(struct SimBus *bus, struct SimDevice *dev);
+double sim_elapsed(struct timespec *since);
+
+#endif // SIM_H
@@ -13,14 +13,102 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include "spi.h"
 
+#if BUS_STATS
+/*
+ * Get the total length of SPI transfers.
+ *
+ * @param transfers points to the start of the transfers
+ * @param num_transfers number of transfers
+ *
+ * @return the total length
+ */
+static size_t spi_transfers_len(struct spi_ioc_transfer *transfers, uint32_t num_transfers) {
+	size_t len = 0;
+	uint32_t i;
+
+	for (i = 0; i < num_transfers; i++) {
+		len += transfers[i].len;
+	}
+
+	return len;
+}
+#endif
+
+/*
+ * Transfer SPI transfers through a transport in a single transaction.
+ *
+ * Transport segments only carry the data, so the per-transfer cs_change,
+ * speed_hz, bits_per_word and delay_usecs are not passed on: the transport
+ * sees the message as a single chip select assertion at its own speed.
+ *
+ * @param transport points to the opened transport
+ * @param transfers points to the start of the transfers
+ * @param num_transfers number of transfers, at most SPI_MESSAGE_MAX_TRANSFERS
+ *
+ * @return - number of bytes transferred if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+static int spi_transport_message(struct Transport *transport, struct spi_ioc_transfer *transfers,
+		uint32_t num_transfers) {
+	struct TransportSegment segs[SPI_MESSAGE_MAX_TRANSFERS];
+	uint32_t i;
+	int len = 0;
+	int rc;
+
+	if (num_transfers > SPI_MESSAGE_MAX_TRANSFERS) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < num_transfers; i++) {
+		segs[i].addr = 0;
+		segs[i].write_buf = (const uint8_t *)(uintptr_t)transfers[i].tx_buf;
+		segs[i].read_buf = (uint8_t *)(uintptr_t)transfers[i].rx_buf;
+		segs[i].len = transfers[i].len;
+		len += transfers[i].len;
+	}
+
+	rc = transport_batch(transport, segs, num_transfers);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return len;
+}
+
+/*
+ * Read the buffer size limit of spidev.
+ *
+ * @return the limit, SPI_DEFAULT_BUFSIZ if it cannot be read
+ */
+static uint32_t spi_read_bufsiz(void) {
+	unsigned int bufsiz;
+	FILE *file;
+	int rc;
+
+	file = fopen(SPI_BUFSIZ_PATH, "r");
+	if (!file) {
+		return SPI_DEFAULT_BUFSIZ;
+	}
+
+	rc = fscanf(file, "%u", &bufsiz);
+	fclose(file);
+
+	if (rc != 1 || !bufsiz) {
+		return SPI_DEFAULT_BUFSIZ;
+	}
+
+	return bufsiz;
+}
+
 /*
  * Start the SPI device.
  *
  * @param dev points to the SPI device to be started, must have filename,
- *  mode, bpw and speed populated.
+ *  mode, bpw, speed, max_message_len and transport populated.
  *
  * @return - 0 if the starting procedure succeeded
  *         - negative if the starting procedure failed
@@ -29,9 +117,28 @@ int spi_start(struct SpiDevice *dev) {
 	int fd;
 	int rc;
 
+	bus_stats_init(&dev->stats);
+
+	/*
+	 * Devices on a transport keep the default limit of spidev, so that they
+	 * split streams the same way.
+	 */
+	if (!dev->max_message_len) {
+		dev->max_message_len = dev->transport ? SPI_DEFAULT_BUFSIZ : spi_read_bufsiz();
+	}
+
+	/*
+	 * Devices on a transport have no SPI bus file to configure.
+	 */
+	if (dev->transport) {
+		dev->fd = -1;
+		return 0;
+	}
+
 	fd = open(dev->filename, O_RDWR);
 	if (fd < 0) {
 		printf("%s: failed to start SPI\r\n", __func__);
+		rc = -errno;
 		goto fail_open;
 	}
 
@@ -107,14 +214,20 @@ int spi_transfer(struct SpiDevice *dev, uint8_t *write_buf, uint8_t *read_buf, u
 	int rc;
 
 	memset(&transfer, 0, sizeof(transfer));
-	transfer.tx_buf = (uint32_t)write_buf;
-	transfer.rx_buf = (uint32_t)read_buf;
+	transfer.tx_buf = (uintptr_t)write_buf;
+	transfer.rx_buf = (uintptr_t)read_buf;
 	transfer.len = buf_len;
 	transfer.speed_hz = dev->speed;
 	transfer.bits_per_word = dev->bpw;
 	transfer.cs_change = 1;
 
-	rc = ioctl(dev->fd, SPI_IOC_MESSAGE(1), &transfer);
+	BUS_STATS_START(start);
+	if (dev->transport) {
+		rc = spi_transport_message(dev->transport, &transfer, 1);
+	} else {
+		rc = ioctl(dev->fd, SPI_IOC_MESSAGE(1), &transfer);
+	}
+	BUS_STATS_RECORD(&dev->stats, start, rc, buf_len);
 	if (rc < 0) {
 		printf("%s: failed to start SPI transfer\r\n", __func__);
 	}
@@ -122,11 +235,259 @@ int spi_transfer(struct SpiDevice *dev, uint8_t *write_buf, uint8_t *read_buf, u
 	return rc;
 }
 
+/*
+ * Initialize an empty SPI message.
+ *
+ * @param msg points to the SPI message to be initialized
+ * @param dev points to the SPI device the message will be submitted to
+ */
+void spi_message_init(struct SpiMessage *msg, struct SpiDevice *dev) {
+	msg->dev = dev;
+	msg->num_transfers = 0;
+}
+
+/*
+ * Queue a transfer into a SPI message.
+ *
+ * The transfer inherits the speed and bits-per-word of the SPI device and
+ * keeps the chip select asserted until the end of the message. The returned
+ * transfer can be altered to override the speed, bits-per-word, delay_usecs
+ * or cs_change of this segment only, on spidev: devices on a transport
+ * ignore these overrides.
+ *
+ * @param msg points to the SPI message to queue the transfer into
+ * @param write_buf points to the start of the buffer to be written from, or NULL
+ * @param read_buf points to the start of the buffer to be read into, or NULL
+ * @param buf_len length of the buffers
+ *
+ * @return - the queued transfer if the queueing procedure succeeded
+ *         - NULL if the message is full
+ */
+struct spi_ioc_transfer *spi_message_add(struct SpiMessage *msg, uint8_t *write_buf, uint8_t *read_buf, uint32_t buf_len) {
+	struct spi_ioc_transfer *transfer;
+
+	if (msg->num_transfers >= SPI_MESSAGE_MAX_TRANSFERS) {
+		printf("%s: too many SPI transfers in message\r\n", __func__);
+		return NULL;
+	}
+
+	transfer = &msg->transfers[msg->num_transfers++];
+
+	memset(transfer, 0, sizeof(*transfer));
+	transfer->tx_buf = (uintptr_t)write_buf;
+	transfer->rx_buf = (uintptr_t)read_buf;
+	transfer->len = buf_len;
+	transfer->speed_hz = msg->dev->speed;
+	transfer->bits_per_word = msg->dev->bpw;
+
+	return transfer;
+}
+
+/*
+ * Transfer all the queued transfers of a SPI message in a single ioctl.
+ *
+ * The message is emptied afterwards, so that it can be reused.
+ *
+ * @param msg points to the SPI message to be transferred
+ *
+ * @return - number of bytes transferred if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+int spi_message_transfer(struct SpiMessage *msg) {
+	int rc;
+
+	BUS_STATS_START(start);
+	if (msg->dev->transport) {
+		rc = spi_transport_message(msg->dev->transport, msg->transfers, msg->num_transfers);
+	} else {
+		rc = ioctl(msg->dev->fd, SPI_IOC_MESSAGE(msg->num_transfers), msg->transfers);
+	}
+	BUS_STATS_RECORD(&msg->dev->stats, start, rc,
+			spi_transfers_len(msg->transfers, msg->num_transfers));
+	if (rc < 0) {
+		printf("%s: failed to start SPI message transfer\r\n", __func__);
+	}
+
+	msg->num_transfers = 0;
+
+	return rc;
+}
+
+/*
+ * Transfer a block of data of any length with the SPI device, preceded by an
+ * optional command, eg: the read command of a flash memory.
+ *
+ * spidev rejects messages longer than its buffer size limit, so the block
+ * is split into messages of max_message_len bytes, the first one carrying
+ * the command too. The chip select is kept asserted between the messages,
+ * so that the device sees a single transaction.
+ *
+ * @param dev points to the started SPI device
+ * @param cmd points to the start of the command to be written first, or NULL
+ * @param cmd_len length of the command, shorter than max_message_len
+ * @param write_buf points to the start of the buffer to be written from, or NULL
+ * @param read_buf points to the start of the buffer to be read into, or NULL
+ * @param buf_len length of the buffers
+ *
+ * @return - 0 if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+int spi_stream(struct SpiDevice *dev, uint8_t *cmd, uint32_t cmd_len, uint8_t *write_buf,
+		uint8_t *read_buf, size_t buf_len) {
+	struct spi_ioc_transfer *transfer = NULL;
+	struct SpiMessage msg;
+	size_t offset = 0;
+	size_t chunk;
+	int rc;
+
+	if (cmd_len >= dev->max_message_len) {
+		printf("%s: SPI command is too long\r\n", __func__);
+		return -EMSGSIZE;
+	}
+
+	spi_message_init(&msg, dev);
+
+	if (cmd_len) {
+		transfer = spi_message_add(&msg, cmd, NULL, cmd_len);
+	}
+
+	chunk = dev->max_message_len - cmd_len;
+
+	while (offset < buf_len) {
+		if (chunk > buf_len - offset) {
+			chunk = buf_len - offset;
+		}
+
+		transfer = spi_message_add(&msg, write_buf ? write_buf + offset : NULL,
+				read_buf ? read_buf + offset : NULL, chunk);
+		offset += chunk;
+
+		if (offset == buf_len) {
+			break;
+		}
+
+		/*
+		 * Keep the chip select asserted after the last transfer of the
+		 * message, until the next message of the stream.
+		 */
+		transfer->cs_change = 1;
+
+		rc = spi_message_transfer(&msg);
+		if (rc < 0) {
+			return rc;
+		}
+
+		chunk = dev->max_message_len;
+	}
+
+	if (!transfer) {
+		return 0;
+	}
+
+	rc = spi_message_transfer(&msg);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Allocate a page-aligned buffer for spi_stream, to be reused across
+ * streams.
+ *
+ * @param buf_len length of the buffer
+ *
+ * @return - the buffer if the allocation procedure succeeded
+ *         - NULL if the allocation procedure failed
+ */
+uint8_t *spi_alloc_buf(size_t buf_len) {
+	long page_size = sysconf(_SC_PAGESIZE);
+	void *buf;
+	int rc;
+
+	rc = posix_memalign(&buf, page_size, (buf_len + page_size - 1) & ~(page_size - 1));
+	if (rc) {
+		printf("%s: failed to allocate SPI buffer\r\n", __func__);
+		return NULL;
+	}
+
+	return buf;
+}
+
+/*
+ * Free a buffer allocated with spi_alloc_buf.
+ *
+ * @param buf points to the buffer to be freed
+ */
+void spi_free_buf(uint8_t *buf) {
+	free(buf);
+}
+
 /*
  * Stop the SPI device.
  *
  * @param dev points to the SPI device to be stopped to
  */
 void spi_stop(struct SpiDevice *dev) {
-	close(dev->fd);
+	if (!dev->transport) {
+		close(dev->fd);
+	}
+}
+
+static int spi_transport_open(struct Transport *transport) {
+	return spi_start(transport->priv);
+}
+
+static int spi_transport_batch(struct Transport *transport, struct TransportSegment *segs,
+		size_t num_segs) {
+	struct SpiMessage msg;
+	size_t i;
+
+	spi_message_init(&msg, transport->priv);
+
+	for (i = 0; i < num_segs; i++) {
+		if (!spi_message_add(&msg, (uint8_t *)segs[i].write_buf, segs[i].read_buf, segs[i].len)) {
+			return -EINVAL;
+		}
+	}
+
+	return spi_message_transfer(&msg);
+}
+
+static void spi_transport_close(struct Transport *transport) {
+	spi_stop(transport->priv);
+}
+
+const struct TransportOps spi_transport_ops = {
+	.name = "spi",
+	.open = spi_transport_open,
+	.batch = spi_transport_batch,
+	.close = spi_transport_close,
+};
+
+static int spi_async_run_transfer(struct AsyncRequest *req) {
+	return spi_transfer(req->dev, req->write_buf, req->read_buf, req->len);
+}
+
+/*
+ * Prepare an asynchronous spi_transfer, to be submitted to the worker of
+ * the SPI bus with async_submit.
+ *
+ * @param req points to the request to be prepared, having complete and
+ *  priv populated
+ * @param dev points to the started SPI device
+ * @param write_buf points to the start of buffer to be written from,
+ *  must stay valid until the request completes
+ * @param read_buf points to the start of buffer to be read into,
+ *  must stay valid until the request completes
+ * @param buf_len length of the buffers
+ */
+void spi_async_transfer(struct AsyncRequest *req, struct SpiDevice *dev, uint8_t *write_buf,
+		uint8_t *read_buf, uint32_t buf_len) {
+	req->run = spi_async_run_transfer;
+	req->dev = dev;
+	req->write_buf = write_buf;
+	req->read_buf = read_buf;
+	req->len = buf_len;
 }
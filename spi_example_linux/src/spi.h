@@ -5,11 +5,24 @@
  * @author Cosmin Tanislav
  */
 
+#include <linux/spi/spidev.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "transport.h"
+#include "bus_stats.h"
+#include "async.h"
+
 #ifndef SPI_H
 #define SPI_H
 
+/*
+ * Buffer size limit of spidev, applying to each direction of a SPI message,
+ * and its default value.
+ */
+#define SPI_BUFSIZ_PATH "/sys/module/spidev/parameters/bufsiz"
+#define SPI_DEFAULT_BUFSIZ 4096
+
 /*
  * Configuration for the SPI device.
  */
@@ -18,12 +31,50 @@ struct SpiDevice {
 	uint8_t mode; /**< Mode of the SPI bus */
 	uint8_t bpw; /**< Bits-per-word of the SPI bus */
 	uint32_t speed; /**< Speed of the SPI bus */
+	struct Transport *transport; /**< Opened transport to use instead of filename, NULL for none */
+	uint32_t max_message_len; /**< Longest SPI message in each direction, 0 to read it from SPI_BUFSIZ_PATH */
 
 	int fd; /**< File descriptor for the SPI bus */
+	struct BusStats stats; /**< Statistics of the transactions of the device */
+};
+
+/*
+ * Maximum number of transfers that can be queued into a single SPI message.
+ */
+#define SPI_MESSAGE_MAX_TRANSFERS 32
+
+/*
+ * SPI message made of multiple transfers, submitted in a single ioctl.
+ */
+struct SpiMessage {
+	struct SpiDevice *dev; /**< SPI device the message is submitted to */
+	struct spi_ioc_transfer transfers[SPI_MESSAGE_MAX_TRANSFERS]; /**< Queued transfers */
+	uint32_t num_transfers; /**< Number of queued transfers */
 };
 
 int spi_start(struct SpiDevice *dev);
 int spi_transfer(struct SpiDevice *dev, uint8_t *write_buf, uint8_t *read_buf, uint32_t buf_len);
+void spi_message_init(struct SpiMessage *msg, struct SpiDevice *dev);
+struct spi_ioc_transfer *spi_message_add(struct SpiMessage *msg, uint8_t *write_buf, uint8_t *read_buf, uint32_t buf_len);
+int spi_message_transfer(struct SpiMessage *msg);
+int spi_stream(struct SpiDevice *dev, uint8_t *cmd, uint32_t cmd_len, uint8_t *write_buf,
+		uint8_t *read_buf, size_t buf_len);
+uint8_t *spi_alloc_buf(size_t buf_len);
+void spi_free_buf(uint8_t *buf);
 void spi_stop(struct SpiDevice *dev);
 
+/*
+ * Transport backend on a real SPI bus, with a SPI device as private data,
+ * having filename, mode, bpw, speed and max_message_len populated and no
+ * transport.
+ */
+extern const struct TransportOps spi_transport_ops;
+
+/*
+ * Asynchronous transfers, run by the worker of the SPI bus (see async.h).
+ * All the devices of a bus must use the same worker.
+ */
+void spi_async_transfer(struct AsyncRequest *req, struct SpiDevice *dev, uint8_t *write_buf,
+		uint8_t *read_buf, uint32_t buf_len);
+
 #endif // SPI_H
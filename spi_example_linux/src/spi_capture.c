@@ -0,0 +1,231 @@
+/*
+ * spi_capture.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdio.h>
+#include <errno.h>
+
+#include "spi_capture.h"
+
+/*
+ * Capture thread, filling the buffers back-to-back.
+ *
+ * @param arg points to the capture
+ *
+ * @return NULL
+ */
+static void *spi_capture_run(void *arg) {
+	struct SpiCapture *capture = arg;
+	int filling = 0;
+	int other;
+	int rc;
+
+	while (1) {
+		rc = spi_stream(capture->dev, capture->cmd, capture->cmd_len, NULL,
+				capture->blocks[filling].data, capture->block_len);
+
+		pthread_mutex_lock(&capture->lock);
+
+		if (rc < 0 || !capture->running) {
+			capture->state[filling] = SPI_CAPTURE_FREE;
+			if (rc < 0) {
+				capture->error = rc;
+				capture->running = false;
+			}
+			pthread_cond_broadcast(&capture->ready);
+			pthread_mutex_unlock(&capture->lock);
+			break;
+		}
+
+		capture->blocks[filling].seq = capture->next_seq++;
+		other = !filling;
+
+		if (capture->state[other] == SPI_CAPTURE_BUSY) {
+			/*
+			 * The consumer still processes the other buffer, drop the block
+			 * just filled and fill the same buffer again.
+			 */
+			capture->overruns++;
+		} else {
+			/*
+			 * Hand the block just filled to the consumer, dropping the older
+			 * block if the consumer did not take it.
+			 */
+			if (capture->state[other] == SPI_CAPTURE_READY) {
+				capture->overruns++;
+			}
+
+			capture->state[filling] = SPI_CAPTURE_READY;
+			capture->state[other] = SPI_CAPTURE_FILLING;
+			filling = other;
+			pthread_cond_broadcast(&capture->ready);
+		}
+
+		pthread_mutex_unlock(&capture->lock);
+	}
+
+	return NULL;
+}
+
+/*
+ * Consumer thread, calling the callback for each block.
+ *
+ * @param arg points to the capture
+ *
+ * @return NULL
+ */
+static void *spi_capture_consume(void *arg) {
+	struct SpiCapture *capture = arg;
+	struct SpiBlock *block;
+
+	while (!spi_capture_get(capture, &block)) {
+		capture->complete(capture, block);
+		spi_capture_put(capture, block);
+	}
+
+	return NULL;
+}
+
+/*
+ * Start the continuous acquisition.
+ *
+ * @param capture points to the capture to be started, must have dev, cmd,
+ *  cmd_len, block_len, complete and priv populated
+ *
+ * @return - 0 if the start procedure succeeded
+ *         - negative if the start procedure failed
+ */
+int spi_capture_start(struct SpiCapture *capture) {
+	int rc;
+
+	capture->blocks[0].data = spi_alloc_buf(capture->block_len);
+	if (!capture->blocks[0].data) {
+		rc = -ENOMEM;
+		goto fail_buf0;
+	}
+
+	capture->blocks[1].data = spi_alloc_buf(capture->block_len);
+	if (!capture->blocks[1].data) {
+		rc = -ENOMEM;
+		goto fail_buf1;
+	}
+
+	capture->state[0] = SPI_CAPTURE_FILLING;
+	capture->state[1] = SPI_CAPTURE_FREE;
+	capture->next_seq = 0;
+	capture->overruns = 0;
+	capture->error = 0;
+	capture->running = true;
+
+	pthread_mutex_init(&capture->lock, NULL);
+	pthread_cond_init(&capture->ready, NULL);
+
+	rc = pthread_create(&capture->thread, NULL, spi_capture_run, capture);
+	if (rc) {
+		printf("%s: failed to create SPI capture thread\r\n", __func__);
+		rc = -rc;
+		goto fail_thread;
+	}
+
+	if (capture->complete) {
+		rc = pthread_create(&capture->consumer, NULL, spi_capture_consume, capture);
+		if (rc) {
+			printf("%s: failed to create SPI capture consumer thread\r\n", __func__);
+			rc = -rc;
+			goto fail_consumer;
+		}
+	}
+
+	return 0;
+
+fail_consumer:
+	pthread_mutex_lock(&capture->lock);
+	capture->running = false;
+	pthread_mutex_unlock(&capture->lock);
+	pthread_join(capture->thread, NULL);
+fail_thread:
+	pthread_cond_destroy(&capture->ready);
+	pthread_mutex_destroy(&capture->lock);
+	spi_free_buf(capture->blocks[1].data);
+fail_buf1:
+	spi_free_buf(capture->blocks[0].data);
+fail_buf0:
+	return rc;
+}
+
+/*
+ * Take the next captured block, waiting for it to be filled.
+ * The block must be handed back with spi_capture_put once processed.
+ *
+ * @param capture points to the started capture
+ * @param block is set to the captured block
+ *
+ * @return - 0 if a block was taken
+ *         - negative if the capture stopped, the transfer error that
+ *           stopped it or -ESHUTDOWN
+ */
+int spi_capture_get(struct SpiCapture *capture, struct SpiBlock **block) {
+	int rc = 0;
+	int i;
+
+	pthread_mutex_lock(&capture->lock);
+
+	while (1) {
+		for (i = 0; i < 2; i++) {
+			if (capture->state[i] == SPI_CAPTURE_READY) {
+				capture->state[i] = SPI_CAPTURE_BUSY;
+				*block = &capture->blocks[i];
+				goto exit;
+			}
+		}
+
+		if (!capture->running) {
+			rc = capture->error ? capture->error : -ESHUTDOWN;
+			goto exit;
+		}
+
+		pthread_cond_wait(&capture->ready, &capture->lock);
+	}
+
+exit:
+	pthread_mutex_unlock(&capture->lock);
+
+	return rc;
+}
+
+/*
+ * Hand a processed block back to the capture thread.
+ *
+ * @param capture points to the started capture
+ * @param block points to the block taken with spi_capture_get
+ */
+void spi_capture_put(struct SpiCapture *capture, struct SpiBlock *block) {
+	pthread_mutex_lock(&capture->lock);
+	capture->state[block - capture->blocks] = SPI_CAPTURE_FREE;
+	pthread_mutex_unlock(&capture->lock);
+}
+
+/*
+ * Stop the continuous acquisition, after the block being filled completes.
+ *
+ * @param capture points to the started capture
+ */
+void spi_capture_stop(struct SpiCapture *capture) {
+	pthread_mutex_lock(&capture->lock);
+	capture->running = false;
+	pthread_cond_broadcast(&capture->ready);
+	pthread_mutex_unlock(&capture->lock);
+
+	pthread_join(capture->thread, NULL);
+	if (capture->complete) {
+		pthread_join(capture->consumer, NULL);
+	}
+
+	pthread_cond_destroy(&capture->ready);
+	pthread_mutex_destroy(&capture->lock);
+	spi_free_buf(capture->blocks[1].data);
+	spi_free_buf(capture->blocks[0].data);
+}
@@ -0,0 +1,70 @@
+/*
+ * spi_capture.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spi.h"
+
+#ifndef SPI_CAPTURE_H
+#define SPI_CAPTURE_H
+
+/*
+ * States of a capture buffer.
+ */
+#define SPI_CAPTURE_FREE 0 /**< Available to the capture thread */
+#define SPI_CAPTURE_FILLING 1 /**< Being filled by the capture thread */
+#define SPI_CAPTURE_READY 2 /**< Filled, waiting for the consumer */
+#define SPI_CAPTURE_BUSY 3 /**< Being processed by the consumer */
+
+struct SpiCapture;
+
+/*
+ * Block of data captured from the SPI device.
+ */
+struct SpiBlock {
+	uint8_t *data; /**< Data of the block, block_len bytes */
+	uint64_t seq; /**< Sequence number of the block, gaps are blocks lost to overruns */
+};
+
+/*
+ * Continuous acquisition from a SPI device, double-buffered: a capture
+ * thread keeps the bus busy filling one buffer while the consumer processes
+ * the other.
+ *
+ * When the consumer falls behind, the capture thread overwrites the block
+ * the consumer did not take yet, instead of leaving the bus idle, and
+ * counts an overrun.
+ */
+struct SpiCapture {
+	struct SpiDevice *dev; /**< Started SPI device */
+	uint8_t *cmd; /**< Command written before reading each block, eg: an ADC read command, NULL for none */
+	uint32_t cmd_len; /**< Length of the command */
+	size_t block_len; /**< Length of each block */
+	void (*complete)(struct SpiCapture *capture, struct SpiBlock *block); /**< Called on a consumer thread for each block, NULL to take the blocks with spi_capture_get */
+	void *priv; /**< Private data of the callback */
+
+	struct SpiBlock blocks[2]; /**< Double buffer */
+	int state[2]; /**< State of each buffer */
+	uint64_t next_seq; /**< Sequence number of the next block */
+	uint64_t overruns; /**< Number of blocks overwritten before the consumer took them */
+	int error; /**< Error that stopped the capture, 0 for none */
+	bool running; /**< Whether the threads should keep running */
+	pthread_mutex_t lock; /**< Protects the buffer states and the counters */
+	pthread_cond_t ready; /**< Signaled when a block is ready or the capture stopped */
+	pthread_t thread; /**< Thread filling the buffers */
+	pthread_t consumer; /**< Thread calling the callback, if any */
+};
+
+int spi_capture_start(struct SpiCapture *capture);
+int spi_capture_get(struct SpiCapture *capture, struct SpiBlock **block);
+void spi_capture_put(struct SpiCapture *capture, struct SpiBlock *block);
+void spi_capture_stop(struct SpiCapture *capture);
+
+#endif // SPI_CAPTURE_H
@@ -0,0 +1,224 @@
+/*
+ * gpio_wait_test.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <linux/gpio.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+
+#include "test.h"
+#include "gpio.h"
+#include "acl2.h"
+#include "acl2_sim.h"
+#include "sim.h"
+
+/*
+ * Fake GPIO line, whose events are written into a pipe.
+ */
+struct FakeLine {
+	struct GpioLine line; /**< GPIO line reading the events from the pipe */
+	int write_fd; /**< Write end of the pipe */
+	int delay_ms; /**< Delay before the edge written by fake_line_edge_later */
+};
+
+static int fake_line_start(struct FakeLine *fake) {
+	int fds[2];
+
+	if (pipe(fds) < 0) {
+		return -1;
+	}
+
+	fake->line.filename = NULL;
+	fake->line.offset = 0;
+	fake->line.fd = fds[0];
+	fake->write_fd = fds[1];
+
+	return 0;
+}
+
+static void fake_line_edge(struct FakeLine *fake, size_t num_edges) {
+	struct gpioevent_data event;
+	size_t i;
+
+	memset(&event, 0, sizeof(event));
+	event.id = GPIOEVENT_EVENT_RISING_EDGE;
+
+	for (i = 0; i < num_edges; i++) {
+		if (write(fake->write_fd, &event, sizeof(event)) != sizeof(event)) {
+			printf("%s: failed to write GPIO line event\r\n", __func__);
+		}
+	}
+}
+
+static void *fake_line_edge_later(void *arg) {
+	struct FakeLine *fake = arg;
+
+	usleep(fake->delay_ms * 1000);
+	fake_line_edge(fake, 1);
+
+	return NULL;
+}
+
+static void fake_line_stop(struct FakeLine *fake) {
+	gpio_stop(&fake->line);
+	close(fake->write_fd);
+}
+
+static long elapsed_ms(struct timespec *start) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void test_gpio_wait(void) {
+	struct FakeLine fake;
+	struct timespec start;
+
+	if (fake_line_start(&fake) < 0) {
+		TEST_CHECK(!"failed to create pipe");
+		return;
+	}
+
+	TEST_CHECK(gpio_wait(&fake.line, 0) == 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	TEST_CHECK(gpio_wait(&fake.line, 20) == 0);
+	TEST_CHECK(elapsed_ms(&start) >= 20);
+
+	/*
+	 * A single wait consumes all the queued edges, more than fit in one
+	 * read.
+	 */
+	fake_line_edge(&fake, 40);
+	TEST_CHECK(gpio_wait(&fake.line, 0) == 1);
+	TEST_CHECK(gpio_wait(&fake.line, 0) == 0);
+
+	fake_line_stop(&fake);
+}
+
+static void test_acl2_wait_gpio(void) {
+	struct Acl2Device acl2;
+	struct FakeLine fake;
+	struct timespec start;
+	pthread_t thread;
+
+	if (fake_line_start(&fake) < 0) {
+		TEST_CHECK(!"failed to create pipe");
+		return;
+	}
+
+	/*
+	 * The PmodACL2 is not accessed while INT1 is waited on.
+	 */
+	memset(&acl2, 0, sizeof(acl2));
+	acl2.int1 = &fake.line;
+
+	fake.delay_ms = 20;
+	pthread_create(&thread, NULL, fake_line_edge_later, &fake);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	TEST_CHECK(acl2_wait(&acl2, 1000) == 1);
+	TEST_CHECK(elapsed_ms(&start) >= 15 && elapsed_ms(&start) < 1000);
+
+	pthread_join(thread, NULL);
+
+	TEST_CHECK(acl2_wait(&acl2, 10) == 0);
+
+	fake_line_stop(&fake);
+}
+
+static void test_acl2_wait_poll(struct SpiDevice *dev) {
+	struct Acl2Sample samples[ACL2_FIFO_ENTRIES / 3];
+	struct Acl2Device acl2;
+	struct timespec start;
+	size_t num_samples;
+	long elapsed;
+	int rc;
+
+	/*
+	 * 8 samples at 400 Hz reach the watermark in 20 ms.
+	 */
+	acl2.spi = dev;
+	acl2.odr = ACL2_ODR_400HZ;
+	acl2.watermark = 8;
+	acl2.num_samples = 64;
+	acl2.int1 = NULL;
+
+	rc = acl2_start(&acl2);
+	TEST_CHECK(rc == 0);
+	if (rc) {
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	TEST_CHECK(acl2_wait(&acl2, 1000) == 1);
+	elapsed = elapsed_ms(&start);
+	TEST_CHECK(elapsed >= 15 && elapsed < 200);
+
+	TEST_CHECK(acl2_drain_fifo(&acl2) >= 8);
+	num_samples = acl2_read_samples(&acl2, samples, sizeof(samples) / sizeof(samples[0]));
+	TEST_CHECK(num_samples >= 8);
+	if (num_samples) {
+		TEST_CHECK(samples[num_samples - 1].z == 1000);
+	}
+
+	/*
+	 * The polling gives up at the deadline when the watermark is farther.
+	 */
+	TEST_CHECK(acl2_wait(&acl2, 5) == 0);
+
+	acl2_stop(&acl2);
+}
+
+int main() {
+	struct SpiDevice dev;
+	struct SimBus sim_bus;
+	struct Acl2Sim sim;
+	int rc;
+
+	test_gpio_wait();
+	test_acl2_wait_gpio();
+
+	/*
+	 * Poll the status register of a simulated PmodACL2 lying flat.
+	 */
+	sim_bus.timing.clock_hz = 1000000;
+	sim_bus.timing.bits_per_byte = 8;
+	sim_bus.timing.transaction_ns = 20000;
+	sim_bus.timing.rx_buffered = 0;
+	sim_bus_init(&sim_bus);
+
+	sim.xyz[0] = 0;
+	sim.xyz[1] = 0;
+	sim.xyz[2] = 1000;
+	sim.script = NULL;
+	acl2_sim_init(&sim);
+	sim_bus_add_device(&sim_bus, &sim.sim);
+
+	dev.filename = "sim";
+	dev.mode = 0;
+	dev.bpw = 8;
+	dev.speed = 1000000;
+	dev.max_message_len = 0;
+	dev.transport = &sim_bus.transport;
+
+	rc = spi_start(&dev);
+	if (rc) {
+		printf("failed to start SPI device\r\n");
+		return 1;
+	}
+
+	test_acl2_wait_poll(&dev);
+
+	spi_stop(&dev);
+
+	return test_report("gpio_wait_test");
+}
@@ -0,0 +1,237 @@
+/*
+ * spi_message_test.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <linux/spi/spidev.h>
+#include <sys/ioctl.h>
+
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+#include "spi.h"
+
+/*
+ * Maximum number of SPI messages recorded by the fake spidev.
+ */
+#define FAKE_MAX_MESSAGES 8
+
+/*
+ * SPI message received by the fake spidev.
+ */
+struct FakeMessage {
+	struct spi_ioc_transfer transfers[SPI_MESSAGE_MAX_TRANSFERS]; /**< Transfers of the message */
+	uint32_t num_transfers; /**< Number of transfers */
+};
+
+static struct FakeMessage fake_messages[FAKE_MAX_MESSAGES];
+static size_t fake_num_messages;
+static uint8_t fake_next_byte;
+
+/*
+ * Fake spidev, interposed on the ioctl calls of the SPI driver: the
+ * configuration requests succeed, and the messages are recorded and answered
+ * with a running byte counter, one count per byte clocked on the bus.
+ */
+int ioctl(int fd, unsigned long request, ...) {
+	struct spi_ioc_transfer *transfers;
+	struct FakeMessage *msg;
+	uint32_t num_transfers;
+	uint8_t *rx_buf;
+	int len = 0;
+	uint32_t i;
+	uint32_t j;
+	va_list args;
+
+	(void)fd;
+
+	va_start(args, request);
+	transfers = va_arg(args, struct spi_ioc_transfer *);
+	va_end(args);
+
+	if (_IOC_TYPE(request) != SPI_IOC_MAGIC || _IOC_NR(request) != 0) {
+		return 0;
+	}
+
+	num_transfers = _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer);
+	if (fake_num_messages == FAKE_MAX_MESSAGES || num_transfers > SPI_MESSAGE_MAX_TRANSFERS) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	msg = &fake_messages[fake_num_messages++];
+	memcpy(msg->transfers, transfers, num_transfers * sizeof(*transfers));
+	msg->num_transfers = num_transfers;
+
+	for (i = 0; i < num_transfers; i++) {
+		rx_buf = (uint8_t *)(uintptr_t)transfers[i].rx_buf;
+		for (j = 0; j < transfers[i].len; j++) {
+			if (rx_buf) {
+				rx_buf[j] = fake_next_byte;
+			}
+			fake_next_byte++;
+		}
+
+		len += transfers[i].len;
+	}
+
+	return len;
+}
+
+static void fake_reset(void) {
+	memset(fake_messages, 0, sizeof(fake_messages));
+	fake_num_messages = 0;
+	fake_next_byte = 0;
+}
+
+static void test_message_layout(struct SpiDevice *dev) {
+	struct spi_ioc_transfer *transfer;
+	struct SpiMessage msg;
+	uint8_t cmd[2] = { 0x0B, 0x00 };
+	uint8_t write_buf[4] = { 1, 2, 3, 4 };
+	uint8_t read_buf[4];
+	uint8_t data[3];
+	int rc;
+
+	fake_reset();
+
+	spi_message_init(&msg, dev);
+	TEST_CHECK(spi_message_add(&msg, cmd, NULL, sizeof(cmd)) != NULL);
+	TEST_CHECK(spi_message_add(&msg, write_buf, read_buf, sizeof(write_buf)) != NULL);
+	transfer = spi_message_add(&msg, NULL, data, sizeof(data));
+	TEST_CHECK(transfer != NULL);
+	transfer->speed_hz = 500000;
+	transfer->cs_change = 1;
+
+	rc = spi_message_transfer(&msg);
+	TEST_CHECK(rc == 9);
+	TEST_CHECK(msg.num_transfers == 0);
+
+	/*
+	 * A single message carrying the three segments, in order, with the
+	 * settings of the device unless overridden.
+	 */
+	TEST_CHECK(fake_num_messages == 1);
+	TEST_CHECK(fake_messages[0].num_transfers == 3);
+
+	transfer = fake_messages[0].transfers;
+	TEST_CHECK(transfer[0].tx_buf == (uintptr_t)cmd && transfer[0].rx_buf == 0);
+	TEST_CHECK(transfer[0].len == 2);
+	TEST_CHECK(transfer[1].tx_buf == (uintptr_t)write_buf && transfer[1].rx_buf == (uintptr_t)read_buf);
+	TEST_CHECK(transfer[1].len == 4);
+	TEST_CHECK(transfer[2].tx_buf == 0 && transfer[2].rx_buf == (uintptr_t)data);
+	TEST_CHECK(transfer[2].len == 3);
+
+	TEST_CHECK(transfer[0].speed_hz == dev->speed && transfer[1].speed_hz == dev->speed);
+	TEST_CHECK(transfer[2].speed_hz == 500000);
+	TEST_CHECK(transfer[0].bits_per_word == dev->bpw && transfer[2].bits_per_word == dev->bpw);
+	TEST_CHECK(!transfer[0].cs_change && !transfer[1].cs_change && transfer[2].cs_change);
+
+	TEST_CHECK(read_buf[0] == 2 && read_buf[3] == 5);
+	TEST_CHECK(data[0] == 6 && data[2] == 8);
+}
+
+static void test_message_full(struct SpiDevice *dev) {
+	struct SpiMessage msg;
+	uint8_t byte;
+	int i;
+
+	spi_message_init(&msg, dev);
+	for (i = 0; i < SPI_MESSAGE_MAX_TRANSFERS; i++) {
+		TEST_CHECK(spi_message_add(&msg, &byte, NULL, 1) != NULL);
+	}
+
+	TEST_CHECK(spi_message_add(&msg, &byte, NULL, 1) == NULL);
+	TEST_CHECK(msg.num_transfers == SPI_MESSAGE_MAX_TRANSFERS);
+}
+
+static void test_stream_split(struct SpiDevice *dev) {
+	struct spi_ioc_transfer *transfer;
+	uint8_t cmd[2] = { 0x03, 0x00 };
+	uint8_t read_buf[150];
+	size_t i;
+	int rc;
+
+	fake_reset();
+
+	/*
+	 * 2 command bytes and 150 data bytes in messages of 64 bytes:
+	 * the command and 62 bytes, 64 bytes, then the last 24 bytes.
+	 */
+	rc = spi_stream(dev, cmd, sizeof(cmd), NULL, read_buf, sizeof(read_buf));
+	TEST_CHECK(rc == 0);
+	TEST_CHECK(fake_num_messages == 3);
+
+	TEST_CHECK(fake_messages[0].num_transfers == 2);
+	transfer = fake_messages[0].transfers;
+	TEST_CHECK(transfer[0].tx_buf == (uintptr_t)cmd && transfer[0].len == 2);
+	TEST_CHECK(transfer[1].rx_buf == (uintptr_t)read_buf && transfer[1].len == 62);
+	TEST_CHECK(!transfer[0].cs_change && transfer[1].cs_change);
+
+	TEST_CHECK(fake_messages[1].num_transfers == 1);
+	transfer = fake_messages[1].transfers;
+	TEST_CHECK(transfer[0].rx_buf == (uintptr_t)(read_buf + 62) && transfer[0].len == 64);
+	TEST_CHECK(transfer[0].tx_buf == 0 && transfer[0].cs_change);
+
+	/*
+	 * The chip select is released at the end of the last message only.
+	 */
+	TEST_CHECK(fake_messages[2].num_transfers == 1);
+	transfer = fake_messages[2].transfers;
+	TEST_CHECK(transfer[0].rx_buf == (uintptr_t)(read_buf + 126) && transfer[0].len == 24);
+	TEST_CHECK(!transfer[0].cs_change);
+
+	for (i = 0; i < sizeof(read_buf); i++) {
+		if (read_buf[i] != (uint8_t)(sizeof(cmd) + i)) {
+			break;
+		}
+	}
+	TEST_CHECK(i == sizeof(read_buf));
+
+	TEST_CHECK(spi_stream(dev, cmd, dev->max_message_len, NULL, read_buf, 1) == -EMSGSIZE);
+}
+
+static void test_stream_exact(struct SpiDevice *dev) {
+	uint8_t write_buf[128] = { 0 };
+
+	fake_reset();
+
+	/*
+	 * A stream of exactly two messages leaves no empty message behind.
+	 */
+	TEST_CHECK(spi_stream(dev, NULL, 0, write_buf, NULL, sizeof(write_buf)) == 0);
+	TEST_CHECK(fake_num_messages == 2);
+	TEST_CHECK(fake_messages[0].transfers[0].len == 64 && fake_messages[0].transfers[0].cs_change);
+	TEST_CHECK(fake_messages[1].transfers[0].len == 64 && !fake_messages[1].transfers[0].cs_change);
+}
+
+int main() {
+	struct SpiDevice dev;
+	int rc;
+
+	dev.filename = "/dev/null";
+	dev.mode = SPI_MODE_0;
+	dev.bpw = 8;
+	dev.speed = 1000000;
+	dev.transport = NULL;
+	dev.max_message_len = 64;
+
+	rc = spi_start(&dev);
+	if (rc) {
+		printf("failed to start SPI device\r\n");
+		return 1;
+	}
+
+	test_message_layout(&dev);
+	test_message_full(&dev);
+	test_stream_split(&dev);
+	test_stream_exact(&dev);
+
+	spi_stop(&dev);
+
+	return test_report("spi_message_test");
+}
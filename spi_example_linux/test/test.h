@@ -0,0 +1,42 @@
+/*
+ * test.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdio.h>
+
+#ifndef TEST_H
+#define TEST_H
+
+/*
+ * Number of failed checks of the test program.
+ */
+static int test_failures;
+
+/*
+ * Check a condition, reporting it and carrying on when it does not hold.
+ */
+#define TEST_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: %s: check failed: %s\r\n", __FILE__, __LINE__, __func__, #cond); \
+			test_failures++; \
+		} \
+	} while (0)
+
+/*
+ * Report the outcome of the test program.
+ *
+ * @param name name of the test program
+ *
+ * @return the exit status of the test program, 0 if all the checks held
+ */
+static inline int test_report(const char *name) {
+	printf("%s: %s, %d failed checks\r\n", name, test_failures ? "FAIL" : "PASS", test_failures);
+
+	return test_failures ? 1 : 0;
+}
+
+#endif // TEST_H
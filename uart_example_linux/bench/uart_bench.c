@@ -0,0 +1,353 @@
+/*
+ * uart_bench.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "bench.h"
+#include "uart.h"
+#include "uart_uring.h"
+#include "frame.h"
+#include "sim.h"
+#include "loopback_sim.h"
+
+#define UART_BENCH_NUM_OPS 6
+
+/*
+ * Length of the data written or read by each operation.
+ */
+#define UART_BENCH_LEN 64
+
+/*
+ * UART device under benchmark and its peer, the other end of the line,
+ * used to feed and drain the device outside of the measurements.
+ */
+struct UartBench {
+	struct UartDevice *dev; /**< Started UART device under benchmark */
+	int master; /**< Master of the pty pair the device is on, -1 on the simulator */
+	struct Transport *peer; /**< Simulated bus, bypassing the transaction counter */
+	struct AsyncBus async; /**< Worker running the asynchronous writes */
+	struct UartUring ring; /**< Ring batching the writes, through io_uring on the pty */
+	bool count_submits; /**< Whether the ring bypasses the transaction counter, its submits being counted instead */
+	uint8_t buf[UART_BENCH_LEN + 1]; /**< Data written and read */
+};
+
+/*
+ * Send data from the peer to the UART device.
+ */
+static int uart_bench_feed(void *priv) {
+	struct UartBench *bench = priv;
+	struct TransportSegment seg;
+	size_t i;
+
+	for (i = 0; i < UART_BENCH_LEN; i++) {
+		bench->buf[i] = 'a' + i % 26;
+	}
+
+	if (bench->master >= 0) {
+		return write(bench->master, bench->buf, UART_BENCH_LEN);
+	}
+
+	seg.addr = 0;
+	seg.write_buf = bench->buf;
+	seg.read_buf = NULL;
+	seg.len = UART_BENCH_LEN;
+
+	return transport_transfer(bench->peer, &seg);
+}
+
+/*
+ * Receive and discard on the peer everything the UART device sent.
+ */
+static int uart_bench_drain(void *priv) {
+	struct UartBench *bench = priv;
+	struct TransportSegment seg;
+	uint8_t buf[LOOPBACK_SIM_BUF_LEN];
+
+	if (bench->master >= 0) {
+		while (read(bench->master, buf, sizeof(buf)) > 0);
+		return 0;
+	}
+
+	seg.addr = 0;
+	seg.write_buf = NULL;
+	seg.read_buf = buf;
+	seg.len = sizeof(buf);
+
+	return transport_transfer(bench->peer, &seg);
+}
+
+static int bench_writen(void *priv) {
+	struct UartBench *bench = priv;
+
+	return uart_writen(bench->dev, (char *)bench->buf, UART_BENCH_LEN);
+}
+
+static int bench_async_writen(void *priv) {
+	struct UartBench *bench = priv;
+	struct AsyncRequest req;
+	int rc;
+
+	req.complete = NULL;
+	req.priv = NULL;
+	uart_async_writen(&req, bench->dev, bench->buf, UART_BENCH_LEN);
+
+	rc = async_submit(&bench->async, &req);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return async_wait(&bench->async, &req);
+}
+
+static int bench_uring_write(void *priv) {
+	struct UartBench *bench = priv;
+	struct UartIo *done;
+	struct UartIo io;
+	int rc;
+
+	io.port = 0;
+	io.buf = uart_uring_buf(&bench->ring, 0);
+	io.len = UART_BENCH_LEN;
+	io.write = true;
+	io.priv = NULL;
+
+	rc = uart_uring_queue(&bench->ring, &io);
+	if (rc < 0) {
+		return rc;
+	}
+
+	rc = uart_uring_submit(&bench->ring, 1);
+	if (rc < 0) {
+		return rc;
+	}
+
+	if (bench->count_submits) {
+		bench_count_transaction();
+	}
+
+	if (uart_uring_reap(&bench->ring, &done, 1) != 1) {
+		return -EIO;
+	}
+
+	return done->result;
+}
+
+static int bench_readn(void *priv) {
+	struct UartBench *bench = priv;
+	size_t total = 0;
+	int rc;
+
+	while (total < UART_BENCH_LEN) {
+		rc = uart_readn(bench->dev, bench->buf + total, UART_BENCH_LEN - total);
+		if (rc < 0) {
+			return rc;
+		}
+
+		total += rc;
+	}
+
+	return total;
+}
+
+static int bench_reads(void *priv) {
+	struct UartBench *bench = priv;
+	size_t total = 0;
+	int rc;
+
+	while (total < UART_BENCH_LEN) {
+		rc = uart_reads(bench->dev, (char *)bench->buf, UART_BENCH_LEN - total + 1);
+		if (rc < 0) {
+			return rc;
+		}
+
+		total += rc;
+	}
+
+	return total;
+}
+
+static int bench_frame_write(void *priv) {
+	struct UartBench *bench = priv;
+
+	return frame_write(bench->dev, bench->buf, UART_BENCH_LEN);
+}
+
+/*
+ * Open a pty pair, the slave standing for the UART device.
+ *
+ * @param slave_name points to the name of the slave to be filled
+ *
+ * @return - the non-blocking master if the opening procedure succeeded
+ *         - negative if the opening procedure failed
+ */
+static int uart_bench_open_pty(char **slave_name) {
+	int master;
+
+	master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (master < 0) {
+		return -errno;
+	}
+
+	if (grantpt(master) || unlockpt(master) || !(*slave_name = ptsname(master))) {
+		close(master);
+		return -errno;
+	}
+
+	return master;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [-p] [-r rate] [-n iterations]\n", name);
+	fprintf(stderr, "  -p  benchmark a pty pair instead of the simulator\n");
+	fprintf(stderr, "  -r  baud-rate of the UART, default 115200\n");
+	fprintf(stderr, "  -n  number of iterations per operation, default 10000\n");
+}
+
+int main(int argc, char **argv) {
+	struct BenchResult results[UART_BENCH_NUM_OPS];
+	struct BenchCounter counter;
+	struct UartBench bench;
+	struct Transport real;
+	struct UartDevice *ring_devs[1];
+	struct UartDevice real_dev;
+	struct UartDevice dev;
+	struct LoopbackSim loopback;
+	struct SimBus sim_bus;
+	size_t iterations = 10000;
+	int rate = 115200;
+	int pty = 0;
+	int opt;
+	int rc;
+
+	while ((opt = getopt(argc, argv, "pr:n:")) != -1) {
+		switch (opt) {
+		case 'p':
+			pty = 1;
+			break;
+		case 'r':
+			rate = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	/*
+	 * Count the transactions of either the pty or the simulator.
+	 */
+	if (pty) {
+		bench.master = uart_bench_open_pty(&real_dev.filename);
+		if (bench.master < 0) {
+			printf("failed to open pty\r\n");
+			return bench.master;
+		}
+
+		real_dev.rate = rate;
+		real_dev.transport = NULL;
+		real.ops = &uart_transport_ops;
+		real.priv = &real_dev;
+
+		rc = transport_open(&real);
+		if (rc) {
+			printf("failed to start UART device\r\n");
+			return rc;
+		}
+
+		counter.inner = &real;
+	} else {
+		sim_bus.timing.clock_hz = 0;
+		sim_bus.timing.bits_per_byte = 10;
+		sim_bus.timing.transaction_ns = 0;
+		sim_bus.timing.rx_buffered = 1;
+		sim_bus_init(&sim_bus);
+
+		loopback_sim_init(&loopback);
+		sim_bus_add_device(&sim_bus, &loopback.sim);
+
+		bench.master = -1;
+		bench.peer = &sim_bus.transport;
+		counter.inner = &sim_bus.transport;
+	}
+
+	bench_counter_init(&counter);
+
+	dev.filename = NULL;
+	dev.rate = rate;
+	dev.transport = &counter.transport;
+
+	rc = uart_start(&dev, false);
+	if (rc) {
+		printf("failed to start UART device\r\n");
+		return rc;
+	}
+
+	bench.dev = &dev;
+
+	bench_run("uart_writen_64", bench_writen, uart_bench_drain, &bench, iterations, &results[0]);
+	bench_run("uart_readn_64", bench_readn, uart_bench_feed, &bench, iterations, &results[1]);
+	bench_run("uart_reads_64", bench_reads, uart_bench_feed, &bench, iterations, &results[2]);
+	bench_run("frame_write_64", bench_frame_write, uart_bench_drain, &bench, iterations, &results[3]);
+
+	/*
+	 * Round trip of a write through the worker of the transmit direction.
+	 */
+	bench.async.name = "tx";
+	rc = async_start(&bench.async);
+	if (rc) {
+		printf("failed to start UART worker\r\n");
+		return rc;
+	}
+
+	bench_run("uart_async_writen_64", bench_async_writen, uart_bench_drain, &bench, iterations, &results[4]);
+	async_stop(&bench.async);
+
+	/*
+	 * Write through io_uring on the pty, bypassing the transaction counter,
+	 * so that each submit is counted as a single syscall instead, through
+	 * the synchronous fallback on the simulator.
+	 */
+	ring_devs[0] = pty ? &real_dev : &dev;
+	bench.count_submits = pty;
+	bench.ring.entries = 8;
+	bench.ring.devs = ring_devs;
+	bench.ring.num_devs = 1;
+	bench.ring.num_bufs = 1;
+	bench.ring.buf_len = UART_BENCH_LEN;
+	bench.ring.sync = false;
+
+	rc = uart_uring_start(&bench.ring);
+	if (rc) {
+		printf("failed to start UART ring\r\n");
+		return rc;
+	}
+
+	memcpy(uart_uring_buf(&bench.ring, 0), bench.buf, UART_BENCH_LEN);
+	bench_run("uart_uring_write_64", bench_uring_write, uart_bench_drain, &bench, iterations, &results[5]);
+	uart_uring_stop(&bench.ring);
+
+	bench_print_json(stdout, "uart", pty ? "pty" : "sim", results, UART_BENCH_NUM_OPS);
+
+	uart_stop(&dev);
+
+	if (pty) {
+		transport_close(&real);
+		close(bench.master);
+	}
+
+	return 0;
+}
@@ -0,0 +1,470 @@
+/*
+ * frame.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <sys/uio.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "frame.h"
+
+/*
+ * CRC-16/CCITT lookup table, polynomial 0x1021.
+ */
+static const uint16_t frame_crc16_table[256] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+	0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+	0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+	0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+	0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+	0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+	0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+	0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+	0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+	0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+	0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+	0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+	0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+	0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+	0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+	0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+	0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+	0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+	0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+	0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+	0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+	0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+/*
+ * Compute the CRC-16/CCITT of a buffer.
+ *
+ * @param crc the CRC of the preceding data, 0xFFFF for the first buffer
+ * @param buf points to the start of buffer
+ * @param buf_len length of the buffer
+ *
+ * @return the updated CRC
+ */
+uint16_t frame_crc16(uint16_t crc, const uint8_t *buf, size_t buf_len) {
+	size_t i;
+
+	for (i = 0; i < buf_len; i++) {
+		crc = (crc << 8) ^ frame_crc16_table[(crc >> 8) ^ buf[i]];
+	}
+
+	return crc;
+}
+
+#if BUS_STATS
+/*
+ * Get the total length of I/O vectors.
+ *
+ * @param iov points to the start of the I/O vectors
+ * @param iov_len number of I/O vectors
+ *
+ * @return the total length
+ */
+static size_t frame_iov_len(struct iovec *iov, int iov_len) {
+	size_t len = 0;
+	int i;
+
+	for (i = 0; i < iov_len; i++) {
+		len += iov[i].iov_len;
+	}
+
+	return len;
+}
+#endif
+
+/*
+ * Write all the given I/O vectors to the UART device, resuming short writes.
+ *
+ * @param dev points to the UART device to be written to
+ * @param iov points to the start of the I/O vectors, modified on short writes
+ * @param iov_len number of I/O vectors
+ *
+ * @return - 0 if the write procedure succeeded
+ *         - negative if the write procedure failed
+ */
+static int frame_writev(struct UartDevice* dev, struct iovec *iov, int iov_len) {
+	struct TransportSegment segs[FRAME_MAX_IOV];
+	ssize_t rc;
+	int i;
+
+	/*
+	 * Transports take the I/O vectors as a single batch.
+	 */
+	if (dev->transport) {
+		for (i = 0; i < iov_len; i++) {
+			segs[i].addr = 0;
+			segs[i].write_buf = iov[i].iov_base;
+			segs[i].read_buf = NULL;
+			segs[i].len = iov[i].iov_len;
+		}
+
+		BUS_STATS_START(start);
+		rc = transport_batch(dev->transport, segs, iov_len);
+		BUS_STATS_RECORD(&dev->tx_stats, start, rc < 0 ? rc : (long)frame_iov_len(iov, iov_len),
+				frame_iov_len(iov, iov_len));
+		if (rc < 0) {
+			printf("%s: failed to write uart frame\r\n", __func__);
+			return rc;
+		}
+
+		return 0;
+	}
+
+	while (iov_len) {
+		BUS_STATS_START(start);
+		rc = writev(dev->fd, iov, iov_len);
+		BUS_STATS_RECORD(&dev->tx_stats, start, rc, frame_iov_len(iov, iov_len));
+		if (rc < 0) {
+			if (errno == EINTR) {
+				BUS_STATS_RETRY(&dev->tx_stats);
+				continue;
+			}
+
+			printf("%s: failed to write uart frame\r\n", __func__);
+			return -errno;
+		}
+
+		/*
+		 * Skip the I/O vectors that were fully written.
+		 */
+		while (iov_len && (size_t)rc >= iov->iov_len) {
+			rc -= iov->iov_len;
+			iov++;
+			iov_len--;
+		}
+
+		if (iov_len) {
+			iov->iov_base = (uint8_t *)iov->iov_base + rc;
+			iov->iov_len -= rc;
+			BUS_STATS_RETRY(&dev->tx_stats);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Initialize the frame decoder.
+ *
+ * @param dec points to the frame decoder to be initialized, must have size
+ *  populated, large enough to hold at least one encoded frame
+ *
+ * @return - 0 if the initialization procedure succeeded
+ *         - negative if the initialization procedure failed
+ */
+int frame_decoder_init(struct FrameDecoder *dec) {
+	dec->buf = malloc(dec->size);
+	if (!dec->buf) {
+		printf("%s: failed to allocate frame decoder buffer\r\n", __func__);
+		return -ENOMEM;
+	}
+
+	dec->len = 0;
+	dec->start = 0;
+	dec->scan = 0;
+
+	return 0;
+}
+
+/*
+ * Get the free region of the decoder buffer, to receive data into.
+ *
+ * The frames already handed out are dropped first, which invalidates
+ * their views.
+ *
+ * @param dec points to the frame decoder
+ * @param span is set to the start of the free region
+ *
+ * @return the length of the free region
+ */
+size_t frame_decoder_span(struct FrameDecoder *dec, uint8_t **span) {
+	/*
+	 * Move the partially received frame to the start of the buffer.
+	 */
+	if (dec->start) {
+		memmove(dec->buf, dec->buf + dec->start, dec->len - dec->start);
+		dec->len -= dec->start;
+		dec->scan -= dec->start;
+		dec->start = 0;
+	}
+
+	*span = dec->buf + dec->len;
+
+	return dec->size - dec->len;
+}
+
+/*
+ * Mark bytes received into the free region as received.
+ *
+ * @param dec points to the frame decoder
+ * @param len number of bytes received, at most the length of the free region
+ */
+void frame_decoder_commit(struct FrameDecoder *dec, size_t len) {
+	dec->len += len;
+}
+
+/*
+ * Decode the next complete frame of the decoder buffer, in place.
+ *
+ * Empty frames, made of a bare delimiter, are skipped. The returned view
+ * stays valid until frame_decoder_span is called.
+ *
+ * @param dec points to the frame decoder
+ * @param view is set to the payload of the decoded frame
+ *
+ * @return - 1 if a frame was decoded
+ *         - 0 if no complete frame was received yet
+ *         - negative if a corrupted frame was dropped
+ */
+int frame_decoder_next(struct FrameDecoder *dec, struct FrameView *view) {
+	uint8_t *delim;
+	uint8_t *in;
+	uint8_t *out;
+	uint8_t *end;
+	uint8_t *frame;
+	uint8_t code;
+	uint16_t crc;
+
+	/*
+	 * Skip empty frames, a bare delimiter only resynchronizes the receiver.
+	 */
+	do {
+		delim = memchr(dec->buf + dec->scan, 0, dec->len - dec->scan);
+		if (!delim) {
+			dec->scan = dec->len;
+
+			/*
+			 * Drop a frame that can never fit in the buffer.
+			 */
+			if (dec->start == 0 && dec->len == dec->size) {
+				printf("%s: frame too large for decoder buffer\r\n", __func__);
+				dec->len = 0;
+				dec->scan = 0;
+				return -EMSGSIZE;
+			}
+
+			return 0;
+		}
+
+		frame = dec->buf + dec->start;
+		end = delim;
+
+		dec->start = delim - dec->buf + 1;
+		dec->scan = dec->start;
+	} while (end == frame);
+
+	/*
+	 * Decode the COBS blocks, each decoded block is never longer than its
+	 * encoding, so the payload can be written over the encoded data.
+	 */
+	in = frame;
+	out = frame;
+	while (in < end) {
+		code = *in++;
+		if (code - 1 > end - in) {
+			printf("%s: dropped malformed frame\r\n", __func__);
+			return -EBADMSG;
+		}
+
+		memmove(out, in, code - 1);
+		out += code - 1;
+		in += code - 1;
+
+		if (code != 0xFF && in < end) {
+			*out++ = 0;
+		}
+	}
+
+	/*
+	 * Check the CRC trailing the payload.
+	 */
+	if (out - frame < 2) {
+		printf("%s: dropped short frame\r\n", __func__);
+		return -EBADMSG;
+	}
+
+	out -= 2;
+	crc = frame_crc16(0xFFFF, frame, out - frame);
+	if (out[0] != (crc >> 8) || out[1] != (crc & 0xFF)) {
+		printf("%s: dropped frame with bad CRC\r\n", __func__);
+		return -EBADMSG;
+	}
+
+	view->data = frame;
+	view->len = out - frame;
+
+	return 1;
+}
+
+/*
+ * Destroy the frame decoder.
+ *
+ * @param dec points to the frame decoder to be destroyed
+ */
+void frame_decoder_destroy(struct FrameDecoder *dec) {
+	free(dec->buf);
+}
+
+/*
+ * Receive data from the UART device into the frame decoder.
+ *
+ * @param dev points to the UART device to be read from
+ * @param dec points to the frame decoder to receive into
+ *
+ * @return - number of bytes received if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+int frame_read(struct UartDevice* dev, struct FrameDecoder *dec) {
+	uint8_t *span;
+	size_t len;
+	int rc;
+
+	len = frame_decoder_span(dec, &span);
+
+	rc = uart_readn(dev, span, len);
+	if (rc < 0) {
+		return rc;
+	}
+
+	frame_decoder_commit(dec, rc);
+
+	return rc;
+}
+
+/*
+ * Encode a payload into a frame and write it to the UART device.
+ *
+ * The payload is not copied, the non-zero runs of the payload are written
+ * straight from it, interleaved with the COBS block codes.
+ *
+ * @param dev points to the UART device to be written to
+ * @param payload points to the start of the payload
+ * @param payload_len length of the payload
+ *
+ * @return - 0 if the write procedure succeeded
+ *         - negative if the write procedure failed
+ */
+int frame_write(struct UartDevice* dev, const uint8_t *payload, size_t payload_len) {
+	static const uint8_t delim = 0;
+	struct iovec iov[FRAME_MAX_IOV];
+	uint8_t codes[FRAME_MAX_IOV];
+	const uint8_t *segs[2];
+	size_t seg_lens[2];
+	uint8_t crc_buf[2];
+	const uint8_t *run;
+	const uint8_t *end;
+	size_t code_iov;
+	size_t iov_len;
+	size_t run_len;
+	size_t seg;
+	size_t i;
+	uint16_t crc;
+	int rc;
+
+	crc = frame_crc16(0xFFFF, payload, payload_len);
+	crc_buf[0] = crc >> 8;
+	crc_buf[1] = crc & 0xFF;
+
+	segs[0] = payload;
+	seg_lens[0] = payload_len;
+	segs[1] = crc_buf;
+	seg_lens[1] = sizeof(crc_buf);
+
+	/*
+	 * Reserve an I/O vector for the code of the first block.
+	 */
+	iov_len = 0;
+	code_iov = iov_len++;
+	run_len = 0;
+
+	for (seg = 0; seg < 2; seg++) {
+		run = segs[seg];
+
+		for (i = 0; i < seg_lens[seg]; i++) {
+			/*
+			 * A block ends at a zero byte, implied by its code, or after
+			 * 254 non-zero bytes, with no implied zero.
+			 */
+			if (segs[seg][i]) {
+				run_len++;
+				if (run_len < 254) {
+					continue;
+				}
+
+				end = &segs[seg][i] + 1;
+			} else {
+				end = &segs[seg][i];
+			}
+
+			/*
+			 * Close the current block, with the run of the segment it
+			 * ends in.
+			 */
+			if (end > run) {
+				iov[iov_len].iov_base = (void *)run;
+				iov[iov_len].iov_len = end - run;
+				iov_len++;
+			}
+
+			codes[code_iov] = run_len + 1;
+			iov[code_iov].iov_base = &codes[code_iov];
+			iov[code_iov].iov_len = 1;
+
+			run = segs[seg][i] ? end : end + 1;
+			run_len = 0;
+
+			/*
+			 * Flush the completed blocks before running out of vectors.
+			 */
+			if (iov_len + 4 > FRAME_MAX_IOV) {
+				rc = frame_writev(dev, iov, iov_len);
+				if (rc < 0) {
+					return rc;
+				}
+
+				iov_len = 0;
+			}
+
+			code_iov = iov_len++;
+		}
+
+		if (&segs[seg][seg_lens[seg]] > run) {
+			iov[iov_len].iov_base = (void *)run;
+			iov[iov_len].iov_len = &segs[seg][seg_lens[seg]] - run;
+			iov_len++;
+		}
+	}
+
+	/*
+	 * Close the last block and delimit the frame.
+	 */
+	codes[code_iov] = run_len + 1;
+	iov[code_iov].iov_base = &codes[code_iov];
+	iov[code_iov].iov_len = 1;
+
+	iov[iov_len].iov_base = (void *)&delim;
+	iov[iov_len].iov_len = 1;
+	iov_len++;
+
+	return frame_writev(dev, iov, iov_len);
+}
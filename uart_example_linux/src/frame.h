@@ -0,0 +1,55 @@
+/*
+ * frame.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "uart.h"
+
+#ifndef SRC_FRAME_H_
+#define SRC_FRAME_H_
+
+/*
+ * Maximum number of I/O vectors used by a single frame write.
+ */
+#define FRAME_MAX_IOV 64
+
+/*
+ * Binary frames are COBS-encoded payloads followed by a CRC-16/CCITT,
+ * delimited by a zero byte.
+ */
+
+/*
+ * View of a decoded frame payload, pointing inside the decoder buffer.
+ */
+struct FrameView {
+	uint8_t *data; /**< Start of the payload */
+	size_t len; /**< Length of the payload */
+};
+
+/*
+ * Decoder splitting received data into frames, decoded in place.
+ */
+struct FrameDecoder {
+	size_t size; /**< Size of the receive buffer */
+
+	uint8_t *buf; /**< Receive buffer */
+	size_t len; /**< Number of bytes received into the buffer */
+	size_t start; /**< Start of the first frame not yet handed out */
+	size_t scan; /**< Position to resume looking for a delimiter from */
+};
+
+uint16_t frame_crc16(uint16_t crc, const uint8_t *buf, size_t buf_len);
+int frame_decoder_init(struct FrameDecoder *dec);
+size_t frame_decoder_span(struct FrameDecoder *dec, uint8_t **span);
+void frame_decoder_commit(struct FrameDecoder *dec, size_t len);
+int frame_decoder_next(struct FrameDecoder *dec, struct FrameView *view);
+void frame_decoder_destroy(struct FrameDecoder *dec);
+int frame_read(struct UartDevice* dev, struct FrameDecoder *dec);
+int frame_write(struct UartDevice* dev, const uint8_t *payload, size_t payload_len);
+
+#endif /* SRC_FRAME_H_ */
@@ -0,0 +1,60 @@
+/*
+ * loopback_sim.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include "loopback_sim.h"
+
+/*
+ * Transfer a segment with the simulated loopback. The written data is
+ * received right away, then the available received data is read.
+ */
+static int loopback_sim_transfer(struct SimDevice *dev, struct TransportSegment *seg) {
+	struct LoopbackSim *loopback = dev->priv;
+	size_t i;
+
+	if (seg->write_buf) {
+		for (i = 0; i < seg->len; i++) {
+			if (loopback->len == LOOPBACK_SIM_BUF_LEN) {
+				loopback->dropped += seg->len - i;
+				break;
+			}
+
+			loopback->buf[(loopback->head + loopback->len) % LOOPBACK_SIM_BUF_LEN] = seg->write_buf[i];
+			loopback->len++;
+		}
+
+		if (!seg->read_buf) {
+			return seg->len;
+		}
+	}
+
+	for (i = 0; i < seg->len && loopback->len; i++) {
+		seg->read_buf[i] = loopback->buf[loopback->head];
+		loopback->head = (loopback->head + 1) % LOOPBACK_SIM_BUF_LEN;
+		loopback->len--;
+	}
+
+	return i;
+}
+
+static const struct SimDeviceOps loopback_sim_ops = {
+	.transfer = loopback_sim_transfer,
+};
+
+/*
+ * Initialize a simulated loopback, with nothing received.
+ *
+ * @param loopback points to the simulated loopback
+ */
+void loopback_sim_init(struct LoopbackSim *loopback) {
+	loopback->sim.addr = 0;
+	loopback->sim.ops = &loopback_sim_ops;
+	loopback->sim.priv = loopback;
+
+	loopback->head = 0;
+	loopback->len = 0;
+	loopback->dropped = 0;
+}
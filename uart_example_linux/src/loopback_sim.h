@@ -0,0 +1,35 @@
+/*
+ * loopback_sim.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim.h"
+
+#ifndef SRC_LOOPBACK_SIM_H_
+#define SRC_LOOPBACK_SIM_H_
+
+/*
+ * Size of the receive buffer of the simulated loopback, like the TTY layer.
+ */
+#define LOOPBACK_SIM_BUF_LEN 4096
+
+/*
+ * Simulated UART with its TX wired to its RX, to be attached to a
+ * simulated UART bus. Data that does not fit the receive buffer is lost.
+ */
+struct LoopbackSim {
+	struct SimDevice sim; /**< Device attached to the simulated bus */
+	uint8_t buf[LOOPBACK_SIM_BUF_LEN]; /**< Receive buffer */
+	size_t head; /**< Index of the oldest received byte */
+	size_t len; /**< Number of received bytes */
+	size_t dropped; /**< Number of bytes lost to a full receive buffer */
+};
+
+void loopback_sim_init(struct LoopbackSim *loopback);
+
+#endif /* SRC_LOOPBACK_SIM_H_ */
@@ -11,6 +11,10 @@
 #include <termios.h>
 #include <string.h>
 #include "uart.h"
+#ifdef SIM
+#include "sim.h"
+#include "loopback_sim.h"
+#endif
 
 #define LOOPBACK_FORMAT "loopback: %s\r\n"
 #define LOOPBACK_FORMAT_LEN strlen(LOOPBACK_FORMAT)
@@ -20,9 +24,29 @@
 int main() {
 	struct UartDevice dev;
 	int rc;
+#ifdef SIM
+	struct LoopbackSim loopback;
+	struct SimBus sim_bus;
+
+	/*
+	 * Simulate a loopback cable on a 9600 baud 8N1 UART.
+	 */
+	sim_bus.timing.clock_hz = 9600;
+	sim_bus.timing.bits_per_byte = 10;
+	sim_bus.timing.transaction_ns = 10000;
+	sim_bus.timing.rx_buffered = 1;
+	sim_bus_init(&sim_bus);
+
+	loopback_sim_init(&loopback);
+	sim_bus_add_device(&sim_bus, &loopback.sim);
+
+	dev.transport = &sim_bus.transport;
+#else
+	dev.transport = NULL;
+#endif
 
 	dev.filename = "/dev/ttyUL1";
-	dev.rate = B9600;
+	dev.rate = 9600;
 
 	rc = uart_start(&dev, false);
 	if (rc) {
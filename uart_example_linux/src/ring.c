@@ -0,0 +1,217 @@
+/*
+ * ring.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "ring.h"
+
+/*
+ * Initialize the ring buffer.
+ *
+ * @param ring points to the ring buffer to be initialized
+ * @param size size of the ring buffer, must be a power of two
+ *
+ * @return - 0 if the initialization procedure succeeded
+ *         - negative if the initialization procedure failed
+ */
+int ring_init(struct RingBuffer *ring, size_t size) {
+	if (!size || (size & (size - 1))) {
+		printf("%s: ring buffer size must be a power of two\r\n", __func__);
+		return -EINVAL;
+	}
+
+	ring->data = malloc(size);
+	if (!ring->data) {
+		printf("%s: failed to allocate ring buffer\r\n", __func__);
+		return -ENOMEM;
+	}
+
+	ring->size = size;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+
+	return 0;
+}
+
+/*
+ * Get the number of bytes stored in the ring buffer.
+ *
+ * @param ring points to the ring buffer
+ *
+ * @return the number of bytes that can be read
+ */
+size_t ring_len(struct RingBuffer *ring) {
+	size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+	return head - tail;
+}
+
+/*
+ * Get the number of bytes that can be stored in the ring buffer.
+ *
+ * @param ring points to the ring buffer
+ *
+ * @return the number of bytes that can be written
+ */
+size_t ring_space(struct RingBuffer *ring) {
+	return ring->size - ring_len(ring);
+}
+
+/*
+ * Get the largest contiguous free region of the ring buffer, so that it
+ * can be written into directly, eg: by read().
+ *
+ * @param ring points to the ring buffer
+ * @param span is set to the start of the free region
+ *
+ * @return the length of the free region
+ */
+size_t ring_write_span(struct RingBuffer *ring, uint8_t **span) {
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	size_t offset = head & (ring->size - 1);
+	size_t space = ring->size - (head - tail);
+
+	*span = ring->data + offset;
+
+	if (space > ring->size - offset) {
+		space = ring->size - offset;
+	}
+
+	return space;
+}
+
+/*
+ * Mark bytes written into the free region as stored.
+ *
+ * @param ring points to the ring buffer
+ * @param len number of bytes written, at most the length of the free region
+ */
+void ring_write_commit(struct RingBuffer *ring, size_t len) {
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	/*
+	 * Publish the written bytes to the consumer.
+	 */
+	atomic_store_explicit(&ring->head, head + len, memory_order_release);
+}
+
+/*
+ * Get the largest contiguous stored region of the ring buffer, so that it
+ * can be read from directly, eg: by write().
+ *
+ * @param ring points to the ring buffer
+ * @param span is set to the start of the stored region
+ *
+ * @return the length of the stored region
+ */
+size_t ring_read_span(struct RingBuffer *ring, uint8_t **span) {
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	size_t offset = tail & (ring->size - 1);
+	size_t len = head - tail;
+
+	*span = ring->data + offset;
+
+	if (len > ring->size - offset) {
+		len = ring->size - offset;
+	}
+
+	return len;
+}
+
+/*
+ * Mark bytes read from the stored region as consumed.
+ *
+ * @param ring points to the ring buffer
+ * @param len number of bytes read, at most the length of the stored region
+ */
+void ring_read_commit(struct RingBuffer *ring, size_t len) {
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	/*
+	 * Hand the consumed bytes back to the producer.
+	 */
+	atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+}
+
+/*
+ * Write data to the ring buffer.
+ *
+ * @param ring points to the ring buffer to be written to
+ * @param buf points to the start of buffer to be written from
+ * @param buf_len length of the buffer to be written
+ *
+ * @return the number of bytes written, less than buf_len if the ring buffer is full
+ */
+size_t ring_write(struct RingBuffer *ring, const uint8_t *buf, size_t buf_len) {
+	size_t written = 0;
+	uint8_t *span;
+	size_t len;
+
+	while (written < buf_len) {
+		len = ring_write_span(ring, &span);
+		if (!len) {
+			break;
+		}
+
+		if (len > buf_len - written) {
+			len = buf_len - written;
+		}
+
+		memcpy(span, buf + written, len);
+		ring_write_commit(ring, len);
+		written += len;
+	}
+
+	return written;
+}
+
+/*
+ * Read data from the ring buffer.
+ *
+ * @param ring points to the ring buffer to be read from
+ * @param buf points to the start of buffer to be read into
+ * @param buf_len length of the buffer to be read
+ *
+ * @return the number of bytes read, less than buf_len if the ring buffer is empty
+ */
+size_t ring_read(struct RingBuffer *ring, uint8_t *buf, size_t buf_len) {
+	size_t read = 0;
+	uint8_t *span;
+	size_t len;
+
+	while (read < buf_len) {
+		len = ring_read_span(ring, &span);
+		if (!len) {
+			break;
+		}
+
+		if (len > buf_len - read) {
+			len = buf_len - read;
+		}
+
+		memcpy(buf + read, span, len);
+		ring_read_commit(ring, len);
+		read += len;
+	}
+
+	return read;
+}
+
+/*
+ * Destroy the ring buffer.
+ *
+ * @param ring points to the ring buffer to be destroyed
+ */
+void ring_destroy(struct RingBuffer *ring) {
+	free(ring->data);
+}
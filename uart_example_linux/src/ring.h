@@ -0,0 +1,45 @@
+/*
+ * ring.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SRC_RING_H_
+#define SRC_RING_H_
+
+/*
+ * Size of a cache line, used to keep the producer and consumer indexes apart.
+ */
+#define RING_CACHE_LINE 64
+
+/*
+ * Byte ring buffer with a power-of-two size.
+ *
+ * The ring buffer is lock-free for a single producer thread, calling the
+ * write functions, and a single consumer thread, calling the read functions.
+ */
+struct RingBuffer {
+	uint8_t *data; /**< Storage of the ring buffer */
+	size_t size; /**< Size of the storage, a power of two */
+
+	_Alignas(RING_CACHE_LINE) atomic_size_t head; /**< Free-running write index, owned by the producer */
+	_Alignas(RING_CACHE_LINE) atomic_size_t tail; /**< Free-running read index, owned by the consumer */
+};
+
+int ring_init(struct RingBuffer *ring, size_t size);
+size_t ring_len(struct RingBuffer *ring);
+size_t ring_space(struct RingBuffer *ring);
+size_t ring_write(struct RingBuffer *ring, const uint8_t *buf, size_t buf_len);
+size_t ring_read(struct RingBuffer *ring, uint8_t *buf, size_t buf_len);
+size_t ring_write_span(struct RingBuffer *ring, uint8_t **span);
+void ring_write_commit(struct RingBuffer *ring, size_t len);
+size_t ring_read_span(struct RingBuffer *ring, uint8_t **span);
+void ring_read_commit(struct RingBuffer *ring, size_t len);
+void ring_destroy(struct RingBuffer *ring);
+
+#endif /* SRC_RING_H_ */
@@ -0,0 +1,189 @@
+/*
+ * sim.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <errno.h>
+
+#include "sim.h"
+
+/*
+ * Find the device addressed by a segment.
+ *
+ * @param bus points to the simulated bus
+ * @param addr address of the device
+ *
+ * @return - the device if it is attached to the bus
+ *         - NULL if no device answers to the address
+ */
+static struct SimDevice *sim_bus_find(struct SimBus *bus, uint16_t addr) {
+	struct SimDevice *dev;
+
+	for (dev = bus->devices; dev; dev = dev->next) {
+		if (dev->addr == addr) {
+			return dev;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Sleep until a simulated transaction would have completed on the bus.
+ *
+ * @param bus points to the simulated bus
+ * @param start time the transaction started at
+ * @param bytes number of bytes clocked on the bus by the transaction
+ */
+static void sim_bus_delay(struct SimBus *bus, struct timespec *start, size_t bytes) {
+	struct timespec end = *start;
+	long long ns;
+
+	ns = bus->timing.transaction_ns;
+	if (bus->timing.clock_hz) {
+		ns += (long long)bytes * bus->timing.bits_per_byte * 1000000000LL /
+				bus->timing.clock_hz;
+	}
+
+	if (ns <= 0) {
+		return;
+	}
+
+	end.tv_sec += ns / 1000000000;
+	end.tv_nsec += ns % 1000000000;
+	if (end.tv_nsec >= 1000000000) {
+		end.tv_sec++;
+		end.tv_nsec -= 1000000000;
+	}
+
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &end, NULL);
+}
+
+/*
+ * Transfer segments with the devices of a simulated bus in a single
+ * transaction. A device is selected whenever a segment addresses a
+ * different device than the previous one.
+ *
+ * @param bus points to the simulated bus
+ * @param segs points to the start of the segments to be transferred
+ * @param num_segs number of segments
+ * @param partial whether short segments are allowed
+ *
+ * @return - number of bytes transferred if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+static int sim_bus_run(struct SimBus *bus, struct TransportSegment *segs,
+		size_t num_segs, int partial) {
+	struct SimDevice *selected = NULL;
+	struct SimDevice *dev;
+	struct timespec start;
+	size_t clocked = 0;
+	size_t bytes = 0;
+	size_t i;
+	int rc = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < num_segs; i++) {
+		dev = sim_bus_find(bus, segs[i].addr);
+		if (!dev) {
+			rc = -ENXIO;
+			break;
+		}
+
+		if (dev != selected && dev->ops->select) {
+			dev->ops->select(dev);
+		}
+		selected = dev;
+
+		rc = dev->ops->transfer(dev, &segs[i]);
+		if (rc < 0) {
+			break;
+		}
+
+		if (segs[i].write_buf || !bus->timing.rx_buffered) {
+			clocked += rc;
+		}
+		bytes += rc;
+
+		if (!partial && (size_t)rc != segs[i].len) {
+			rc = -EIO;
+			break;
+		}
+	}
+
+	bus->transactions++;
+	bus->bytes += bytes;
+
+	sim_bus_delay(bus, &start, clocked);
+
+	if (rc < 0) {
+		return rc;
+	}
+
+	return bytes;
+}
+
+static int sim_transport_transfer(struct Transport *transport, struct TransportSegment *seg) {
+	return sim_bus_run(transport->priv, seg, 1, 1);
+}
+
+static int sim_transport_batch(struct Transport *transport, struct TransportSegment *segs,
+		size_t num_segs) {
+	int rc;
+
+	rc = sim_bus_run(transport->priv, segs, num_segs, 0);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return num_segs;
+}
+
+static const struct TransportOps sim_transport_ops = {
+	.name = "sim",
+	.transfer = sim_transport_transfer,
+	.batch = sim_transport_batch,
+};
+
+/*
+ * Initialize a simulated bus with no devices attached.
+ *
+ * @param bus points to the simulated bus to be initialized, must have
+ *  timing populated
+ */
+void sim_bus_init(struct SimBus *bus) {
+	bus->transport.ops = &sim_transport_ops;
+	bus->transport.priv = bus;
+	bus->devices = NULL;
+	bus->transactions = 0;
+	bus->bytes = 0;
+}
+
+/*
+ * Attach a device model to a simulated bus.
+ *
+ * @param bus points to the initialized simulated bus
+ * @param dev points to the device, must have addr, ops and priv populated
+ */
+void sim_bus_add_device(struct SimBus *bus, struct SimDevice *dev) {
+	dev->next = bus->devices;
+	bus->devices = dev;
+}
+
+/*
+ * Get the time elapsed since a point in time, to drive the device scripts.
+ *
+ * @param since CLOCK_MONOTONIC time to measure from
+ *
+ * @return the elapsed time, in seconds
+ */
+double sim_elapsed(struct timespec *since) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
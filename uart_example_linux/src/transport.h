@@ -0,0 +1,55 @@
+/*
+ * transport.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SRC_TRANSPORT_H_
+#define SRC_TRANSPORT_H_
+
+/*
+ * Segment of a transport transaction.
+ *
+ * On I2C, a segment is a single message and has exactly one of write_buf
+ * and read_buf. On SPI, a segment is full-duplex and may have both. On
+ * UART, write_buf is sent before read_buf is received.
+ */
+struct TransportSegment {
+	uint16_t addr; /**< Address of the slave, for addressed buses such as I2C */
+	const uint8_t *write_buf; /**< Buffer to be written from, NULL for none */
+	uint8_t *read_buf; /**< Buffer to be read into, NULL for none */
+	size_t len; /**< Length of the buffers */
+};
+
+struct Transport;
+
+/*
+ * Operations of a transport backend. Any operation may be NULL, transfer
+ * and batch falling back on each other.
+ */
+struct TransportOps {
+	const char *name; /**< Name of the backend, eg: i2c */
+	int (*open)(struct Transport *transport);
+	int (*transfer)(struct Transport *transport, struct TransportSegment *seg);
+	int (*batch)(struct Transport *transport, struct TransportSegment *segs, size_t num_segs);
+	void (*close)(struct Transport *transport);
+};
+
+/*
+ * Bus transport, bound to a backend.
+ */
+struct Transport {
+	const struct TransportOps *ops; /**< Operations of the backend */
+	void *priv; /**< Private data of the backend */
+};
+
+int transport_open(struct Transport *transport);
+int transport_transfer(struct Transport *transport, struct TransportSegment *seg);
+int transport_batch(struct Transport *transport, struct TransportSegment *segs, size_t num_segs);
+void transport_close(struct Transport *transport);
+
+#endif /* SRC_TRANSPORT_H_ */
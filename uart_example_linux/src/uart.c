@@ -6,6 +6,8 @@
  * @author Cristian Fatu
  */
 
+#define _GNU_SOURCE
+
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -13,13 +15,110 @@
 #include <termios.h>
 #include <errno.h>
 #include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/uio.h>
 
 #include "uart.h"
+#include "uart_serial.h"
+
+/*
+ * Standard baud-rates that can be set through termios.
+ */
+static const struct {
+	speed_t speed;
+	unsigned int rate;
+} uart_rates[] = {
+	{ B50, 50 }, { B75, 75 }, { B110, 110 }, { B134, 134 },
+	{ B150, 150 }, { B200, 200 }, { B300, 300 }, { B600, 600 },
+	{ B1200, 1200 }, { B1800, 1800 }, { B2400, 2400 }, { B4800, 4800 },
+	{ B9600, 9600 }, { B19200, 19200 }, { B38400, 38400 }, { B57600, 57600 },
+	{ B115200, 115200 }, { B230400, 230400 }, { B460800, 460800 }, { B500000, 500000 },
+	{ B576000, 576000 }, { B921600, 921600 }, { B1000000, 1000000 }, { B1152000, 1152000 },
+	{ B1500000, 1500000 }, { B2000000, 2000000 }, { B2500000, 2500000 }, { B3000000, 3000000 },
+	{ B3500000, 3500000 }, { B4000000, 4000000 },
+};
+
+#define UART_NUM_RATES (sizeof(uart_rates) / sizeof(uart_rates[0]))
+
+/*
+ * Maximum number of segments gathered into a single write by the transport.
+ */
+#define UART_TRANSPORT_MAX_IOV 64
+
+/*
+ * Convert the configured rate of a UART device to a baud-rate, accepting
+ * both integer baud-rates and the legacy B* constants.
+ *
+ * @param rate the configured rate, eg: 115200 or B115200
+ *
+ * @return the baud-rate
+ */
+static unsigned int uart_rate_to_baud(int rate) {
+	size_t i;
+
+	for (i = 0; i < UART_NUM_RATES; i++) {
+		if ((int)uart_rates[i].speed == rate) {
+			return uart_rates[i].rate;
+		}
+	}
+
+	return rate;
+}
+
+/*
+ * Find the termios speed for a baud-rate.
+ *
+ * @param baud the baud-rate
+ *
+ * @return - the termios speed if the baud-rate is standard
+ *         - B0 if the baud-rate must be set through termios2
+ */
+static speed_t uart_baud_to_speed(unsigned int baud) {
+	size_t i;
+
+	for (i = 0; i < UART_NUM_RATES; i++) {
+		if (uart_rates[i].rate == baud) {
+			return uart_rates[i].speed;
+		}
+	}
+
+	return B0;
+}
+
+/*
+ * Transfer a segment with the transport of a UART device.
+ *
+ * @param dev points to the UART device on a transport
+ * @param write_buf points to the start of buffer to be written from, or NULL
+ * @param read_buf points to the start of buffer to be read into, or NULL
+ * @param buf_len length of the buffer
+ *
+ * @return - number of bytes transferred if the transfer procedure succeeded
+ *         - negative if the transfer procedure failed
+ */
+static int uart_transport_transfer(struct UartDevice* dev, const void *write_buf, void *read_buf,
+		size_t buf_len) {
+	struct TransportSegment seg;
+	int rc;
+
+	seg.addr = 0;
+	seg.write_buf = write_buf;
+	seg.read_buf = read_buf;
+	seg.len = buf_len;
+
+	BUS_STATS_START(start);
+	rc = transport_transfer(dev->transport, &seg);
+	BUS_STATS_RECORD(read_buf ? &dev->rx_stats : &dev->tx_stats, start, rc, buf_len);
+
+	return rc;
+}
 
 /*
  * Start the UART device.
  *
- * @param dev points to the UART device to be started, must have filename and rate populated
+ * @param dev points to the UART device to be started, must have filename, rate and transport
+ *  populated, rate being an integer baud-rate, either standard or custom
  * @param canonical whether to define some compatibility flags for a canonical interface
  *
  * @return - 0 if the starting procedure succeeded
@@ -27,9 +126,24 @@
  */
 int uart_start(struct UartDevice* dev, bool canonical) {
 	struct termios *tty;
+	unsigned int actual;
+	unsigned int baud;
+	speed_t speed;
 	int fd;
 	int rc;
 
+	bus_stats_init(&dev->rx_stats);
+	bus_stats_init(&dev->tx_stats);
+
+	/*
+	 * Devices on a transport have no TTY to configure.
+	 */
+	if (dev->transport) {
+		dev->fd = -1;
+		dev->tty = NULL;
+		return 0;
+	}
+
 	fd = open(dev->filename, O_RDWR | O_NOCTTY);
 	if (fd < 0) {
 		printf("%s: failed to open UART device\r\n", __func__);
@@ -39,15 +153,20 @@ int uart_start(struct UartDevice* dev, bool canonical) {
 	tty = malloc(sizeof(*tty));
 	if (!tty) {
 		printf("%s: failed to allocate UART TTY instance\r\n", __func__);
-		return -ENOMEM;
+		rc = -ENOMEM;
+		goto fail_alloc;
 	}
 
 	memset(tty, 0, sizeof(*tty));
 
 	/*
-	 * Set baud-rate.
+	 * Set baud-rate. Non-standard baud-rates are set through termios2
+	 * once the other attributes are applied, with a standard placeholder
+	 * in the meantime, so that the line is not hung up.
 	 */
-	tty->c_cflag |= dev->rate;
+	baud = uart_rate_to_baud(dev->rate);
+	speed = uart_baud_to_speed(baud);
+	tty->c_cflag |= speed != B0 ? speed : B38400;
 
     /* Ignore framing and parity errors in input. */
     tty->c_iflag |=  IGNPAR;
@@ -82,13 +201,97 @@ int uart_start(struct UartDevice* dev, bool canonical) {
 	rc = tcsetattr(fd, TCSANOW, tty);
 	if (rc) {
 		printf("%s: failed to set attributes\r\n", __func__);
-		return rc;
+		goto fail_configure;
+	}
+
+	if (speed == B0) {
+		rc = uart_serial_set_rate(fd, baud);
+		if (rc < 0) {
+			goto fail_configure;
+		}
+	}
+
+	/*
+	 * Check that the UART can run close enough to the requested baud-rate.
+	 */
+	rc = uart_serial_get_rate(fd, &actual);
+	if (rc < 0) {
+		goto fail_configure;
+	}
+
+	if ((actual > baud ? actual - baud : baud - actual) * 100 > (unsigned long)baud * UART_RATE_TOLERANCE) {
+		printf("%s: baud-rate %u not supported, got %u\r\n", __func__, baud, actual);
+		rc = -EINVAL;
+		goto fail_configure;
 	}
 
 	dev->fd = fd;
 	dev->tty = tty;
 
 	return 0;
+
+fail_configure:
+	free(tty);
+fail_alloc:
+	close(fd);
+	return rc;
+}
+
+/*
+ * Get the baud-rate actually used by the UART device.
+ *
+ * @param dev points to the started UART device
+ *
+ * @return - the baud-rate if the getting procedure succeeded
+ *         - negative if the getting procedure failed
+ */
+int uart_get_rate(struct UartDevice* dev) {
+	unsigned int rate;
+	int rc;
+
+	if (dev->transport) {
+		return -ENOTTY;
+	}
+
+	rc = uart_serial_get_rate(dev->fd, &rate);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return rate;
+}
+
+/*
+ * Tune the UART device for low latency, pushing received data to the TTY
+ * layer right away and, when rx_trigger is positive, lowering the receive
+ * FIFO trigger level.
+ *
+ * Drivers that support neither setting are left untouched.
+ *
+ * @param dev points to the started UART device
+ * @param rx_trigger the receive FIFO trigger level, or 0 to keep the default
+ *
+ * @return - 0 if all the settings were applied
+ *         - negative if some setting is not supported
+ */
+int uart_set_low_latency(struct UartDevice* dev, int rx_trigger) {
+	int rc;
+
+	if (dev->transport) {
+		return -ENOTTY;
+	}
+
+	rc = uart_serial_set_low_latency(dev->fd);
+	if (rc < 0) {
+		printf("%s: low latency not supported\r\n", __func__);
+	}
+
+	if (rx_trigger > 0 && uart_serial_set_rx_trigger(dev->filename, rx_trigger) < 0) {
+		printf("%s: receive FIFO trigger level not supported\r\n", __func__);
+		rc = -ENOTSUP;
+	}
+
+	return rc;
 }
 
 /*
@@ -104,7 +307,13 @@ int uart_start(struct UartDevice* dev, bool canonical) {
 int uart_reads(struct UartDevice* dev, char *buf, size_t buf_len) {
 	int rc;
 
-	rc = read(dev->fd, buf, buf_len - 1);
+	if (dev->transport) {
+		rc = uart_transport_transfer(dev, NULL, buf, buf_len - 1);
+	} else {
+		BUS_STATS_START(start);
+		rc = read(dev->fd, buf, buf_len - 1);
+		BUS_STATS_RECORD(&dev->rx_stats, start, rc, buf_len - 1);
+	}
 	if (rc < 0) {
 		printf("%s: failed to read uart data\r\n", __func__);
 		return rc;
@@ -114,9 +323,183 @@ int uart_reads(struct UartDevice* dev, char *buf, size_t buf_len) {
 	return rc;
 }
 
+/*
+ * Read data from the UART device.
+ *
+ * Unlike uart_reads, the data is not terminated, so it can contain zeros
+ * and can fill the whole buffer.
+ *
+ * @param dev points to the UART device to be read from
+ * @param buf points to the start of buffer to be read into
+ * @param buf_len length of the buffer to be read
+ *
+ * @return - number of bytes read if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+int uart_readn(struct UartDevice* dev, uint8_t *buf, size_t buf_len) {
+	int rc;
+
+	if (dev->transport) {
+		return uart_transport_transfer(dev, NULL, buf, buf_len);
+	}
+
+	while (1) {
+		BUS_STATS_START(start);
+		rc = read(dev->fd, buf, buf_len);
+		BUS_STATS_RECORD(&dev->rx_stats, start, rc, buf_len);
+
+		if (rc >= 0 || errno != EINTR) {
+			break;
+		}
+
+		BUS_STATS_RETRY(&dev->rx_stats);
+	}
+
+	if (rc < 0) {
+		printf("%s: failed to read uart data\r\n", __func__);
+		return -errno;
+	}
+
+	return rc;
+}
+
+/*
+ * Set how reads from the UART device are batched in noncanonical mode.
+ *
+ * A read() returns once min_bytes bytes are received, or once no byte was
+ * received for timeout_ds tenths of a second after the first one. With
+ * min_bytes 0, a read() returns after timeout_ds tenths of a second even if
+ * nothing was received.
+ *
+ * @param dev points to the started UART device
+ * @param min_bytes number of bytes to wait for, VMIN
+ * @param timeout_ds inter-byte timeout in tenths of a second, VTIME
+ *
+ * @return - 0 if the setting procedure succeeded
+ *         - negative if the setting procedure failed
+ */
+int uart_set_read_mode(struct UartDevice* dev, uint8_t min_bytes, uint8_t timeout_ds) {
+	int rc;
+
+	if (dev->transport) {
+		return -ENOTTY;
+	}
+
+	dev->tty->c_cc[VMIN] = min_bytes;
+	dev->tty->c_cc[VTIME] = timeout_ds;
+
+	rc = tcsetattr(dev->fd, TCSANOW, dev->tty);
+	if (rc) {
+		printf("%s: failed to set attributes\r\n", __func__);
+		return -errno;
+	}
+
+	return 0;
+}
+
+/*
+ * Read data from the UART device until the buffer is full or the timeout
+ * expires, whichever comes first.
+ *
+ * The read mode must not wait for more than one byte, VMIN 0 or 1, so that
+ * the data announced by poll() can be read without blocking.
+ *
+ * @param dev points to the UART device to be read from
+ * @param buf points to the start of buffer to be read into
+ * @param buf_len length of the buffer to be read
+ * @param timeout_us maximum time to wait for the data, in microseconds
+ *
+ * @return - number of bytes read if the read procedure succeeded,
+ *           less than buf_len if the timeout expired
+ *         - negative if the read procedure failed
+ */
+int uart_read_timeout(struct UartDevice* dev, uint8_t *buf, size_t buf_len, long timeout_us) {
+	struct timespec deadline;
+	struct timespec timeout;
+	struct timespec now;
+	struct pollfd fd;
+	size_t total = 0;
+	int rc;
+
+	if (dev->transport) {
+		return -ENOTTY;
+	}
+
+	if (dev->tty->c_cc[VMIN] > 1) {
+		printf("%s: read mode waits for more than one byte\r\n", __func__);
+		return -EINVAL;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_us / 1000000;
+	deadline.tv_nsec += (timeout_us % 1000000) * 1000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	fd.fd = dev->fd;
+	fd.events = POLLIN;
+
+	while (total < buf_len) {
+		/*
+		 * Wait for data until the deadline.
+		 */
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		timeout.tv_sec = deadline.tv_sec - now.tv_sec;
+		timeout.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+		if (timeout.tv_nsec < 0) {
+			timeout.tv_sec--;
+			timeout.tv_nsec += 1000000000;
+		}
+
+		if (timeout.tv_sec < 0) {
+			break;
+		}
+
+		rc = ppoll(&fd, 1, &timeout, NULL);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			printf("%s: failed to wait for uart data\r\n", __func__);
+			return -errno;
+		}
+
+		if (rc == 0) {
+			break;
+		}
+
+		/*
+		 * Read everything that is available, up to the end of the buffer.
+		 */
+		BUS_STATS_START(start);
+		rc = read(dev->fd, buf + total, buf_len - total);
+		BUS_STATS_RECORD(&dev->rx_stats, start, rc, buf_len - total);
+		if (rc < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				BUS_STATS_RETRY(&dev->rx_stats);
+				continue;
+			}
+
+			printf("%s: failed to read uart data\r\n", __func__);
+			return -errno;
+		}
+
+		total += rc;
+	}
+
+	return total;
+}
+
 /*
  * Write data to the UART device.
  *
+ * Short writes are retried until the whole buffer is written. If the UART
+ * device is non-blocking and cannot accept more data, the number of bytes
+ * written so far is returned.
+ *
  * @param dev points to the UART device to be written to
  * @param buf points to the start of buffer to be written from
  * @param buf_len length of the buffer to be written
@@ -125,7 +508,39 @@ int uart_reads(struct UartDevice* dev, char *buf, size_t buf_len) {
  *         - negative if the write procedure failed
  */
 int uart_writen(struct UartDevice* dev, char *buf, size_t buf_len) {
-	return write(dev->fd, buf, buf_len);
+	size_t written = 0;
+	ssize_t rc;
+
+	if (dev->transport) {
+		return uart_transport_transfer(dev, buf, NULL, buf_len);
+	}
+
+	while (written < buf_len) {
+		if (written) {
+			BUS_STATS_RETRY(&dev->tx_stats);
+		}
+
+		BUS_STATS_START(start);
+		rc = write(dev->fd, buf + written, buf_len - written);
+		BUS_STATS_RECORD(&dev->tx_stats, start, rc, buf_len - written);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				BUS_STATS_RETRY(&dev->tx_stats);
+				continue;
+			}
+
+			if (errno == EAGAIN && written) {
+				break;
+			}
+
+			printf("%s: failed to write uart data\r\n", __func__);
+			return -errno;
+		}
+
+		written += rc;
+	}
+
+	return written;
 }
 
 /*
@@ -150,3 +565,183 @@ int uart_writes(struct UartDevice* dev, char *string) {
 void uart_stop(struct UartDevice* dev) {
 	free(dev->tty);
 }
+
+static int uart_transport_open(struct Transport *transport) {
+	return uart_start(transport->priv, false);
+}
+
+static int uart_transport_transfer_fd(struct Transport *transport, struct TransportSegment *seg) {
+	int rc;
+
+	if (seg->write_buf) {
+		rc = uart_writen(transport->priv, (char *)seg->write_buf, seg->len);
+		if (rc < 0 || !seg->read_buf) {
+			return rc;
+		}
+	}
+
+	return uart_readn(transport->priv, seg->read_buf, seg->len);
+}
+
+#if BUS_STATS
+/*
+ * Get the total length of I/O vectors.
+ *
+ * @param iov points to the start of the I/O vectors
+ * @param iov_len number of I/O vectors
+ *
+ * @return the total length
+ */
+static size_t uart_iov_len(struct iovec *iov, size_t iov_len) {
+	size_t len = 0;
+	size_t i;
+
+	for (i = 0; i < iov_len; i++) {
+		len += iov[i].iov_len;
+	}
+
+	return len;
+}
+#endif
+
+static int uart_transport_batch(struct Transport *transport, struct TransportSegment *segs,
+		size_t num_segs) {
+	struct UartDevice* dev = transport->priv;
+	struct iovec iov[UART_TRANSPORT_MAX_IOV];
+	struct iovec *next;
+	size_t remaining;
+	size_t iov_len;
+	size_t i;
+	size_t j;
+	ssize_t rc;
+
+	/*
+	 * Segments that read are transferred one by one, in order.
+	 */
+	for (i = 0; i < num_segs; i++) {
+		if (segs[i].read_buf) {
+			break;
+		}
+	}
+
+	if (i < num_segs) {
+		for (i = 0; i < num_segs; i++) {
+			rc = uart_transport_transfer_fd(transport, &segs[i]);
+			if (rc < 0) {
+				return rc;
+			}
+		}
+
+		return num_segs;
+	}
+
+	/*
+	 * Write-only batches are gathered, UART_TRANSPORT_MAX_IOV segments
+	 * per system call, resuming short writes.
+	 */
+	for (i = 0; i < num_segs; i += iov_len) {
+		iov_len = num_segs - i;
+		if (iov_len > UART_TRANSPORT_MAX_IOV) {
+			iov_len = UART_TRANSPORT_MAX_IOV;
+		}
+
+		for (j = 0; j < iov_len; j++) {
+			iov[j].iov_base = (void *)segs[i + j].write_buf;
+			iov[j].iov_len = segs[i + j].len;
+		}
+
+		next = iov;
+		remaining = iov_len;
+		while (remaining) {
+			BUS_STATS_START(start);
+			rc = writev(dev->fd, next, remaining);
+			BUS_STATS_RECORD(&dev->tx_stats, start, rc, uart_iov_len(next, remaining));
+			if (rc < 0) {
+				if (errno == EINTR) {
+					BUS_STATS_RETRY(&dev->tx_stats);
+					continue;
+				}
+
+				printf("%s: failed to write uart data\r\n", __func__);
+				return -errno;
+			}
+
+			/*
+			 * Skip the segments that were fully written.
+			 */
+			while (remaining && (size_t)rc >= next->iov_len) {
+				rc -= next->iov_len;
+				next++;
+				remaining--;
+			}
+
+			if (remaining) {
+				next->iov_base = (uint8_t *)next->iov_base + rc;
+				next->iov_len -= rc;
+				BUS_STATS_RETRY(&dev->tx_stats);
+			}
+		}
+	}
+
+	return num_segs;
+}
+
+static void uart_transport_close(struct Transport *transport) {
+	uart_stop(transport->priv);
+}
+
+const struct TransportOps uart_transport_ops = {
+	.name = "uart",
+	.open = uart_transport_open,
+	.transfer = uart_transport_transfer_fd,
+	.batch = uart_transport_batch,
+	.close = uart_transport_close,
+};
+
+static int uart_async_run_writen(struct AsyncRequest *req) {
+	return uart_writen(req->dev, (char *)req->write_buf, req->len);
+}
+
+static int uart_async_run_readn(struct AsyncRequest *req) {
+	return uart_readn(req->dev, req->read_buf, req->len);
+}
+
+/*
+ * Prepare an asynchronous uart_writen, to be submitted to the transmit
+ * worker of the UART device with async_submit.
+ *
+ * @param req points to the request to be prepared, having complete and
+ *  priv populated
+ * @param dev points to the started UART device
+ * @param buf points to the start of buffer to be written from,
+ *  must stay valid until the request completes
+ * @param buf_len length of the buffer to be written
+ */
+void uart_async_writen(struct AsyncRequest *req, struct UartDevice* dev, uint8_t *buf,
+		size_t buf_len) {
+	req->run = uart_async_run_writen;
+	req->dev = dev;
+	req->write_buf = buf;
+	req->read_buf = NULL;
+	req->len = buf_len;
+}
+
+/*
+ * Prepare an asynchronous uart_readn, to be submitted to the receive
+ * worker of the UART device with async_submit.
+ *
+ * @param req points to the request to be prepared, having complete and
+ *  priv populated
+ * @param dev points to the started UART device
+ * @param buf points to the start of buffer to be read into,
+ *  must stay valid until the request completes
+ * @param buf_len length of the buffer to be read
+ */
+void uart_async_readn(struct AsyncRequest *req, struct UartDevice* dev, uint8_t *buf,
+		size_t buf_len) {
+	req->run = uart_async_run_readn;
+	req->dev = dev;
+	req->write_buf = NULL;
+	req->read_buf = buf;
+	req->len = buf_len;
+}
@@ -9,24 +9,58 @@
 #include <termios.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "transport.h"
+#include "bus_stats.h"
+#include "async.h"
 
 #ifndef SRC_UART_H_
 #define SRC_UART_H_
 
 #define DEBUG
 
+/*
+ * Maximum deviation from the requested baud-rate, in percent.
+ */
+#define UART_RATE_TOLERANCE 3
+
 struct UartDevice {
 	char* filename;
 	int rate;
+	struct Transport *transport; /**< Opened transport to use instead of filename, NULL for none */
 
 	int fd;
 	struct termios *tty;
+	struct BusStats rx_stats; /**< Statistics of the reads, one transaction per read */
+	struct BusStats tx_stats; /**< Statistics of the writes, one transaction per write */
 };
 
 int uart_start(struct UartDevice* dev, bool canonic);
+int uart_get_rate(struct UartDevice* dev);
+int uart_set_low_latency(struct UartDevice* dev, int rx_trigger);
 int uart_writen(struct UartDevice* dev, char *buf, size_t buf_len);
 int uart_writes(struct UartDevice* dev, char *string);
 int uart_reads(struct UartDevice* dev, char *buf, size_t buf_len);
+int uart_readn(struct UartDevice* dev, uint8_t *buf, size_t buf_len);
+int uart_set_read_mode(struct UartDevice* dev, uint8_t min_bytes, uint8_t timeout_ds);
+int uart_read_timeout(struct UartDevice* dev, uint8_t *buf, size_t buf_len, long timeout_us);
 void uart_stop(struct UartDevice* dev);
 
+/*
+ * Transport backend on a real UART, with a UART device as private data,
+ * having filename and rate populated and no transport.
+ */
+extern const struct TransportOps uart_transport_ops;
+
+/*
+ * Asynchronous reads and writes, run by the workers of the UART device
+ * (see async.h). A UART is full-duplex, so reads and writes can be given
+ * separate workers to run at the same time.
+ */
+void uart_async_writen(struct AsyncRequest *req, struct UartDevice* dev, uint8_t *buf,
+		size_t buf_len);
+void uart_async_readn(struct AsyncRequest *req, struct UartDevice* dev, uint8_t *buf,
+		size_t buf_len);
+
 #endif /* SRC_UART_H_ */
@@ -0,0 +1,372 @@
+/*
+ * uart_pump.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <sys/eventfd.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "uart_pump.h"
+
+/*
+ * Wake up a pump thread waiting on its event file descriptor.
+ *
+ * @param event the event file descriptor of the thread
+ */
+static void uart_pump_wake(int event) {
+	uint64_t value = 1;
+
+	if (write(event, &value, sizeof(value)) < 0) {
+		printf("%s: failed to wake up UART pump thread\r\n", __func__);
+	}
+}
+
+/*
+ * Clear the event file descriptor of a pump thread after a wake up.
+ *
+ * @param event the event file descriptor of the thread
+ */
+static void uart_pump_clear(int event) {
+	uint64_t value;
+
+	if (read(event, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+		printf("%s: failed to clear UART pump event\r\n", __func__);
+	}
+}
+
+/*
+ * Record the error a pump thread stopped on, keeping the first one.
+ *
+ * @param pump points to the UART pump
+ * @param error the error the thread stopped on
+ */
+static void uart_pump_fail(struct UartPump *pump, int error) {
+	int expected = 0;
+
+	atomic_compare_exchange_strong(&pump->error, &expected, error);
+}
+
+/*
+ * Receive thread, draining the UART device into the receive ring buffer.
+ *
+ * When the receive ring buffer is full, the thread stops reading until the
+ * consumer frees up space, so that the TTY layer applies backpressure.
+ * The thread stops at the end of file, eg: when the UART device hangs up.
+ *
+ * @param arg points to the UART pump
+ *
+ * @return NULL
+ */
+static void *uart_pump_rx(void *arg) {
+	struct UartPump *pump = arg;
+	struct pollfd fds[2];
+	uint8_t *span;
+	size_t len;
+	ssize_t rc;
+
+	fds[0].fd = pump->dev->fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = pump->rx_event;
+	fds[1].events = POLLIN;
+
+	while (atomic_load(&pump->running)) {
+		len = ring_write_span(&pump->rx, &span);
+		if (!len) {
+			/*
+			 * Announce the wait and check for space again before
+			 * sleeping, so that a read freeing it up is not missed.
+			 */
+			atomic_store(&pump->rx_full, true);
+			atomic_thread_fence(memory_order_seq_cst);
+			len = ring_write_span(&pump->rx, &span);
+			if (!len) {
+				poll(&fds[1], 1, -1);
+				uart_pump_clear(pump->rx_event);
+				continue;
+			}
+
+			atomic_store(&pump->rx_full, false);
+		}
+
+		rc = poll(fds, 2, -1);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			printf("%s: failed to wait for uart data\r\n", __func__);
+			uart_pump_fail(pump, -errno);
+			break;
+		}
+
+		if (fds[1].revents) {
+			uart_pump_clear(pump->rx_event);
+			continue;
+		}
+
+		BUS_STATS_START(start);
+		rc = read(pump->dev->fd, span, len);
+		BUS_STATS_RECORD(&pump->dev->rx_stats, start, rc, len);
+		if (rc < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				BUS_STATS_RETRY(&pump->dev->rx_stats);
+				continue;
+			}
+
+			printf("%s: failed to read uart data\r\n", __func__);
+			uart_pump_fail(pump, -errno);
+			break;
+		}
+
+		/*
+		 * The UART device was reported readable, nothing to read is the
+		 * end of file.
+		 */
+		if (rc == 0) {
+			uart_pump_fail(pump, -EPIPE);
+			break;
+		}
+
+		ring_write_commit(&pump->rx, rc);
+	}
+
+	return NULL;
+}
+
+/*
+ * Transmit thread, writing the transmit ring buffer out to the UART device.
+ *
+ * Short writes are resumed from where they stopped. While the UART device
+ * does not accept more data, the thread waits for it to become writable
+ * together with its event file descriptor, so that stopping the pump does
+ * not wait for the UART device.
+ *
+ * @param arg points to the UART pump
+ *
+ * @return NULL
+ */
+static void *uart_pump_tx(void *arg) {
+	struct UartPump *pump = arg;
+	struct pollfd fds[2];
+	uint8_t *span;
+	size_t len;
+	ssize_t rc;
+
+	fds[0].fd = pump->tx_event;
+	fds[0].events = POLLIN;
+	fds[1].fd = pump->dev->fd;
+	fds[1].events = POLLOUT;
+
+	while (atomic_load(&pump->running)) {
+		len = ring_read_span(&pump->tx, &span);
+		if (!len) {
+			/*
+			 * Wait for the producer to queue more data.
+			 */
+			poll(fds, 1, -1);
+			uart_pump_clear(pump->tx_event);
+			continue;
+		}
+
+		BUS_STATS_START(start);
+		rc = write(pump->dev->fd, span, len);
+		BUS_STATS_RECORD(&pump->dev->tx_stats, start, rc, len);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				BUS_STATS_RETRY(&pump->dev->tx_stats);
+				continue;
+			}
+
+			if (errno == EAGAIN) {
+				BUS_STATS_RETRY(&pump->dev->tx_stats);
+
+				/*
+				 * Wait for the UART device to accept more data.
+				 */
+				if (poll(fds, 2, -1) > 0 && fds[0].revents) {
+					uart_pump_clear(pump->tx_event);
+				}
+				continue;
+			}
+
+			printf("%s: failed to write uart data\r\n", __func__);
+			uart_pump_fail(pump, -errno);
+			break;
+		}
+
+		ring_read_commit(&pump->tx, rc);
+	}
+
+	return NULL;
+}
+
+/*
+ * Start the UART pump.
+ *
+ * The UART device is switched to non-blocking mode until the pump is
+ * stopped.
+ *
+ * @param pump points to the UART pump to be started, must have dev,
+ *  rx_size and tx_size populated
+ *
+ * @return - 0 if the starting procedure succeeded
+ *         - negative if the starting procedure failed
+ */
+int uart_pump_start(struct UartPump *pump) {
+	int rc;
+
+	/*
+	 * The pump threads poll the file descriptor of the UART device.
+	 */
+	if (pump->dev->transport) {
+		printf("%s: UART device on a transport has no file descriptor\r\n", __func__);
+		return -ENOTTY;
+	}
+
+	/*
+	 * Switch the UART device to non-blocking mode.
+	 */
+	pump->flags = fcntl(pump->dev->fd, F_GETFL);
+	if (pump->flags < 0 || fcntl(pump->dev->fd, F_SETFL, pump->flags | O_NONBLOCK) < 0) {
+		printf("%s: failed to set UART device non-blocking\r\n", __func__);
+		return -errno;
+	}
+
+	rc = ring_init(&pump->rx, pump->rx_size);
+	if (rc < 0) {
+		goto fail_rx;
+	}
+
+	rc = ring_init(&pump->tx, pump->tx_size);
+	if (rc < 0) {
+		goto fail_tx;
+	}
+
+	pump->rx_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (pump->rx_event < 0) {
+		printf("%s: failed to create UART pump event\r\n", __func__);
+		rc = -errno;
+		goto fail_rx_event;
+	}
+
+	pump->tx_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (pump->tx_event < 0) {
+		printf("%s: failed to create UART pump event\r\n", __func__);
+		rc = -errno;
+		goto fail_tx_event;
+	}
+
+	atomic_init(&pump->rx_full, false);
+	atomic_init(&pump->error, 0);
+	atomic_init(&pump->running, true);
+
+	rc = pthread_create(&pump->rx_thread, NULL, uart_pump_rx, pump);
+	if (rc) {
+		printf("%s: failed to create UART pump receive thread\r\n", __func__);
+		rc = -rc;
+		goto fail_rx_thread;
+	}
+
+	rc = pthread_create(&pump->tx_thread, NULL, uart_pump_tx, pump);
+	if (rc) {
+		printf("%s: failed to create UART pump transmit thread\r\n", __func__);
+		rc = -rc;
+		goto fail_tx_thread;
+	}
+
+	return 0;
+
+fail_tx_thread:
+	atomic_store(&pump->running, false);
+	uart_pump_wake(pump->rx_event);
+	pthread_join(pump->rx_thread, NULL);
+fail_rx_thread:
+	close(pump->tx_event);
+fail_tx_event:
+	close(pump->rx_event);
+fail_rx_event:
+	ring_destroy(&pump->tx);
+fail_tx:
+	ring_destroy(&pump->rx);
+fail_rx:
+	fcntl(pump->dev->fd, F_SETFL, pump->flags);
+	return rc;
+}
+
+/*
+ * Read received data from the UART pump, without blocking.
+ *
+ * Must only be called from a single consumer thread. The receive thread is
+ * woken up if it waits for the space freed up by the read.
+ *
+ * @param pump points to the UART pump to be read from
+ * @param buf points to the start of buffer to be read into
+ * @param buf_len length of the buffer to be read
+ *
+ * @return the number of bytes read, 0 if no data was received, check error
+ *  for whether the receive thread stopped
+ */
+size_t uart_pump_read(struct UartPump *pump, uint8_t *buf, size_t buf_len) {
+	size_t len;
+
+	len = ring_read(&pump->rx, buf, buf_len);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (len && atomic_exchange(&pump->rx_full, false)) {
+		uart_pump_wake(pump->rx_event);
+	}
+
+	return len;
+}
+
+/*
+ * Queue data to be written out by the UART pump, without blocking.
+ *
+ * Must only be called from a single producer thread.
+ *
+ * @param pump points to the UART pump to be written to
+ * @param buf points to the start of buffer to be written from
+ * @param buf_len length of the buffer to be written
+ *
+ * @return the number of bytes queued, less than buf_len if the transmit
+ *  ring buffer is full
+ */
+size_t uart_pump_write(struct UartPump *pump, const uint8_t *buf, size_t buf_len) {
+	size_t written;
+
+	written = ring_write(&pump->tx, buf, buf_len);
+	if (written) {
+		uart_pump_wake(pump->tx_event);
+	}
+
+	return written;
+}
+
+/*
+ * Stop the UART pump.
+ *
+ * @param pump points to the UART pump to be stopped
+ */
+void uart_pump_stop(struct UartPump *pump) {
+	atomic_store(&pump->running, false);
+
+	uart_pump_wake(pump->rx_event);
+	uart_pump_wake(pump->tx_event);
+
+	pthread_join(pump->rx_thread, NULL);
+	pthread_join(pump->tx_thread, NULL);
+
+	close(pump->tx_event);
+	close(pump->rx_event);
+
+	ring_destroy(&pump->tx);
+	ring_destroy(&pump->rx);
+
+	fcntl(pump->dev->fd, F_SETFL, pump->flags);
+}
@@ -0,0 +1,49 @@
+/*
+ * uart_pump.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "uart.h"
+#include "ring.h"
+
+#ifndef SRC_UART_PUMP_H_
+#define SRC_UART_PUMP_H_
+
+/*
+ * Background threads moving data between a UART device and a pair of
+ * lock-free ring buffers.
+ *
+ * A receive thread drains the UART device into rx, to be consumed by a
+ * single consumer thread, and a transmit thread writes out the data that
+ * a single producer thread queues into tx. The UART device is switched to
+ * non-blocking mode while the pump runs.
+ */
+struct UartPump {
+	struct UartDevice *dev; /**< Started UART device */
+	size_t rx_size; /**< Size of the receive ring buffer, a power of two */
+	size_t tx_size; /**< Size of the transmit ring buffer, a power of two */
+
+	struct RingBuffer rx; /**< Received data waiting to be consumed */
+	struct RingBuffer tx; /**< Data waiting to be written out */
+	int flags; /**< File status flags of the UART device before the pump started */
+	int rx_event; /**< Event file descriptor waking up the receive thread */
+	int tx_event; /**< Event file descriptor waking up the transmit thread */
+	atomic_bool rx_full; /**< Whether the receive thread waits for the consumer to free up space */
+	atomic_int error; /**< First error the threads stopped on, -EPIPE at end of file, 0 while running */
+	atomic_bool running; /**< Whether the threads should keep running */
+	pthread_t rx_thread; /**< Thread draining the UART device */
+	pthread_t tx_thread; /**< Thread writing to the UART device */
+};
+
+int uart_pump_start(struct UartPump *pump);
+size_t uart_pump_read(struct UartPump *pump, uint8_t *buf, size_t buf_len);
+size_t uart_pump_write(struct UartPump *pump, const uint8_t *buf, size_t buf_len);
+void uart_pump_stop(struct UartPump *pump);
+
+#endif /* SRC_UART_PUMP_H_ */
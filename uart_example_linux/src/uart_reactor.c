@@ -0,0 +1,516 @@
+/*
+ * uart_reactor.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <sys/epoll.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "uart_reactor.h"
+
+/*
+ * Update the events the UART port is registered for.
+ *
+ * The port is removed from the epoll instance while it waits for no events,
+ * so that a hangup is not reported over and over while its receive ring
+ * buffer is full, and added back once it waits for events again.
+ *
+ * @param reactor points to the reactor the port is added to
+ * @param port points to the UART port to be updated
+ * @param events the new events
+ *
+ * @return - 0 if the update procedure succeeded
+ *         - negative if the update procedure failed
+ */
+static int uart_reactor_set_events(struct UartReactor *reactor, struct UartPort *port, uint32_t events) {
+	struct epoll_event event;
+	int op;
+	int rc;
+
+	if (port->events == events) {
+		return 0;
+	}
+
+	if (!port->events) {
+		op = EPOLL_CTL_ADD;
+	} else if (!events) {
+		op = EPOLL_CTL_DEL;
+	} else {
+		op = EPOLL_CTL_MOD;
+	}
+
+	event.events = events;
+	event.data.ptr = port;
+
+	rc = epoll_ctl(reactor->epfd, op, port->dev->fd, &event);
+	if (rc < 0) {
+		printf("%s: failed to update UART port events\r\n", __func__);
+		return -errno;
+	}
+
+	port->events = events;
+
+	return 0;
+}
+
+/*
+ * Get the events the UART port should be registered for: received data
+ * while its receive ring buffer has room for it, and writes while there is
+ * data left in its transmit ring buffer.
+ *
+ * @param port points to the UART port
+ *
+ * @return the events, 0 once the port failed
+ */
+static uint32_t uart_port_events(struct UartPort *port) {
+	uint32_t events = 0;
+
+	if (port->error) {
+		return 0;
+	}
+
+	if (ring_space(&port->rx)) {
+		events |= EPOLLIN;
+	}
+
+	if (ring_len(&port->tx)) {
+		events |= EPOLLOUT;
+	}
+
+	return events;
+}
+
+/*
+ * Mark the UART port as failed, stop waiting for its events and report the
+ * error through its on_error callback.
+ *
+ * @param reactor points to the reactor the port is added to
+ * @param port points to the UART port that failed
+ * @param error the error the port failed with
+ */
+static void uart_port_fail(struct UartReactor *reactor, struct UartPort *port, int error) {
+	port->error = error;
+	uart_reactor_set_events(reactor, port, 0);
+
+	if (port->on_error) {
+		port->on_error(port);
+	}
+}
+
+/*
+ * Check whether a UART port was removed from the reactor by a callback
+ * since its event was reported.
+ *
+ * @param event points to the event of the port
+ *
+ * @return whether the port was removed
+ */
+static bool uart_port_removed(struct epoll_event *event) {
+	return !event->data.ptr;
+}
+
+/*
+ * Read all the available data of the UART port into its receive ring buffer.
+ *
+ * @param port points to the UART port to be read from
+ *
+ * @return - number of bytes read if the read procedure succeeded
+ *         - negative if the read procedure failed
+ */
+static int uart_port_fill(struct UartPort *port) {
+	uint8_t *span;
+	size_t len;
+	ssize_t rc;
+	int total = 0;
+
+	while (1) {
+		len = ring_write_span(&port->rx, &span);
+		if (!len) {
+			break;
+		}
+
+		BUS_STATS_START(start);
+		rc = read(port->dev->fd, span, len);
+		if (rc < 0) {
+			if (errno == EAGAIN || errno == EINTR) {
+				break;
+			}
+
+			BUS_STATS_RECORD(&port->dev->rx_stats, start, rc, len);
+
+			printf("%s: failed to read uart data\r\n", __func__);
+			return -errno;
+		}
+
+		BUS_STATS_RECORD(&port->dev->rx_stats, start, rc, len);
+
+		if (rc == 0) {
+			break;
+		}
+
+		ring_write_commit(&port->rx, rc);
+		total += rc;
+	}
+
+	return total;
+}
+
+/*
+ * Write as much data as possible out of the transmit ring buffer
+ * of the UART port.
+ *
+ * @param port points to the UART port to be written to
+ *
+ * @return - number of bytes written if the write procedure succeeded
+ *         - negative if the write procedure failed
+ */
+static int uart_port_drain(struct UartPort *port) {
+	uint8_t *span;
+	size_t len;
+	ssize_t rc;
+	int total = 0;
+
+	while (1) {
+		len = ring_read_span(&port->tx, &span);
+		if (!len) {
+			break;
+		}
+
+		BUS_STATS_START(start);
+		rc = write(port->dev->fd, span, len);
+		if (rc < 0) {
+			if (errno == EAGAIN || errno == EINTR) {
+				break;
+			}
+
+			BUS_STATS_RECORD(&port->dev->tx_stats, start, rc, len);
+
+			printf("%s: failed to write uart data\r\n", __func__);
+			return -errno;
+		}
+
+		BUS_STATS_RECORD(&port->dev->tx_stats, start, rc, len);
+
+		ring_read_commit(&port->tx, rc);
+		total += rc;
+	}
+
+	return total;
+}
+
+/*
+ * Start the reactor.
+ *
+ * @param reactor points to the reactor to be started
+ *
+ * @return - 0 if the starting procedure succeeded
+ *         - negative if the starting procedure failed
+ */
+int uart_reactor_start(struct UartReactor *reactor) {
+	int epfd;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		printf("%s: failed to create epoll instance\r\n", __func__);
+		return -errno;
+	}
+
+	reactor->epfd = epfd;
+	reactor->events = NULL;
+	reactor->num_events = 0;
+
+	return 0;
+}
+
+/*
+ * Add a UART port to the reactor.
+ *
+ * The UART device is switched to non-blocking mode, and the receive and
+ * transmit ring buffers are allocated.
+ *
+ * @param reactor points to the reactor to add the port to
+ * @param port points to the UART port to be added, must have dev, rx_size,
+ *  tx_size, on_read, on_write, on_error and priv populated
+ *
+ * @return - 0 if the adding procedure succeeded
+ *         - negative if the adding procedure failed
+ */
+int uart_reactor_add(struct UartReactor *reactor, struct UartPort *port) {
+	int flags;
+	int rc;
+
+	/*
+	 * The reactor polls the file descriptor of the UART device.
+	 */
+	if (port->dev->transport) {
+		printf("%s: UART device on a transport has no file descriptor\r\n", __func__);
+		return -ENOTTY;
+	}
+
+	/*
+	 * Switch the UART device to non-blocking mode.
+	 */
+	flags = fcntl(port->dev->fd, F_GETFL);
+	if (flags < 0 || fcntl(port->dev->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		printf("%s: failed to set UART device non-blocking\r\n", __func__);
+		return -errno;
+	}
+
+	rc = ring_init(&port->rx, port->rx_size);
+	if (rc < 0) {
+		goto fail_rx;
+	}
+
+	rc = ring_init(&port->tx, port->tx_size);
+	if (rc < 0) {
+		goto fail_tx;
+	}
+
+	/*
+	 * Wait for received data only, writes are waited for while there is
+	 * data left in the transmit ring buffer.
+	 */
+	port->events = 0;
+	port->error = 0;
+
+	rc = uart_reactor_set_events(reactor, port, EPOLLIN);
+	if (rc < 0) {
+		printf("%s: failed to add UART port to epoll instance\r\n", __func__);
+		goto fail_epoll;
+	}
+
+	return 0;
+
+fail_epoll:
+	ring_destroy(&port->tx);
+fail_tx:
+	ring_destroy(&port->rx);
+fail_rx:
+	return rc;
+}
+
+/*
+ * Remove a UART port from the reactor.
+ *
+ * The port may be removed from its own callbacks, or from those of the
+ * other ports.
+ *
+ * @param reactor points to the reactor to remove the port from
+ * @param port points to the UART port to be removed
+ *
+ * @return - 0 if the removing procedure succeeded
+ *         - negative if the removing procedure failed
+ */
+int uart_reactor_remove(struct UartReactor *reactor, struct UartPort *port) {
+	int rc;
+	int i;
+
+	rc = uart_reactor_set_events(reactor, port, 0);
+	if (rc < 0) {
+		printf("%s: failed to remove UART port from epoll instance\r\n", __func__);
+		return rc;
+	}
+
+	/*
+	 * Drop the events of the port not handled yet when removed from
+	 * a callback.
+	 */
+	for (i = 0; i < reactor->num_events; i++) {
+		if (reactor->events[i].data.ptr == port) {
+			reactor->events[i].data.ptr = NULL;
+		}
+	}
+
+	ring_destroy(&port->tx);
+	ring_destroy(&port->rx);
+
+	return 0;
+}
+
+/*
+ * Wait for events on the UART ports of the reactor and handle them.
+ *
+ * Received data is read into the receive ring buffer of the port before its
+ * on_read callback is invoked, and the port stops waiting for received data
+ * while the ring buffer is full. Pending data of the transmit ring buffer is
+ * written out, and the on_write callback is invoked once it is empty.
+ *
+ * A port that fails or hangs up stops being polled, and its on_error
+ * callback is invoked with the error set, -EPIPE for a hangup even when
+ * reading after it fails. The data received before the hangup is read
+ * first, as far as the UART device still returns it.
+ *
+ * @param reactor points to the reactor to be polled
+ * @param timeout_ms maximum time to wait for events, -1 to wait forever
+ *
+ * @return - number of events handled if the poll procedure succeeded
+ *         - negative if the poll procedure failed
+ */
+int uart_reactor_poll(struct UartReactor *reactor, int timeout_ms) {
+	struct epoll_event events[UART_REACTOR_MAX_EVENTS];
+	struct UartPort *port;
+	int num_events;
+	int rc;
+	int i;
+
+	num_events = epoll_wait(reactor->epfd, events, UART_REACTOR_MAX_EVENTS, timeout_ms);
+	if (num_events < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+
+		printf("%s: failed to wait for UART events\r\n", __func__);
+		return -errno;
+	}
+
+	reactor->events = events;
+	reactor->num_events = num_events;
+
+	for (i = 0; i < num_events; i++) {
+		if (uart_port_removed(&events[i])) {
+			continue;
+		}
+
+		port = events[i].data.ptr;
+
+		if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+			rc = uart_port_fill(port);
+			if (rc > 0 && port->on_read) {
+				port->on_read(port);
+				if (uart_port_removed(&events[i])) {
+					continue;
+				}
+			}
+
+			/*
+			 * Report a hangup once all the data received before it
+			 * was read, the receive ring buffer having room left, or
+			 * once reading after it failed, eg: with -EIO on a pty.
+			 */
+			if (rc < 0 || ring_space(&port->rx)) {
+				if (events[i].events & EPOLLHUP) {
+					rc = -EPIPE;
+				} else if (events[i].events & EPOLLERR) {
+					rc = rc < 0 ? rc : -EIO;
+				}
+			}
+
+			if (rc < 0) {
+				uart_port_fail(reactor, port, rc);
+				continue;
+			}
+		}
+
+		if (events[i].events & EPOLLOUT) {
+			rc = uart_port_drain(port);
+			if (rc < 0) {
+				uart_port_fail(reactor, port, rc);
+				continue;
+			}
+
+			if (!ring_len(&port->tx) && port->on_write) {
+				port->on_write(port);
+				if (uart_port_removed(&events[i])) {
+					continue;
+				}
+			}
+		}
+
+		rc = uart_reactor_set_events(reactor, port, uart_port_events(port));
+		if (rc < 0) {
+			uart_port_fail(reactor, port, rc);
+		}
+	}
+
+	reactor->events = NULL;
+	reactor->num_events = 0;
+
+	return num_events;
+}
+
+/*
+ * Read received data of a UART port of the reactor.
+ *
+ * The port waits for received data again once its receive ring buffer has
+ * room for it.
+ *
+ * @param reactor points to the reactor the port is added to
+ * @param port points to the UART port to be read from
+ * @param buf points to the start of buffer to be read into
+ * @param buf_len length of the buffer to be read into
+ *
+ * @return - number of bytes read if the read procedure succeeded,
+ *           less than buf_len if the receive ring buffer ran out of data
+ *         - negative if the read procedure failed
+ */
+int uart_port_read(struct UartReactor *reactor, struct UartPort *port, uint8_t *buf, size_t buf_len) {
+	size_t len;
+	int rc;
+
+	len = ring_read(&port->rx, buf, buf_len);
+
+	rc = uart_reactor_set_events(reactor, port, uart_port_events(port));
+	if (rc < 0) {
+		return rc;
+	}
+
+	return len;
+}
+
+/*
+ * Write data to a UART port of the reactor.
+ *
+ * The data is written out immediately as far as the UART device accepts it,
+ * and the rest is queued into the transmit ring buffer to be written out
+ * when the UART device becomes writable.
+ *
+ * @param reactor points to the reactor the port is added to
+ * @param port points to the UART port to be written to
+ * @param buf points to the start of buffer to be written from
+ * @param buf_len length of the buffer to be written
+ *
+ * @return - number of bytes accepted if the write procedure succeeded,
+ *           less than buf_len if the transmit ring buffer is full
+ *         - negative if the write procedure failed
+ */
+int uart_port_write(struct UartReactor *reactor, struct UartPort *port, const uint8_t *buf, size_t buf_len) {
+	size_t written;
+	int rc;
+
+	if (port->error) {
+		return port->error;
+	}
+
+	written = ring_write(&port->tx, buf, buf_len);
+
+	rc = uart_port_drain(port);
+	if (rc < 0) {
+		return rc;
+	}
+
+	/*
+	 * Wait for the UART device to become writable if data is left.
+	 */
+	rc = uart_reactor_set_events(reactor, port, uart_port_events(port));
+	if (rc < 0) {
+		return rc;
+	}
+
+	return written;
+}
+
+/*
+ * Stop the reactor.
+ *
+ * @param reactor points to the reactor to be stopped
+ */
+void uart_reactor_stop(struct UartReactor *reactor) {
+	close(reactor->epfd);
+}
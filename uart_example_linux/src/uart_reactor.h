@@ -0,0 +1,65 @@
+/*
+ * uart_reactor.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <sys/epoll.h>
+
+#include <stdint.h>
+
+#include "uart.h"
+#include "ring.h"
+
+#ifndef SRC_UART_REACTOR_H_
+#define SRC_UART_REACTOR_H_
+
+/*
+ * Maximum number of events handled by a single reactor poll.
+ */
+#define UART_REACTOR_MAX_EVENTS 16
+
+struct UartPort;
+
+/*
+ * Callback invoked by the reactor for a UART port.
+ */
+typedef void (*uart_port_callback)(struct UartPort *port);
+
+/*
+ * UART device multiplexed by a reactor.
+ */
+struct UartPort {
+	struct UartDevice *dev; /**< Started UART device */
+	size_t rx_size; /**< Size of the receive ring buffer, a power of two */
+	size_t tx_size; /**< Size of the transmit ring buffer, a power of two */
+	uart_port_callback on_read; /**< Called when data was received into rx, may be NULL */
+	uart_port_callback on_write; /**< Called when tx was fully written out, may be NULL */
+	uart_port_callback on_error; /**< Called once when the port fails or hangs up, may be NULL */
+	void *priv; /**< Private data for the callbacks */
+
+	struct RingBuffer rx; /**< Received data waiting to be consumed with uart_port_read */
+	struct RingBuffer tx; /**< Data waiting to be written out */
+	uint32_t events; /**< Events the port is registered for, 0 when not registered */
+	int error; /**< Error the port failed with, 0 while it works */
+};
+
+/*
+ * Event loop multiplexing many UART ports on a single thread.
+ */
+struct UartReactor {
+	int epfd; /**< File descriptor of the epoll instance */
+	struct epoll_event *events; /**< Events being handled by the current poll */
+	int num_events; /**< Number of events being handled by the current poll */
+};
+
+int uart_reactor_start(struct UartReactor *reactor);
+int uart_reactor_add(struct UartReactor *reactor, struct UartPort *port);
+int uart_reactor_remove(struct UartReactor *reactor, struct UartPort *port);
+int uart_reactor_poll(struct UartReactor *reactor, int timeout_ms);
+int uart_port_read(struct UartReactor *reactor, struct UartPort *port, uint8_t *buf, size_t buf_len);
+int uart_port_write(struct UartReactor *reactor, struct UartPort *port, const uint8_t *buf, size_t buf_len);
+void uart_reactor_stop(struct UartReactor *reactor);
+
+#endif /* SRC_UART_REACTOR_H_ */
@@ -0,0 +1,150 @@
+/*
+ * uart_serial.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <asm/termbits.h>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "uart_serial.h"
+
+/*
+ * Set an arbitrary baud-rate on a serial line.
+ *
+ * @param fd file descriptor of the serial line
+ * @param rate the baud-rate, eg: 3000000
+ *
+ * @return - 0 if the setting procedure succeeded
+ *         - negative if the setting procedure failed
+ */
+int uart_serial_set_rate(int fd, unsigned int rate) {
+	struct termios2 tty;
+	int rc;
+
+	rc = ioctl(fd, TCGETS2, &tty);
+	if (rc < 0) {
+		printf("%s: failed to get attributes\r\n", __func__);
+		return -errno;
+	}
+
+	tty.c_cflag &= ~CBAUD;
+	tty.c_cflag |= BOTHER;
+	tty.c_ospeed = rate;
+
+	tty.c_cflag &= ~(CBAUD << IBSHIFT);
+	tty.c_cflag |= BOTHER << IBSHIFT;
+	tty.c_ispeed = rate;
+
+	rc = ioctl(fd, TCSETS2, &tty);
+	if (rc < 0) {
+		printf("%s: failed to set baud-rate\r\n", __func__);
+		return -errno;
+	}
+
+	return 0;
+}
+
+/*
+ * Get the baud-rate actually used by a serial line, which may differ from
+ * the requested one depending on the clock of the UART.
+ *
+ * @param fd file descriptor of the serial line
+ * @param rate is set to the baud-rate
+ *
+ * @return - 0 if the getting procedure succeeded
+ *         - negative if the getting procedure failed
+ */
+int uart_serial_get_rate(int fd, unsigned int *rate) {
+	struct termios2 tty;
+	int rc;
+
+	rc = ioctl(fd, TCGETS2, &tty);
+	if (rc < 0) {
+		printf("%s: failed to get attributes\r\n", __func__);
+		return -errno;
+	}
+
+	*rate = tty.c_ospeed;
+
+	return 0;
+}
+
+/*
+ * Ask the serial driver to push received data to the TTY layer right away,
+ * instead of batching it.
+ *
+ * Not all serial drivers support this setting.
+ *
+ * @param fd file descriptor of the serial line
+ *
+ * @return - 0 if the setting procedure succeeded
+ *         - negative if the setting procedure failed or is not supported
+ */
+int uart_serial_set_low_latency(int fd) {
+	struct serial_struct serial;
+	int rc;
+
+	rc = ioctl(fd, TIOCGSERIAL, &serial);
+	if (rc < 0) {
+		return -errno;
+	}
+
+	serial.flags |= ASYNC_LOW_LATENCY;
+
+	rc = ioctl(fd, TIOCSSERIAL, &serial);
+	if (rc < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+/*
+ * Set the number of bytes the receive FIFO of the UART collects before
+ * raising an interrupt, through the rx_trig_bytes attribute of the TTY.
+ *
+ * Only some serial drivers, eg: 8250, expose this attribute.
+ *
+ * @param filename path of the serial line, eg: /dev/ttyS0
+ * @param bytes the receive FIFO trigger level
+ *
+ * @return - 0 if the setting procedure succeeded
+ *         - negative if the setting procedure failed or is not supported
+ */
+int uart_serial_set_rx_trigger(const char *filename, int bytes) {
+	char attr[PATH_MAX + 32];
+	char path[PATH_MAX];
+	char *name;
+	FILE *file;
+	int rc;
+
+	if (!realpath(filename, path)) {
+		return -errno;
+	}
+
+	name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+
+	snprintf(attr, sizeof(attr), "/sys/class/tty/%s/rx_trig_bytes", name);
+
+	file = fopen(attr, "w");
+	if (!file) {
+		return -errno;
+	}
+
+	rc = fprintf(file, "%d", bytes);
+	if (fclose(file) || rc < 0) {
+		return -EIO;
+	}
+
+	return 0;
+}
@@ -0,0 +1,23 @@
+/*
+ * uart_serial.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#ifndef SRC_UART_SERIAL_H_
+#define SRC_UART_SERIAL_H_
+
+/*
+ * Serial line settings that are not reachable through the termios API.
+ *
+ * These are kept apart from uart.c because the kernel termios2 definitions
+ * cannot be included together with the C library termios.h.
+ */
+
+int uart_serial_set_rate(int fd, unsigned int rate);
+int uart_serial_get_rate(int fd, unsigned int *rate);
+int uart_serial_set_low_latency(int fd);
+int uart_serial_set_rx_trigger(const char *filename, int bytes);
+
+#endif /* SRC_UART_SERIAL_H_ */
@@ -0,0 +1,655 @@
+/*
+ * uart_uring.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "uart_uring.h"
+
+/*
+ * The indexes shared with the kernel are accessed with the GCC atomic
+ * builtins, the rings being plain memory mapped from the kernel.
+ */
+#define URING_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define URING_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+static int uart_uring_setup(unsigned int entries, struct io_uring_params *params) {
+	int rc = syscall(__NR_io_uring_setup, entries, params);
+
+	return rc < 0 ? -errno : rc;
+}
+
+static int uart_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+		unsigned int flags) {
+	int rc = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+
+	return rc < 0 ? -errno : rc;
+}
+
+static int uart_uring_register(int fd, unsigned int opcode, void *arg, unsigned int num_args) {
+	int rc = syscall(__NR_io_uring_register, fd, opcode, arg, num_args);
+
+	return rc < 0 ? -errno : rc;
+}
+
+/*
+ * Map the rings of a set up io_uring instance.
+ *
+ * @param ring points to the ring, having fd set
+ * @param params points to the parameters filled by the setup
+ *
+ * @return - 0 if the mapping procedure succeeded
+ *         - negative if the mapping procedure failed
+ */
+static int uart_uring_map(struct UartUring *ring, struct io_uring_params *params) {
+	uint8_t *sq;
+	uint8_t *cq;
+
+	ring->sq_ring_len = params->sq_off.array + params->sq_entries * sizeof(unsigned int);
+	ring->cq_ring_len = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+
+	/*
+	 * Kernels with a single mapping for both rings need it to cover both.
+	 */
+	if (params->features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_ring_len > ring->sq_ring_len) {
+			ring->sq_ring_len = ring->cq_ring_len;
+		}
+		ring->cq_ring_len = ring->sq_ring_len;
+	}
+
+	ring->sq_ring = mmap(NULL, ring->sq_ring_len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		return -errno;
+	}
+
+	if (params->features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_ring = ring->sq_ring;
+	} else {
+		ring->cq_ring = mmap(NULL, ring->cq_ring_len, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cq_ring == MAP_FAILED) {
+			munmap(ring->sq_ring, ring->sq_ring_len);
+			return -errno;
+		}
+	}
+
+	ring->sqes_len = params->sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		if (ring->cq_ring != ring->sq_ring) {
+			munmap(ring->cq_ring, ring->cq_ring_len);
+		}
+		munmap(ring->sq_ring, ring->sq_ring_len);
+		return -errno;
+	}
+
+	sq = ring->sq_ring;
+	ring->sq_head = (unsigned int *)(sq + params->sq_off.head);
+	ring->sq_tail = (unsigned int *)(sq + params->sq_off.tail);
+	ring->sq_array = (unsigned int *)(sq + params->sq_off.array);
+	ring->sq_mask = *(unsigned int *)(sq + params->sq_off.ring_mask);
+
+	cq = ring->cq_ring;
+	ring->cq_head = (unsigned int *)(cq + params->cq_off.head);
+	ring->cq_tail = (unsigned int *)(cq + params->cq_off.tail);
+	ring->cqes = (struct io_uring_cqe *)(cq + params->cq_off.cqes);
+	ring->cq_mask = *(unsigned int *)(cq + params->cq_off.ring_mask);
+
+	return 0;
+}
+
+/*
+ * Unmap the rings of an io_uring instance.
+ *
+ * @param ring points to the mapped ring
+ */
+static void uart_uring_unmap(struct UartUring *ring) {
+	munmap(ring->sqes, ring->sqes_len);
+	if (ring->cq_ring != ring->sq_ring) {
+		munmap(ring->cq_ring, ring->cq_ring_len);
+	}
+	munmap(ring->sq_ring, ring->sq_ring_len);
+}
+
+/*
+ * Register the file descriptors of the ports and the buffers of the ring,
+ * keeping the plain ones for whatever cannot be registered, eg: buffers
+ * over RLIMIT_MEMLOCK on older kernels.
+ *
+ * @param ring points to the mapped ring
+ */
+static void uart_uring_register_all(struct UartUring *ring) {
+	int fds[ring->num_devs ? ring->num_devs : 1];
+	struct iovec iovs[ring->num_bufs ? ring->num_bufs : 1];
+	size_t i;
+
+	for (i = 0; i < ring->num_devs; i++) {
+		fds[i] = ring->devs[i]->fd;
+	}
+
+	ring->fixed_files = ring->num_devs &&
+			uart_uring_register(ring->fd, IORING_REGISTER_FILES, fds, ring->num_devs) >= 0;
+	if (ring->num_devs && !ring->fixed_files) {
+		printf("%s: failed to register UART file descriptors\r\n", __func__);
+	}
+
+	for (i = 0; i < ring->num_bufs; i++) {
+		iovs[i].iov_base = ring->bufs + i * ring->buf_len;
+		iovs[i].iov_len = ring->buf_len;
+	}
+
+	ring->fixed_bufs = ring->num_bufs &&
+			uart_uring_register(ring->fd, IORING_REGISTER_BUFFERS, iovs, ring->num_bufs) >= 0;
+	if (ring->num_bufs && !ring->fixed_bufs) {
+		printf("%s: failed to register UART buffers\r\n", __func__);
+	}
+}
+
+/*
+ * Set up io_uring for the ring.
+ *
+ * @param ring points to the ring to be set up
+ *
+ * @return - 0 if io_uring is set up
+ *         - negative if io_uring is unavailable
+ */
+static int uart_uring_setup_all(struct UartUring *ring) {
+	struct io_uring_params params;
+	int rc;
+
+	/*
+	 * Ask for completions to be posted when the application enters the
+	 * kernel rather than by interrupting it, retrying without on kernels
+	 * that do not know these flags.
+	 */
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+	rc = uart_uring_setup(ring->entries, &params);
+	if (rc == -EINVAL) {
+		memset(&params, 0, sizeof(params));
+		rc = uart_uring_setup(ring->entries, &params);
+	}
+
+	if (rc < 0) {
+		printf("%s: io_uring unavailable, falling back to synchronous I/O\r\n", __func__);
+		return rc;
+	}
+
+	ring->fd = rc;
+
+	rc = uart_uring_map(ring, &params);
+	if (rc < 0) {
+		printf("%s: failed to map io_uring, falling back to synchronous I/O\r\n", __func__);
+		close(ring->fd);
+		ring->fd = -1;
+		return rc;
+	}
+
+	/*
+	 * The completion ring is at least as large as the submission one, so
+	 * bounding the operations in flight to the submission entries keeps it
+	 * from overflowing.
+	 */
+	ring->entries = params.sq_entries;
+
+	uart_uring_register_all(ring);
+
+	return 0;
+}
+
+/*
+ * Switch the UART devices of the ring to non-blocking mode for the
+ * synchronous fallback, so that an operation on a port that is not ready
+ * stays pending instead of blocking the others.
+ *
+ * @param ring points to the ring falling back
+ *
+ * @return - 0 if the switching procedure succeeded
+ *         - negative if the switching procedure failed
+ */
+static int uart_uring_start_sync(struct UartUring *ring) {
+	size_t i;
+	int rc;
+
+	ring->flags = malloc((ring->num_devs ? ring->num_devs : 1) * sizeof(*ring->flags));
+	if (!ring->flags) {
+		printf("%s: failed to allocate UART file status flags\r\n", __func__);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < ring->num_devs; i++) {
+		if (ring->devs[i]->transport) {
+			continue;
+		}
+
+		ring->flags[i] = fcntl(ring->devs[i]->fd, F_GETFL);
+		if (ring->flags[i] < 0 ||
+				fcntl(ring->devs[i]->fd, F_SETFL, ring->flags[i] | O_NONBLOCK) < 0) {
+			printf("%s: failed to set UART device non-blocking\r\n", __func__);
+			rc = -errno;
+			goto fail_flags;
+		}
+	}
+
+	return 0;
+
+fail_flags:
+	while (i--) {
+		if (!ring->devs[i]->transport) {
+			fcntl(ring->devs[i]->fd, F_SETFL, ring->flags[i]);
+		}
+	}
+
+	free(ring->flags);
+	ring->flags = NULL;
+	return rc;
+}
+
+/*
+ * Start the ring, falling back to synchronous operations when asked to,
+ * when io_uring is unavailable or when some UART device is on a transport.
+ *
+ * @param ring points to the ring to be started, must have entries, devs,
+ *  num_devs, num_bufs, buf_len and sync populated
+ *
+ * @return - 0 if the start procedure succeeded, with or without io_uring
+ *         - negative if the start procedure failed
+ */
+int uart_uring_start(struct UartUring *ring) {
+	bool sync = ring->sync;
+	void *bufs = NULL;
+	size_t i;
+	int rc;
+
+	ring->fd = -1;
+	ring->fixed_files = false;
+	ring->fixed_bufs = false;
+	ring->to_submit = 0;
+	ring->in_flight = 0;
+	ring->flags = NULL;
+	ring->queued = NULL;
+	ring->queued_tail = &ring->queued;
+	ring->pending = NULL;
+	ring->pending_tail = &ring->pending;
+	ring->completed = NULL;
+	ring->completed_tail = &ring->completed;
+	ring->num_completed = 0;
+
+	/*
+	 * Page-aligned buffers, so that registering them pins whole pages.
+	 */
+	if (ring->num_bufs) {
+		rc = posix_memalign(&bufs, sysconf(_SC_PAGESIZE), ring->num_bufs * ring->buf_len);
+		if (rc) {
+			printf("%s: failed to allocate UART buffers\r\n", __func__);
+			return -rc;
+		}
+	}
+
+	ring->bufs = bufs;
+
+	for (i = 0; i < ring->num_devs; i++) {
+		if (ring->devs[i]->transport) {
+			sync = true;
+		}
+	}
+
+	if (!sync && uart_uring_setup_all(ring) == 0) {
+		return 0;
+	}
+
+	rc = uart_uring_start_sync(ring);
+	if (rc < 0) {
+		free(ring->bufs);
+		return rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Get a buffer of the ring, registered with io_uring if available.
+ *
+ * @param ring points to the started ring
+ * @param index index of the buffer, less than num_bufs
+ *
+ * @return the start of the buffer, buf_len bytes long
+ */
+uint8_t *uart_uring_buf(struct UartUring *ring, size_t index) {
+	return ring->bufs + index * ring->buf_len;
+}
+
+/*
+ * Queue an operation, to be started on the next submission.
+ * No syscall is made.
+ *
+ * @param ring points to the started ring
+ * @param io points to the operation, having port, buf, len, write and priv
+ *  populated, must stay valid until it is reaped
+ *
+ * @return - 0 if the operation was queued
+ *         - negative if too many operations are in flight
+ */
+int uart_uring_queue(struct UartUring *ring, struct UartIo *io) {
+	struct io_uring_sqe *sqe;
+	size_t offset;
+	unsigned int tail;
+
+	if (ring->in_flight >= ring->entries) {
+		return -EBUSY;
+	}
+
+#if BUS_STATS
+	clock_gettime(CLOCK_MONOTONIC, &io->start);
+#endif
+
+	ring->in_flight++;
+
+	if (ring->fd < 0) {
+		io->next = NULL;
+		*ring->queued_tail = io;
+		ring->queued_tail = &io->next;
+		ring->to_submit++;
+		return 0;
+	}
+
+	tail = *ring->sq_tail;
+	sqe = &ring->sqes[tail & ring->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+
+	sqe->opcode = io->write ? IORING_OP_WRITE : IORING_OP_READ;
+	sqe->addr = (uintptr_t)io->buf;
+	sqe->len = io->len;
+	sqe->off = -1;
+	sqe->user_data = (uintptr_t)io;
+
+	if (ring->fixed_files) {
+		sqe->fd = io->port;
+		sqe->flags |= IOSQE_FIXED_FILE;
+	} else {
+		sqe->fd = ring->devs[io->port]->fd;
+	}
+
+	/*
+	 * Operations fully inside a registered buffer skip the mapping of
+	 * their pages.
+	 */
+	if (ring->fixed_bufs && io->buf >= ring->bufs &&
+			io->buf < ring->bufs + ring->num_bufs * ring->buf_len) {
+		offset = io->buf - ring->bufs;
+		if (offset % ring->buf_len + io->len <= ring->buf_len) {
+			sqe->opcode = io->write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+			sqe->buf_index = offset / ring->buf_len;
+		}
+	}
+
+	ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+	URING_STORE_RELEASE(ring->sq_tail, tail + 1);
+	ring->to_submit++;
+
+	return 0;
+}
+
+/*
+ * Try each submitted operation of the fallback once, with a single read()
+ * or write(), the operations whose port is not ready staying pending.
+ *
+ * @param ring points to the started ring, falling back
+ */
+static void uart_uring_run_pending(struct UartUring *ring) {
+	struct UartIo **link = &ring->pending;
+	struct UartDevice *dev;
+	struct UartIo *io;
+	ssize_t rc;
+
+	while (*link) {
+		io = *link;
+		dev = ring->devs[io->port];
+
+		if (dev->transport) {
+			if (io->write) {
+				rc = uart_writen(dev, (char *)io->buf, io->len);
+			} else {
+				rc = uart_readn(dev, io->buf, io->len);
+			}
+		} else {
+			do {
+				if (io->write) {
+					rc = write(dev->fd, io->buf, io->len);
+				} else {
+					rc = read(dev->fd, io->buf, io->len);
+				}
+			} while (rc < 0 && errno == EINTR);
+
+			if (rc < 0 && errno == EAGAIN) {
+				link = &io->next;
+				continue;
+			}
+
+			if (rc < 0) {
+				rc = -errno;
+			}
+
+			BUS_STATS_RECORD(io->write ? &dev->tx_stats : &dev->rx_stats, io->start, rc, io->len);
+		}
+
+		io->result = rc;
+
+		*link = io->next;
+		if (!*link) {
+			ring->pending_tail = link;
+		}
+
+		io->next = NULL;
+		*ring->completed_tail = io;
+		ring->completed_tail = &io->next;
+		ring->num_completed++;
+	}
+}
+
+/*
+ * Submit the queued operations to the fallback, and run them until enough
+ * of them completed.
+ *
+ * @param ring points to the started ring, falling back
+ * @param wait_nr number of completions to wait for, 0 to return right away
+ *
+ * @return - number of operations submitted if the submit procedure succeeded
+ *         - negative if the submit procedure failed
+ */
+static int uart_uring_submit_sync(struct UartUring *ring, unsigned int wait_nr) {
+	struct pollfd fds[ring->entries];
+	unsigned int num_submitted = ring->to_submit;
+	struct UartDevice *dev;
+	struct UartIo *io;
+	nfds_t num_fds;
+	int rc;
+
+	if (ring->queued) {
+		*ring->pending_tail = ring->queued;
+		ring->pending_tail = ring->queued_tail;
+		ring->queued = NULL;
+		ring->queued_tail = &ring->queued;
+	}
+
+	ring->to_submit = 0;
+
+	/*
+	 * Operations cannot complete without being in flight.
+	 */
+	if (wait_nr > ring->in_flight) {
+		wait_nr = ring->in_flight;
+	}
+
+	uart_uring_run_pending(ring);
+
+	while (ring->num_completed < wait_nr) {
+		/*
+		 * Wait for the ports of the pending operations to become ready.
+		 */
+		num_fds = 0;
+		for (io = ring->pending; io; io = io->next) {
+			dev = ring->devs[io->port];
+			fds[num_fds].fd = dev->fd;
+			fds[num_fds].events = io->write ? POLLOUT : POLLIN;
+			num_fds++;
+		}
+
+		rc = poll(fds, num_fds, -1);
+		if (rc < 0 && errno != EINTR) {
+			printf("%s: failed to wait for UART operations\r\n", __func__);
+			return -errno;
+		}
+
+		uart_uring_run_pending(ring);
+	}
+
+	return num_submitted;
+}
+
+/*
+ * Start the queued operations with a single syscall, optionally waiting
+ * for some operations to complete.
+ *
+ * When falling back, the submitted operations are run synchronously
+ * instead, polling their ports while waiting.
+ *
+ * @param ring points to the started ring
+ * @param wait_nr number of completions to wait for, 0 to return right away
+ *
+ * @return - number of operations started if the submit procedure succeeded
+ *         - negative if the submit procedure failed
+ */
+int uart_uring_submit(struct UartUring *ring, unsigned int wait_nr) {
+	unsigned int flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+	int rc;
+
+	if (ring->fd < 0) {
+		return uart_uring_submit_sync(ring, wait_nr);
+	}
+
+	if (!ring->to_submit && !wait_nr) {
+		return 0;
+	}
+
+	do {
+		rc = uart_uring_enter(ring->fd, ring->to_submit, wait_nr, flags);
+	} while (rc == -EINTR);
+
+	if (rc < 0) {
+		printf("%s: failed to submit UART operations\r\n", __func__);
+		return rc;
+	}
+
+	ring->to_submit -= rc;
+
+	return rc;
+}
+
+/*
+ * Take completed operations out of the ring, in completion order, without
+ * any syscall.
+ *
+ * When falling back, the pending operations are tried once more first,
+ * without waiting.
+ *
+ * @param ring points to the started ring
+ * @param ios points to the start of the operations to be taken into
+ * @param num_ios maximum number of operations to be taken
+ *
+ * @return the number of operations taken
+ */
+int uart_uring_reap(struct UartUring *ring, struct UartIo **ios, size_t num_ios) {
+	struct io_uring_cqe *cqe;
+	struct UartDevice *dev;
+	unsigned int head;
+	unsigned int tail;
+	size_t num_taken = 0;
+
+	if (ring->fd < 0) {
+		uart_uring_run_pending(ring);
+
+		while (ring->completed && num_taken < num_ios) {
+			ios[num_taken++] = ring->completed;
+			ring->completed = ring->completed->next;
+		}
+
+		if (!ring->completed) {
+			ring->completed_tail = &ring->completed;
+		}
+
+		ring->num_completed -= num_taken;
+		ring->in_flight -= num_taken;
+
+		return num_taken;
+	}
+
+	head = *ring->cq_head;
+	tail = URING_LOAD_ACQUIRE(ring->cq_tail);
+
+	while (head != tail && num_taken < num_ios) {
+		cqe = &ring->cqes[head & ring->cq_mask];
+		ios[num_taken] = (struct UartIo *)(uintptr_t)cqe->user_data;
+		ios[num_taken]->result = cqe->res;
+
+		dev = ring->devs[ios[num_taken]->port];
+		BUS_STATS_RECORD(ios[num_taken]->write ? &dev->tx_stats : &dev->rx_stats,
+				ios[num_taken]->start, cqe->res, ios[num_taken]->len);
+
+		head++;
+		num_taken++;
+	}
+
+	URING_STORE_RELEASE(ring->cq_head, head);
+	ring->in_flight -= num_taken;
+
+	return num_taken;
+}
+
+/*
+ * Stop the ring. Operations still in flight are cancelled, and must not be
+ * reaped anymore. The UART devices switched to non-blocking mode by the
+ * fallback are switched back.
+ *
+ * @param ring points to the started ring
+ */
+void uart_uring_stop(struct UartUring *ring) {
+	size_t i;
+
+	if (ring->flags) {
+		for (i = 0; i < ring->num_devs; i++) {
+			if (!ring->devs[i]->transport) {
+				fcntl(ring->devs[i]->fd, F_SETFL, ring->flags[i]);
+			}
+		}
+
+		free(ring->flags);
+	}
+
+	/*
+	 * Closing the instance unregisters the files and buffers and cancels
+	 * the operations in flight.
+	 */
+	if (ring->fd >= 0) {
+		uart_uring_unmap(ring);
+		close(ring->fd);
+	}
+
+	free(ring->bufs);
+}
@@ -0,0 +1,96 @@
+/*
+ * uart_uring.h
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "uart.h"
+
+#ifndef SRC_UART_URING_H_
+#define SRC_UART_URING_H_
+
+/*
+ * Read or write of a UART port, batched with others through a UartUring.
+ */
+struct UartIo {
+	size_t port; /**< Index of the UART device in the devices of the ring */
+	uint8_t *buf; /**< Buffer to be read into or written from, best taken from the registered buffers with uart_uring_buf */
+	size_t len; /**< Length of the buffer */
+	bool write; /**< Whether the buffer is written, read otherwise */
+	void *priv; /**< Private data of the caller */
+
+	int result; /**< Number of bytes transferred or negative error, valid once reaped */
+	struct UartIo *next; /**< Next operation in the queues of the synchronous fallback */
+#if BUS_STATS
+	struct timespec start; /**< Time the operation was queued at */
+#endif
+};
+
+/*
+ * Batched I/O on many UART ports through io_uring: operations are queued
+ * without a syscall, submitted together with a single io_uring_enter,
+ * and their completions are reaped from the shared completion ring without
+ * any syscall. The file descriptors of the ports and a pool of buffers are
+ * registered once, so the kernel does not look them up or map them for
+ * each operation.
+ *
+ * When io_uring is unavailable, eg: an old kernel or a seccomp filter, or
+ * when asked to, the ring falls back to synchronous I/O behind the same
+ * interface: the UART devices are switched to non-blocking mode, and each
+ * submitted operation is tried with a single read() or write() whenever
+ * the ring is submitted or reaped, staying pending while its port is not
+ * ready.
+ */
+struct UartUring {
+	unsigned int entries; /**< Maximum number of operations in flight, a power of two */
+	struct UartDevice **devs; /**< Started UART devices, the ports of the operations */
+	size_t num_devs; /**< Number of UART devices */
+	size_t num_bufs; /**< Number of registered buffers */
+	size_t buf_len; /**< Length of each registered buffer */
+	bool sync; /**< Whether to use the synchronous fallback even if io_uring is available */
+
+	int fd; /**< File descriptor of the io_uring instance, -1 when falling back */
+	bool fixed_files; /**< Whether the file descriptors of the ports are registered */
+	bool fixed_bufs; /**< Whether the buffers are registered */
+	uint8_t *bufs; /**< Buffers, num_bufs * buf_len bytes */
+	void *sq_ring; /**< Mapping of the submission ring */
+	size_t sq_ring_len; /**< Length of the mapping of the submission ring */
+	void *cq_ring; /**< Mapping of the completion ring, the submission one if shared */
+	size_t cq_ring_len; /**< Length of the mapping of the completion ring */
+	struct io_uring_sqe *sqes; /**< Mapping of the submission queue entries */
+	size_t sqes_len; /**< Length of the mapping of the submission queue entries */
+	unsigned int *sq_head; /**< Head of the submission ring, advanced by the kernel */
+	unsigned int *sq_tail; /**< Tail of the submission ring, advanced when queueing */
+	unsigned int *sq_array; /**< Indexes of the submission queue entries in the ring */
+	unsigned int sq_mask; /**< Mask of the submission ring indexes */
+	unsigned int *cq_head; /**< Head of the completion ring, advanced when reaping */
+	unsigned int *cq_tail; /**< Tail of the completion ring, advanced by the kernel */
+	struct io_uring_cqe *cqes; /**< Completion queue entries */
+	unsigned int cq_mask; /**< Mask of the completion ring indexes */
+	unsigned int to_submit; /**< Operations queued since the last submission */
+	unsigned int in_flight; /**< Operations queued and not reaped yet */
+	int *flags; /**< File status flags of the UART devices before the fallback, NULL with io_uring */
+	struct UartIo *queued; /**< Operations queued for the fallback, not submitted yet */
+	struct UartIo **queued_tail; /**< Link to append queued operations at */
+	struct UartIo *pending; /**< Operations submitted to the fallback, waiting for their port */
+	struct UartIo **pending_tail; /**< Link to append submitted operations at */
+	struct UartIo *completed; /**< Operations run by the fallback, waiting to be reaped */
+	struct UartIo **completed_tail; /**< Link to append completed operations at */
+	unsigned int num_completed; /**< Number of operations run by the fallback, waiting to be reaped */
+};
+
+int uart_uring_start(struct UartUring *ring);
+uint8_t *uart_uring_buf(struct UartUring *ring, size_t index);
+int uart_uring_queue(struct UartUring *ring, struct UartIo *io);
+int uart_uring_submit(struct UartUring *ring, unsigned int wait_nr);
+int uart_uring_reap(struct UartUring *ring, struct UartIo **ios, size_t num_ios);
+void uart_uring_stop(struct UartUring *ring);
+
+#endif /* SRC_UART_URING_H_ */
@@ -0,0 +1,242 @@
+/*
+ * frame_test.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+#include "frame.h"
+
+#define CAPTURE_SIZE 4096
+
+/*
+ * Fake transport capturing the data written by each batch.
+ */
+struct Capture {
+	uint8_t buf[CAPTURE_SIZE]; /**< Data written */
+	size_t len; /**< Number of bytes written */
+	int batches; /**< Number of batches written */
+};
+
+static int capture_batch(struct Transport *transport, struct TransportSegment *segs, size_t num_segs) {
+	struct Capture *capture = transport->priv;
+	size_t i;
+
+	for (i = 0; i < num_segs; i++) {
+		if (capture->len + segs[i].len > CAPTURE_SIZE) {
+			return -ENOSPC;
+		}
+
+		memcpy(capture->buf + capture->len, segs[i].write_buf, segs[i].len);
+		capture->len += segs[i].len;
+	}
+
+	capture->batches++;
+
+	return num_segs;
+}
+
+static const struct TransportOps capture_ops = {
+	.name = "capture",
+	.batch = capture_batch,
+};
+
+static struct Capture capture;
+static struct Transport transport = { &capture_ops, &capture };
+static struct UartDevice dev = { .transport = &transport };
+
+/*
+ * Reference COBS encoding of a payload and its CRC, one byte at a time.
+ */
+static size_t reference_encode(const uint8_t *payload, size_t payload_len, uint8_t *buf) {
+	uint8_t data[CAPTURE_SIZE];
+	size_t code_pos = 0;
+	size_t len = 1;
+	uint8_t code = 1;
+	uint16_t crc;
+	size_t i;
+
+	crc = frame_crc16(0xFFFF, payload, payload_len);
+	memcpy(data, payload, payload_len);
+	data[payload_len] = crc >> 8;
+	data[payload_len + 1] = crc & 0xFF;
+
+	for (i = 0; i < payload_len + 2; i++) {
+		if (data[i]) {
+			buf[len++] = data[i];
+			code++;
+		}
+
+		if (!data[i] || code == 0xFF) {
+			buf[code_pos] = code;
+			code_pos = len++;
+			code = 1;
+		}
+	}
+
+	buf[code_pos] = code;
+	buf[len++] = 0;
+
+	return len;
+}
+
+/*
+ * Feed received data into a decoder.
+ */
+static void decoder_feed(struct FrameDecoder *dec, const uint8_t *buf, size_t buf_len) {
+	uint8_t *span;
+	size_t len;
+
+	len = frame_decoder_span(dec, &span);
+	if (len > buf_len) {
+		len = buf_len;
+	}
+
+	memcpy(span, buf, len);
+	frame_decoder_commit(dec, len);
+}
+
+/*
+ * Write a payload as a frame, check its encoding and decode it back.
+ *
+ * @return the number of batches the frame was written in
+ */
+static int round_trip(const uint8_t *payload, size_t payload_len) {
+	uint8_t expected[CAPTURE_SIZE];
+	struct FrameDecoder dec;
+	struct FrameView view;
+	size_t expected_len;
+
+	capture.len = 0;
+	capture.batches = 0;
+
+	TEST_CHECK(frame_write(&dev, payload, payload_len) == 0);
+
+	expected_len = reference_encode(payload, payload_len, expected);
+	TEST_CHECK(capture.len == expected_len);
+	TEST_CHECK(!memcmp(capture.buf, expected, expected_len));
+	TEST_CHECK(memchr(capture.buf, 0, capture.len) == capture.buf + capture.len - 1);
+
+	dec.size = CAPTURE_SIZE;
+	if (frame_decoder_init(&dec)) {
+		TEST_CHECK(!"failed to initialize frame decoder");
+		return 0;
+	}
+
+	decoder_feed(&dec, capture.buf, capture.len);
+	TEST_CHECK(frame_decoder_next(&dec, &view) == 1);
+	TEST_CHECK(view.len == payload_len);
+	TEST_CHECK(!memcmp(view.data, payload, payload_len));
+	TEST_CHECK(frame_decoder_next(&dec, &view) == 0);
+
+	frame_decoder_destroy(&dec);
+
+	return capture.batches;
+}
+
+static void test_round_trip(void) {
+	uint8_t payload[1024];
+	size_t i;
+
+	TEST_CHECK(round_trip((uint8_t *)"hello", 5) == 1);
+	TEST_CHECK(round_trip((uint8_t *)"a\0b\0\0c", 6) == 1);
+	TEST_CHECK(round_trip(payload, 0) == 1);
+
+	/*
+	 * Runs of exactly 254 non-zero bytes end a block with no implied zero,
+	 * whether a zero follows them or not.
+	 */
+	memset(payload, 0x55, sizeof(payload));
+	TEST_CHECK(round_trip(payload, 254) == 1);
+	payload[254] = 0;
+	TEST_CHECK(round_trip(payload, 255) == 1);
+	memset(payload, 0x55, sizeof(payload));
+	TEST_CHECK(round_trip(payload, 600) == 1);
+
+	/*
+	 * Runs reaching the end of the payload continue into the CRC, up to
+	 * crossing the 254 byte limit inside it.
+	 */
+	for (i = 250; i < 256; i++) {
+		TEST_CHECK(round_trip(payload, i) == 1);
+	}
+
+	/*
+	 * Many short blocks run out of I/O vectors, the completed blocks are
+	 * written before the frame ends.
+	 */
+	for (i = 0; i < sizeof(payload); i++) {
+		payload[i] = i % 2 ? 0 : 0xAA;
+	}
+	TEST_CHECK(round_trip(payload, sizeof(payload)) > 1);
+	TEST_CHECK(round_trip(payload, 16) == 1);
+}
+
+static void test_decoder_errors(void) {
+	static const uint8_t empty[] = { 0, 0 };
+	static const uint8_t short_frame[] = { 0x02, 0x55, 0 };
+	static const uint8_t truncated[] = { 0x05, 0x55, 0x55, 0 };
+	uint8_t frame[CAPTURE_SIZE];
+	uint8_t payload[64];
+	struct FrameDecoder dec;
+	struct FrameView view;
+	size_t frame_len;
+
+	dec.size = 64;
+	if (frame_decoder_init(&dec)) {
+		TEST_CHECK(!"failed to initialize frame decoder");
+		return;
+	}
+
+	/*
+	 * Bare delimiters are skipped silently.
+	 */
+	decoder_feed(&dec, empty, sizeof(empty));
+	TEST_CHECK(frame_decoder_next(&dec, &view) == 0);
+
+	decoder_feed(&dec, short_frame, sizeof(short_frame));
+	TEST_CHECK(frame_decoder_next(&dec, &view) == -EBADMSG);
+
+	decoder_feed(&dec, truncated, sizeof(truncated));
+	TEST_CHECK(frame_decoder_next(&dec, &view) == -EBADMSG);
+
+	memset(payload, 0x11, sizeof(payload));
+	frame_len = reference_encode(payload, 8, frame);
+	frame[3] ^= 0x01;
+	decoder_feed(&dec, frame, frame_len);
+	TEST_CHECK(frame_decoder_next(&dec, &view) == -EBADMSG);
+
+	/*
+	 * A frame larger than the buffer is dropped once the buffer is full,
+	 * its tail is dropped at the next delimiter.
+	 */
+	frame_len = reference_encode(payload, sizeof(payload), frame);
+	TEST_CHECK(frame_len > dec.size);
+	decoder_feed(&dec, frame, dec.size);
+	TEST_CHECK(frame_decoder_next(&dec, &view) == -EMSGSIZE);
+	decoder_feed(&dec, frame + dec.size, frame_len - dec.size);
+	TEST_CHECK(frame_decoder_next(&dec, &view) == -EBADMSG);
+
+	/*
+	 * The decoder resynchronizes on the delimiter, then decodes the frames
+	 * after it.
+	 */
+	frame_len = reference_encode(payload, 8, frame);
+	decoder_feed(&dec, frame, frame_len);
+	TEST_CHECK(frame_decoder_next(&dec, &view) == 1);
+	TEST_CHECK(view.len == 8 && !memcmp(view.data, payload, 8));
+	TEST_CHECK(frame_decoder_next(&dec, &view) == 0);
+
+	frame_decoder_destroy(&dec);
+}
+
+int main() {
+	test_round_trip();
+	test_decoder_errors();
+
+	return test_report("frame_test");
+}
@@ -0,0 +1,313 @@
+/*
+ * uart_reactor_test.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+#include "uart.h"
+#include "uart_reactor.h"
+
+/*
+ * UART device on the slave of a pty pair, the master standing for the
+ * other end of the line, multiplexed by the reactor under test.
+ */
+struct PtyPort {
+	struct UartDevice dev; /**< UART device on the slave */
+	int master; /**< Non-blocking master of the pty pair */
+	struct UartPort port; /**< Port of the UART device */
+	int reads; /**< Number of on_read calls */
+	int writes; /**< Number of on_write calls */
+	int errors; /**< Number of on_error calls */
+};
+
+static struct UartReactor reactor;
+
+/*
+ * Ports removed by the next on_read callback, NULL for none.
+ */
+static struct PtyPort *remove_on_read[2];
+
+static void on_read(struct UartPort *port) {
+	struct PtyPort *pty = port->priv;
+	size_t i;
+
+	pty->reads++;
+
+	for (i = 0; i < 2; i++) {
+		if (remove_on_read[i]) {
+			uart_reactor_remove(&reactor, &remove_on_read[i]->port);
+			remove_on_read[i] = NULL;
+		}
+	}
+}
+
+static void on_write(struct UartPort *port) {
+	struct PtyPort *pty = port->priv;
+
+	pty->writes++;
+}
+
+static void on_error(struct UartPort *port) {
+	struct PtyPort *pty = port->priv;
+
+	pty->errors++;
+	uart_reactor_remove(&reactor, port);
+}
+
+static int pty_port_start(struct PtyPort *pty, size_t rx_size, size_t tx_size) {
+	int rc;
+
+	memset(pty, 0, sizeof(*pty));
+
+	pty->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (pty->master < 0) {
+		return -errno;
+	}
+
+	if (grantpt(pty->master) || unlockpt(pty->master) ||
+			!(pty->dev.filename = ptsname(pty->master))) {
+		rc = -errno;
+		close(pty->master);
+		return rc;
+	}
+
+	pty->dev.filename = strdup(pty->dev.filename);
+	pty->dev.rate = 115200;
+	pty->dev.transport = NULL;
+
+	rc = uart_start(&pty->dev, false);
+	if (rc) {
+		goto fail_start;
+	}
+
+	pty->port.dev = &pty->dev;
+	pty->port.rx_size = rx_size;
+	pty->port.tx_size = tx_size;
+	pty->port.on_read = on_read;
+	pty->port.on_write = on_write;
+	pty->port.on_error = on_error;
+	pty->port.priv = pty;
+
+	rc = uart_reactor_add(&reactor, &pty->port);
+	if (rc) {
+		uart_stop(&pty->dev);
+		goto fail_start;
+	}
+
+	return 0;
+
+fail_start:
+	free(pty->dev.filename);
+	close(pty->master);
+	return rc;
+}
+
+static void pty_port_stop(struct PtyPort *pty, bool removed) {
+	if (!removed) {
+		uart_reactor_remove(&reactor, &pty->port);
+	}
+
+	uart_stop(&pty->dev);
+	free(pty->dev.filename);
+	if (pty->master >= 0) {
+		close(pty->master);
+	}
+}
+
+/*
+ * Poll the reactor until a condition holds, at most for a second.
+ */
+#define POLL_UNTIL(cond) \
+	do { \
+		int polls; \
+		for (polls = 0; polls < 100 && !(cond); polls++) { \
+			uart_reactor_poll(&reactor, 10); \
+		} \
+	} while (0)
+
+static void test_read(void) {
+	struct PtyPort pty;
+	uint8_t buf[64];
+
+	if (pty_port_start(&pty, 64, 64)) {
+		TEST_CHECK(!"failed to start pty port");
+		return;
+	}
+
+	TEST_CHECK(write(pty.master, "hello", 5) == 5);
+	POLL_UNTIL(pty.reads);
+	TEST_CHECK(pty.reads == 1);
+	TEST_CHECK(uart_port_read(&reactor, &pty.port, buf, sizeof(buf)) == 5);
+	TEST_CHECK(!memcmp(buf, "hello", 5));
+
+	pty_port_stop(&pty, false);
+}
+
+static void test_rx_full(void) {
+	struct PtyPort pty;
+	uint8_t buf[64];
+	size_t total;
+
+	if (pty_port_start(&pty, 16, 64)) {
+		TEST_CHECK(!"failed to start pty port");
+		return;
+	}
+
+	/*
+	 * The port stops waiting for data once its ring is full.
+	 */
+	memset(buf, 'a', 40);
+	TEST_CHECK(write(pty.master, buf, 40) == 40);
+	POLL_UNTIL(!ring_space(&pty.port.rx));
+	TEST_CHECK(!ring_space(&pty.port.rx));
+	TEST_CHECK(!(pty.port.events & EPOLLIN));
+	TEST_CHECK(uart_reactor_poll(&reactor, 20) == 0);
+
+	/*
+	 * Reading re-arms it, until all the data went through the ring.
+	 */
+	total = 0;
+	while (total < 40) {
+		total += uart_port_read(&reactor, &pty.port, buf, sizeof(buf));
+		TEST_CHECK(pty.port.events & EPOLLIN);
+		if (total < 40) {
+			POLL_UNTIL(ring_len(&pty.port.rx));
+			if (!ring_len(&pty.port.rx)) {
+				break;
+			}
+		}
+	}
+	TEST_CHECK(total == 40);
+
+	pty_port_stop(&pty, false);
+}
+
+static void test_write(void) {
+	static uint8_t buf[64 * 1024];
+	struct PtyPort pty;
+	size_t received = 0;
+	ssize_t rc;
+	int i;
+
+	if (pty_port_start(&pty, 64, sizeof(buf))) {
+		TEST_CHECK(!"failed to start pty port");
+		return;
+	}
+
+	/*
+	 * More than the pty buffers, the rest is queued and waits for EPOLLOUT.
+	 */
+	memset(buf, 'w', sizeof(buf));
+	TEST_CHECK(uart_port_write(&reactor, &pty.port, buf, sizeof(buf)) == sizeof(buf));
+	TEST_CHECK(ring_len(&pty.port.tx) > 0);
+	TEST_CHECK(pty.port.events & EPOLLOUT);
+	TEST_CHECK(pty.writes == 0);
+
+	for (i = 0; i < 1000 && !pty.writes; i++) {
+		while ((rc = read(pty.master, buf, sizeof(buf))) > 0) {
+			received += rc;
+		}
+
+		uart_reactor_poll(&reactor, 10);
+	}
+
+	while ((rc = read(pty.master, buf, sizeof(buf))) > 0) {
+		received += rc;
+	}
+
+	TEST_CHECK(pty.writes == 1);
+	TEST_CHECK(received == sizeof(buf));
+	TEST_CHECK(!(pty.port.events & EPOLLOUT));
+
+	pty_port_stop(&pty, false);
+}
+
+static void test_hangup(void) {
+	struct PtyPort pty;
+
+	if (pty_port_start(&pty, 64, 64)) {
+		TEST_CHECK(!"failed to start pty port");
+		return;
+	}
+
+	close(pty.master);
+	pty.master = -1;
+
+	POLL_UNTIL(pty.errors);
+	TEST_CHECK(pty.errors == 1);
+	TEST_CHECK(pty.port.error == -EPIPE);
+	TEST_CHECK(uart_port_write(&reactor, &pty.port, (uint8_t *)"x", 1) == -EPIPE);
+
+	/*
+	 * The failed port is not reported again.
+	 */
+	TEST_CHECK(uart_reactor_poll(&reactor, 20) == 0);
+	TEST_CHECK(pty.errors == 1);
+
+	pty_port_stop(&pty, true);
+}
+
+static void test_remove_in_callback(void) {
+	struct PtyPort ptys[2];
+	int i;
+
+	if (pty_port_start(&ptys[0], 64, 64)) {
+		TEST_CHECK(!"failed to start pty port");
+		return;
+	}
+
+	if (pty_port_start(&ptys[1], 64, 64)) {
+		TEST_CHECK(!"failed to start pty port");
+		pty_port_stop(&ptys[0], false);
+		return;
+	}
+
+	/*
+	 * Both ports are readable in the same poll, the first callback removes
+	 * both of them, so the other port is not handled anymore.
+	 */
+	remove_on_read[0] = &ptys[0];
+	remove_on_read[1] = &ptys[1];
+
+	TEST_CHECK(write(ptys[0].master, "a", 1) == 1);
+	TEST_CHECK(write(ptys[1].master, "b", 1) == 1);
+	usleep(20000);
+
+	TEST_CHECK(uart_reactor_poll(&reactor, 100) == 2);
+	TEST_CHECK(ptys[0].reads + ptys[1].reads == 1);
+
+	for (i = 0; i < 2; i++) {
+		TEST_CHECK(write(ptys[i].master, "c", 1) == 1);
+	}
+	TEST_CHECK(uart_reactor_poll(&reactor, 20) == 0);
+
+	pty_port_stop(&ptys[0], true);
+	pty_port_stop(&ptys[1], true);
+}
+
+int main() {
+	if (uart_reactor_start(&reactor)) {
+		printf("failed to start reactor\r\n");
+		return 1;
+	}
+
+	test_read();
+	test_rx_full();
+	test_write();
+	test_hangup();
+	test_remove_in_callback();
+
+	uart_reactor_stop(&reactor);
+
+	return test_report("uart_reactor_test");
+}
@@ -0,0 +1,188 @@
+/*
+ * uart_uring_test.c
+ *
+ * @date 2026/10/17
+ * @author Cosmin Tanislav
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <errno.h>
+
+#include "test.h"
+#include "uart.h"
+#include "uart_uring.h"
+
+#define NUM_PORTS 2
+
+/*
+ * UART device on the slave of a pty pair, the master standing for the
+ * other end of the line.
+ */
+struct PtyPort {
+	struct UartDevice dev; /**< UART device on the slave */
+	int master; /**< Master of the pty pair */
+};
+
+static int pty_port_start(struct PtyPort *port) {
+	int rc;
+
+	port->master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (port->master < 0) {
+		return -errno;
+	}
+
+	if (grantpt(port->master) || unlockpt(port->master) ||
+			!(port->dev.filename = ptsname(port->master))) {
+		rc = -errno;
+		close(port->master);
+		return rc;
+	}
+
+	port->dev.filename = strdup(port->dev.filename);
+	port->dev.rate = 115200;
+	port->dev.transport = NULL;
+
+	rc = uart_start(&port->dev, false);
+	if (rc) {
+		free(port->dev.filename);
+		close(port->master);
+		return rc;
+	}
+
+	return 0;
+}
+
+static void pty_port_stop(struct PtyPort *port) {
+	uart_stop(&port->dev);
+	free(port->dev.filename);
+	close(port->master);
+}
+
+/*
+ * Read from the master of a pty pair what the UART device wrote.
+ */
+static ssize_t pty_port_receive(struct PtyPort *port, uint8_t *buf, size_t buf_len) {
+	struct pollfd fd;
+
+	fd.fd = port->master;
+	fd.events = POLLIN;
+
+	if (poll(&fd, 1, 1000) <= 0) {
+		return -1;
+	}
+
+	return read(port->master, buf, buf_len);
+}
+
+static void test_uring(bool sync) {
+	struct UartDevice *devs[NUM_PORTS];
+	struct PtyPort ports[NUM_PORTS];
+	struct UartIo reads[NUM_PORTS];
+	struct UartIo writes[NUM_PORTS];
+	struct UartIo *ios[2 * NUM_PORTS];
+	struct UartUring ring;
+	uint8_t buf[16];
+	size_t i;
+	int rc;
+
+	for (i = 0; i < NUM_PORTS; i++) {
+		rc = pty_port_start(&ports[i]);
+		TEST_CHECK(rc == 0);
+		if (rc) {
+			return;
+		}
+
+		devs[i] = &ports[i].dev;
+	}
+
+	ring.entries = 8;
+	ring.devs = devs;
+	ring.num_devs = NUM_PORTS;
+	ring.num_bufs = 2 * NUM_PORTS;
+	ring.buf_len = 64;
+	ring.sync = sync;
+
+	rc = uart_uring_start(&ring);
+	TEST_CHECK(rc == 0);
+	if (rc) {
+		return;
+	}
+
+	if (sync) {
+		TEST_CHECK(ring.fd < 0);
+		TEST_CHECK(fcntl(ports[0].dev.fd, F_GETFL) & O_NONBLOCK);
+	}
+
+	/*
+	 * Reads on idle ports stay in flight.
+	 */
+	for (i = 0; i < NUM_PORTS; i++) {
+		reads[i].port = i;
+		reads[i].buf = uart_uring_buf(&ring, i);
+		reads[i].len = ring.buf_len;
+		reads[i].write = false;
+		reads[i].priv = NULL;
+		TEST_CHECK(uart_uring_queue(&ring, &reads[i]) == 0);
+	}
+
+	TEST_CHECK(uart_uring_submit(&ring, 0) == NUM_PORTS);
+	TEST_CHECK(uart_uring_reap(&ring, ios, 2 * NUM_PORTS) == 0);
+
+	/*
+	 * Data received on the second port completes its read only.
+	 */
+	TEST_CHECK(write(ports[1].master, "abc", 3) == 3);
+	TEST_CHECK(uart_uring_submit(&ring, 1) >= 0);
+	TEST_CHECK(uart_uring_reap(&ring, ios, 2 * NUM_PORTS) == 1);
+	TEST_CHECK(ios[0] == &reads[1]);
+	TEST_CHECK(reads[1].result == 3 && !memcmp(reads[1].buf, "abc", 3));
+
+	/*
+	 * Writes complete while the read of the first port is in flight.
+	 */
+	for (i = 0; i < NUM_PORTS; i++) {
+		writes[i].port = i;
+		writes[i].buf = uart_uring_buf(&ring, NUM_PORTS + i);
+		writes[i].len = 5;
+		writes[i].write = true;
+		writes[i].priv = NULL;
+		memcpy(writes[i].buf, "hello", 5);
+		TEST_CHECK(uart_uring_queue(&ring, &writes[i]) == 0);
+	}
+
+	TEST_CHECK(uart_uring_submit(&ring, NUM_PORTS) == NUM_PORTS);
+	TEST_CHECK(uart_uring_reap(&ring, ios, 2 * NUM_PORTS) == NUM_PORTS);
+	for (i = 0; i < NUM_PORTS; i++) {
+		TEST_CHECK(writes[i].result == 5);
+		TEST_CHECK(pty_port_receive(&ports[i], buf, sizeof(buf)) == 5 && !memcmp(buf, "hello", 5));
+	}
+
+	TEST_CHECK(write(ports[0].master, "xy", 2) == 2);
+	TEST_CHECK(uart_uring_submit(&ring, 1) >= 0);
+	TEST_CHECK(uart_uring_reap(&ring, ios, 2 * NUM_PORTS) == 1);
+	TEST_CHECK(ios[0] == &reads[0]);
+	TEST_CHECK(reads[0].result == 2 && !memcmp(reads[0].buf, "xy", 2));
+
+	uart_uring_stop(&ring);
+
+	if (sync) {
+		TEST_CHECK(!(fcntl(ports[0].dev.fd, F_GETFL) & O_NONBLOCK));
+	}
+
+	for (i = 0; i < NUM_PORTS; i++) {
+		pty_port_stop(&ports[i]);
+	}
+}
+
+int main() {
+	test_uring(false);
+	test_uring(true);
+
+	return test_report("uart_uring_test");
+}